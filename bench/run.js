@@ -0,0 +1,293 @@
+#!/usr/bin/env node
+/**
+ * Benchmark driver for nfc-reader-nodejs.
+ *
+ * Runs entirely against the simulated PC/SC backend, so no reader or pcscd is needed.
+ * Measures:
+ *   - native microbenchmarks (hex encoding, histogram, event ring, response chaining)
+ *   - tap-to-callback latency through the listener and its event queue
+ *   - scaling of tap handling across many simulated readers
+ *   - transmit() throughput and latency at varying concurrency
+ *   - wall time of a transmit() burst spread over several readers (per-reader parallelism)
+ *   - GC count / pause time and heap growth per event
+ *
+ * Usage: node bench/run.js [--quick] [--out results.json]
+ * Results are printed as JSON to stdout (or written to --out); a readable summary goes to stderr.
+ */
+'use strict';
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { PerformanceObserver } = require('perf_hooks');
+const pcsc = require('..');
+
+const args = process.argv.slice(2);
+const quick = args.includes('--quick');
+const outIndex = args.indexOf('--out');
+const outFile = outIndex >= 0 ? args[outIndex + 1] : null;
+
+const TAPS = quick ? 200 : 2000;
+const TRANSMITS = quick ? 2000 : 20000;
+const NATIVE_ITERATIONS = quick ? 100000 : 1000000;
+
+function log(message) {
+  process.stderr.write(message + '\n');
+}
+
+function percentiles(samples) {
+  if (samples.length === 0) return { count: 0 };
+  const sorted = Float64Array.from(samples).sort();
+  const at = (p) => sorted[Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1)];
+  const sum = sorted.reduce((a, b) => a + b, 0);
+  return {
+    count: sorted.length,
+    meanUs: sum / sorted.length,
+    p50Us: at(50),
+    p90Us: at(90),
+    p99Us: at(99),
+    p999Us: at(99.9),
+    maxUs: sorted[sorted.length - 1]
+  };
+}
+
+function nowUs() {
+  return Number(process.hrtime.bigint()) / 1000;
+}
+
+function uidFor(counter) {
+  const uid = Buffer.alloc(7);
+  uid[0] = 0x04;
+  uid.writeUInt32BE(counter >>> 0, 3);
+  return uid;
+}
+
+// Counts GC events and pause time between start() and stop()
+function gcMeter() {
+  let count = 0;
+  let pauseMs = 0;
+  const observer = new PerformanceObserver((list) => {
+    for (const entry of list.getEntries()) {
+      count++;
+      pauseMs += entry.duration;
+    }
+  });
+  return {
+    start() {
+      if (global.gc) global.gc();
+      this.heapBefore = process.memoryUsage().heapUsed;
+      observer.observe({ entryTypes: ['gc'] });
+    },
+    async stop(events) {
+      // GC entries are delivered asynchronously
+      await new Promise((resolve) => setImmediate(resolve));
+      observer.disconnect();
+      const heapAfter = process.memoryUsage().heapUsed;
+      return {
+        gcCount: count,
+        gcPerEvent: count / events,
+        gcPauseMsPerEvent: pauseMs / events,
+        heapDeltaBytesPerEvent: (heapAfter - this.heapBefore) / events
+      };
+    }
+  };
+}
+
+function resetSimulator(readerCount) {
+  pcsc.simulator.reset();
+  const readers = [];
+  for (let i = 0; i < readerCount; i++) {
+    const name = `Sim Reader ${i}`;
+    pcsc.simulator.addReader(name);
+    readers.push(name);
+  }
+  pcsc.resetStats();
+  return readers;
+}
+
+// Taps cards on every reader in parallel (each reader taps sequentially) and measures insert -> onUid
+async function benchTaps(readerCount, tapsPerReader, uidFormat) {
+  const readers = resetSimulator(readerCount);
+  const pending = new Map();
+  const latencies = [];
+  let uidCounter = 1;
+
+  pcsc.startListening(null, (uid, readerName) => {
+    const waiter = pending.get(readerName);
+    if (waiter) {
+      pending.delete(readerName);
+      waiter(nowUs());
+    }
+  }, (message) => {
+    log(`  listener error: ${message}`);
+  }, { uidFormat, queueSize: 1024 });
+
+  // Give the listener time to pick up the readers
+  await new Promise((resolve) => setTimeout(resolve, 50));
+
+  const gc = gcMeter();
+  gc.start();
+  const startedUs = nowUs();
+  await Promise.all(readers.map(async (reader) => {
+    for (let i = 0; i < tapsPerReader; i++) {
+      const delivered = new Promise((resolve) => pending.set(reader, resolve));
+      const insertedUs = nowUs();
+      pcsc.simulator.insertCard(reader, { uid: uidFor(uidCounter++) });
+      latencies.push((await delivered) - insertedUs);
+      pcsc.simulator.removeCard(reader);
+    }
+  }));
+  const elapsedUs = nowUs() - startedUs;
+  const events = readerCount * tapsPerReader;
+  const gcStats = await gc.stop(events);
+
+  const native = pcsc.getStats().readers;
+  pcsc.stopListening();
+  return {
+    name: 'taps',
+    readers: readerCount,
+    uidFormat,
+    events,
+    eventsPerSec: events / (elapsedUs / 1e6),
+    latency: percentiles(latencies),
+    nativeTapToCallbackP99Us: Math.max(...Object.values(native).map((r) => r.tapToCallback.p99Us)),
+    nativeDeliveryP99Us: Math.max(...Object.values(native).map((r) => r.delivery.p99Us)),
+    ...gcStats
+  };
+}
+
+// Keeps `concurrency` transmit() calls in flight, spread round-robin over `readerCount` readers
+async function benchTransmit(readerCount, concurrency, transmitLatencyMs) {
+  const readers = resetSimulator(readerCount);
+  for (const reader of readers) {
+    pcsc.simulator.insertCard(reader, { uid: uidFor(1) });
+  }
+  pcsc.simulator.setLatency('transmit', transmitLatencyMs);
+
+  const apdu = Buffer.from([0xFF, 0xCA, 0x00, 0x00, 0x00]);
+  const latencies = [];
+  let issued = 0;
+  const total = transmitLatencyMs > 0 ? Math.min(TRANSMITS, 2000) : TRANSMITS;
+
+  const gc = gcMeter();
+  gc.start();
+  const startedUs = nowUs();
+  await Promise.all(Array.from({ length: concurrency }, async () => {
+    while (issued < total) {
+      const reader = readers[issued++ % readers.length];
+      const sentUs = nowUs();
+      await pcsc.transmit(reader, apdu);
+      latencies.push(nowUs() - sentUs);
+    }
+  }));
+  const elapsedUs = nowUs() - startedUs;
+  const gcStats = await gc.stop(total);
+
+  return {
+    name: 'transmit',
+    readers: readerCount,
+    concurrency,
+    transmitLatencyMs,
+    operations: total,
+    opsPerSec: total / (elapsedUs / 1e6),
+    latency: percentiles(latencies),
+    ...gcStats
+  };
+}
+
+// Sends one transmit() to each of `readerCount` readers at once, `rounds` times. With per-reader queues the
+// burst should take about one card latency, not `readerCount` of them, even when the pool starts out idle.
+async function benchReaderBursts(readerCount, transmitLatencyMs, rounds) {
+  const readers = resetSimulator(readerCount);
+  for (const reader of readers) {
+    pcsc.simulator.insertCard(reader, { uid: uidFor(1) });
+  }
+  pcsc.simulator.setLatency('transmit', transmitLatencyMs);
+
+  const apdu = Buffer.from([0xFF, 0xCA, 0x00, 0x00, 0x00]);
+  const bursts = [];
+  for (let i = 0; i < rounds; i++) {
+    // Let the pool threads go idle between bursts
+    await new Promise((resolve) => setTimeout(resolve, 2));
+    const startedUs = nowUs();
+    await Promise.all(readers.map((reader) => pcsc.transmit(reader, apdu)));
+    bursts.push(nowUs() - startedUs);
+  }
+
+  return {
+    name: 'readerBurst',
+    readers: readerCount,
+    transmitLatencyMs,
+    rounds,
+    burst: percentiles(bursts),
+    serialUs: readerCount * transmitLatencyMs * 1000
+  };
+}
+
+async function main() {
+  pcsc.useBackend('simulated');
+
+  const results = {
+    meta: {
+      package: require('../package.json').version,
+      node: process.version,
+      platform: process.platform,
+      arch: process.arch,
+      cpus: os.cpus().length,
+      cpuModel: os.cpus()[0] ? os.cpus()[0].model : 'unknown',
+      quick,
+      gcExposed: typeof global.gc === 'function',
+      timestamp: new Date().toISOString()
+    },
+    native: pcsc.runNativeBenchmarks(NATIVE_ITERATIONS),
+    scenarios: []
+  };
+  for (const entry of results.native) {
+    log(`native ${entry.name}: ${entry.nsPerOp.toFixed(1)} ns/op`);
+  }
+
+  for (const uidFormat of ['hex', 'buffer']) {
+    const result = await benchTaps(1, TAPS, uidFormat);
+    results.scenarios.push(result);
+    log(`taps x1 (${uidFormat}): p50 ${result.latency.p50Us.toFixed(0)} us, p99 ${result.latency.p99Us.toFixed(0)} us, ` +
+        `${result.gcPerEvent.toFixed(3)} GC/event`);
+  }
+
+  for (const readerCount of [8, 32, 64]) {
+    const result = await benchTaps(readerCount, Math.max(10, Math.floor(TAPS / readerCount)), 'buffer');
+    results.scenarios.push(result);
+    log(`taps x${readerCount}: ${result.eventsPerSec.toFixed(0)} events/s, p99 ${result.latency.p99Us.toFixed(0)} us`);
+  }
+
+  for (const transmitLatencyMs of [0, 1]) {
+    for (const concurrency of [1, 4, 16, 64]) {
+      for (const readerCount of [1, 8]) {
+        const result = await benchTransmit(readerCount, concurrency, transmitLatencyMs);
+        results.scenarios.push(result);
+        log(`transmit ${readerCount} reader(s), concurrency ${concurrency}, card latency ${transmitLatencyMs} ms: ` +
+            `${result.opsPerSec.toFixed(0)} ops/s, p99 ${result.latency.p99Us.toFixed(0)} us`);
+      }
+    }
+  }
+
+  for (const readerCount of [2, 8]) {
+    const result = await benchReaderBursts(readerCount, 1, quick ? 50 : 500);
+    results.scenarios.push(result);
+    log(`transmit burst across ${readerCount} readers, card latency 1 ms: p50 ${result.burst.p50Us.toFixed(0)} us ` +
+        `(serial would be ${result.serialUs} us)`);
+  }
+
+  pcsc.simulator.reset();
+  const json = JSON.stringify(results, null, 2);
+  if (outFile) {
+    fs.writeFileSync(path.resolve(outFile), json + '\n');
+    log(`results written to ${outFile}`);
+  } else {
+    process.stdout.write(json + '\n');
+  }
+}
+
+main().catch((error) => {
+  log(error && error.stack ? error.stack : String(error));
+  process.exitCode = 1;
+});
@@ -17,14 +17,14 @@
           "libraries": ["-lwinscard"],
           "msvs_settings": {
             "VCCLCompilerTool": {
-              "ExceptionHandling": 0
+              "ExceptionHandling": 1
             }
           }
         }],
         ['OS=="linux"', {
             "libraries": ["-lpcsclite"],
-            'cflags': ['-fno-exceptions'],
-            'cflags_cc': ['-fno-exceptions']
+            'cflags!': ['-fno-exceptions'],
+            'cflags_cc!': ['-fno-exceptions']
         }],
         ['OS=="mac" or OS=="darwin"', {
           'include_dirs': [
@@ -42,14 +42,14 @@
              "-lpcsclite"
           ],
           'xcode_settings': {
-            'GCC_ENABLE_CPP_EXCEPTIONS': 'NO',
+            'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',
             'CLANG_CXX_LIBRARY': 'libc++',
             'MACOSX_DEPLOYMENT_TARGET': '10.13',
             'GCC_TREAT_WARNINGS_AS_ERRORS': 'NO',
             'WARNING_CFLAGS!': ['-Werror']
           },
-          'cflags': ['-fno-exceptions'],
-          'cflags_cc': ['-fno-exceptions']
+          'cflags!': ['-fno-exceptions'],
+          'cflags_cc!': ['-fno-exceptions']
         }]
       ]
     }
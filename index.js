@@ -1,5 +1,84 @@
 const addon = require('bindings')('pcsc'); // Finds the correct addon file
 
+/**
+ * A persistent connection to the card in a reader.
+ * The card handle and active protocol are kept open between transmit() calls,
+ * so a multi-APDU exchange pays for SCardConnect only once.
+ */
+class CardSession {
+  /**
+   * @param {number} id - The native session id.
+   * @param {string} readerName - The reader the session is connected to.
+   */
+  constructor(id, readerName) {
+    this.id = id;
+    this.readerName = readerName;
+  }
+
+  /**
+   * Sends a raw APDU over the open connection.
+   * If the card was reset by another application, or the PC/SC service was restarted,
+   * the session reconnects and retries once.
+   * @param {Buffer} apdu - A Node.js Buffer object containing the raw APDU command to send.
+   * @param {{ chaining?: boolean, commandChaining?: boolean }} [options] - See transmit().
+   * @returns {Promise<Buffer>} A Promise that resolves with the raw APDU response (including SW1/SW2).
+   */
+  transmit(apdu, options) {
+    return addon.sessionTransmit(this.id, apdu, options);
+  }
+
+  /**
+   * Runs a list of APDUs over the open connection in a single native call.
+   * @param {Buffer[]} apdus - The APDU commands to send, in order.
+   * @param {{ stopOnError?: boolean, chaining?: boolean, commandChaining?: boolean }} [options] - See transmitBatch().
+   * @returns {Promise<Buffer[]>} A Promise that resolves with one response per executed APDU.
+   */
+  transmitBatch(apdus, options) {
+    return addon.transmitBatch(this.id, apdus, options);
+  }
+
+  /**
+   * Reads card memory over the open connection. See readMemory().
+   * @param {{ start?: number, count?: number }} [range]
+   * @param {Array<Buffer | { key: Buffer, type?: 'A' | 'B' }>} [keys]
+   * @returns {Promise<Buffer>}
+   */
+  readMemory(range, keys) {
+    return addon.readMemory(this.id, range, keys);
+  }
+
+  /**
+   * Runs AuthenticateEV2First with a DESFire AES key and keeps the secure channel on this session.
+   * Later desfireCommand() calls are MACed / encrypted natively with the derived session keys.
+   * The channel ends when the card is reset, an application is selected or a command fails.
+   * @param {number} keyNo - The key number in the selected application.
+   * @param {Buffer} key - The 16-byte AES key.
+   * @param {{ aid?: number | Buffer }} [options] - Select this application first.
+   * @returns {Promise<void>}
+   */
+  authenticateEv2(keyNo, key, options) {
+    return addon.desfire(this.id, { ...options, keyNo, key });
+  }
+
+  /**
+   * Sends one DESFire command over the session's secure channel. See desfire().
+   * @param {number} command - The DESFire command code, e.g. 0xAD (ReadData).
+   * @param {{ header?: Buffer, data?: Buffer, commMode?: 'plain' | 'mac' | 'full', responseMode?: 'plain' | 'mac' | 'full' }} [options]
+   * @returns {Promise<Buffer>} The verified, decrypted response data.
+   */
+  desfireCommand(command, options) {
+    return addon.desfire(this.id, { ...options, command });
+  }
+
+  /**
+   * Disconnects from the card. Waits for in-flight transmits on this session to finish.
+   * @returns {Promise<void>}
+   */
+  close() {
+    return addon.closeSession(this.id);
+  }
+}
+
 // Directly export the functions from the C++ addon
 module.exports = {
   /**
@@ -10,11 +89,74 @@ module.exports = {
   getAllReaders: addon.getAllReaders,
 
   /**
-   * Starts listening for card insertions on the specified reader.
-   * When a card is detected, it sends the default Get UID command.
-   * @param {string} readerName - The name of the reader to listen on.
-   * @param {(uid: string) => void} onUid - The callback function invoked when a card UID (hex string) is successfully read.
-   * @param {(errorMessage: string) => void} onError - The callback function invoked when an error occurs during listening (the error message is passed as a string).
+   * Lists the names of all available PC/SC readers without blocking the event loop.
+   * The PC/SC calls run on the addon's thread pool; the reader cache is refreshed as with getAllReaders().
+   * @returns {Promise<string[]>} A Promise that resolves with the reader names.
+   */
+  listReaders: addon.listReaders,
+
+  /**
+   * Reads the state of every reader at once, with a single zero-timeout SCardGetStatusChange call
+   * made off the event loop. Suitable for frequent health checks.
+   * @returns {Promise<Array<{
+   *   name: string,
+   *   state: number,
+   *   flags: string[],
+   *   cardPresent: boolean,
+   *   atr: Buffer | null,
+   *   cardType: string | null
+   * }>>} One entry per reader. state is the SCARD_STATE_* mask (without the event counter and CHANGED bit);
+   *   flags names its bits ('empty', 'present', 'inuse', 'mute', ...); atr and cardType (see parseAtr()) are set when a card is present.
+   */
+  getReaderStatus: addon.getReaderStatus,
+
+  /**
+   * Parses an ATR and classifies the card from it, without sending any APDU.
+   * Contactless readers build the ATR as defined in PC/SC Part 3: storage cards carry a standard byte
+   * and a card name, ISO 14443-4 cards carry the historical bytes of their ATS.
+   * Results are cached per ATR, so repeated card types are resolved by a lookup.
+   * @param {Buffer} atr - The ATR bytes.
+   * @returns {{
+   *   atr: Buffer,
+   *   type: string,
+   *   historicalBytes: Buffer,
+   *   protocols: number[],
+   *   contactless: boolean,
+   *   valid: boolean,
+   *   standard?: number,
+   *   cardName?: number
+   * }} type is one of 'mifare-classic-1k', 'mifare-classic-4k', 'mifare-mini', 'mifare-ultralight',
+   *   'mifare-ultralight-c', 'mifare-desfire', 'mifare-plus', 'felica', 'icode-sli', 'jewel', 'topaz',
+   *   'storage' (other PC/SC Part 3 storage card), 'iso14443-4' (other ISO-DEP cards and phones),
+   *   'contact' or 'unknown' (malformed ATR). standard and cardName are set for storage cards.
+   */
+  parseAtr: addon.parseAtr,
+
+  /**
+   * Returns the last known list of reader names without contacting the PC/SC service.
+   * The list is refreshed by getAllReaders() and kept up to date by an active listener,
+   * which tracks reader attach/detach through the PnP notification pseudo-reader.
+   * @returns {string[]} An array of strings containing the cached reader names.
+   */
+  getCachedReaders: addon.getCachedReaders,
+
+  /**
+   * Starts listening for card insertions on one or more readers.
+   * All readers are watched from a single background thread with one SCardGetStatusChange call that
+   * waits without a timeout, so an idle listener never wakes up. Use updateListener() to change it while it runs.
+   * When a card is detected, it sends the default Get UID command and then, if configured,
+   * runs options.program on the same connection before reporting the card.
+   * @param {string | string[] | null} readers - The reader name, an array of reader names, or null / an empty array to listen on all connected readers.
+   * @param {(uid: string | Buffer, readerName: string, responses: Buffer[], card: object | null, verdict: 'allow' | 'deny' | null) => void} onUid - The callback function invoked when a card UID (uppercase hex string, or a Buffer with options.uidFormat = 'buffer') is successfully read, together with the name of the reader it was read on, the responses to options.program (empty when no program is set), the card's parsed ATR in the same shape as parseAtr() returns (null if the reader reported no ATR) and the UID index verdict, decided natively on the listener thread (null when no index is loaded, see loadUidIndex()).
+   * @param {(errorMessage: string, readerName?: string) => void} onError - The callback function invoked when an error occurs during listening (the error message is passed as a string; reader-specific errors also pass the reader name).
+   * @param {object} [options] - Optional listener settings.
+   * @param {(event: 'attached' | 'detached', readerName: string) => void} [options.onReaderChange] - Invoked when a reader is plugged in or removed. When listening on all readers, newly attached readers are watched automatically.
+   * @param {Buffer[]} [options.program] - APDUs executed natively on the already-connected card right after the UID is read. 61xx / 6Cxx responses are chained as in transmitBatch().
+   * @param {boolean} [options.programStopOnError=false] - Stop the program after the first response whose status word is not 9000.
+   * @param {number} [options.sameUidCooldownMs=0] - A card is reported once per insertion; the same UID is not reported again until the reader has seen the card removed. When set, the same UID is also suppressed for this many milliseconds after its last report, even if it was removed in between.
+   * @param {'hex' | 'buffer'} [options.uidFormat='hex'] - Deliver the UID as a hex string or as the raw bytes in a Buffer backed by native memory.
+   * @param {number} [options.queueSize=128] - Capacity of the native event queue (rounded up to a power of two). Events are handed to JavaScript in batches, so card detection never waits for the event loop.
+   * @param {'drop' | 'block'} [options.overflow='drop'] - What to do when the queue is full: drop the event (counted in getListenerStats().dropped) or make the listener thread wait for room.
    * @throws {Error} If a synchronous error occurs during initialization (e.g., already listening, invalid parameters, context cannot be established, listener thread failed to start).
    */
   startListening: addon.startListening,
@@ -25,14 +167,379 @@ module.exports = {
    */
   stopListening: addon.stopListening,
 
+  /**
+   * Changes the running listener without stopping it: card state, debounce and queued events are kept.
+   * The change goes to the listener thread through a lock-free queue, and only the listener's
+   * PC/SC wait is cancelled to apply it, so transmits and other workers are not affected.
+   * Readers that are added start fresh, so a card already on them is reported.
+   * All fields are optional; each call is applied as a whole or not at all.
+   * @param {object} changes
+   * @param {string | string[]} [changes.add] - Readers to start watching (not allowed while listening on all readers).
+   * @param {string | string[]} [changes.remove] - Readers to stop watching.
+   * @param {string | string[] | null} [changes.readers] - Replace the watched readers; null or an empty array listens on all readers. Applied before add / remove.
+   * @param {Buffer[] | null} [changes.program] - Replace the tap program; null removes it.
+   * @param {boolean} [changes.programStopOnError]
+   * @param {number} [changes.sameUidCooldownMs]
+   * @returns {Promise<void>} Resolves once the listener thread has applied the change; rejects if the change is invalid or the listener is not active.
+   */
+  updateListener: addon.updateListener,
+
+  /**
+   * Returns the counters of the active listener's event queue.
+   * @returns {{ active: boolean, queueCapacity: number, queued: number, delivered: number, dropped: number }} Queue statistics (all zero when no listener has been started).
+   */
+  getListenerStats: addon.getListenerStats,
+
+  /**
+   * Returns a snapshot of the built-in instrumentation.
+   * Latencies are recorded per reader and operation in log-linear histograms (about 12.5% resolution):
+   * connect, transmit, reconnect, queueWait (time a call waited behind earlier calls to the same reader),
+   * delivery (native event queue to JS callback) and tapToCallback (card detected to onUid invoked).
+   * A reader appears after the first successful connection to it, so mistyped reader names leave no entry.
+   * @returns {{
+   *   uptimeMs: number,
+   *   readers: Object<string, Object<string, { count: number, errors: number, meanUs: number, p50Us: number, p90Us: number, p99Us: number, p999Us: number, maxUs: number }>>,
+   *   statusChange: { wakeups: number, timeouts: number, cancels: number },
+   *   errors: Object<string, number>,
+   *   atrCache: { hits: number, misses: number },
+   *   logging: { level: string, records: number, dropped: number, sinkDropped: number }
+   * }} The snapshot; statusChange.cancels counts listener waits cancelled to apply updateListener(); errors maps PC/SC error codes (e.g. '0x80100069') to their counts, atrCache counts ATR classification lookups.
+   */
+  getStats: addon.getStats,
+
+  /**
+   * Resets all counters and histograms returned by getStats().
+   */
+  resetStats: addon.resetStats,
+
+  /**
+   * Configures the addon's log output. Messages are formatted on the thread that logs them, pushed to that
+   * thread's lock-free buffer and written by a background thread every 50 ms, so logging never blocks card
+   * detection. If a buffer is full, the message is dropped and counted in getStats().logging.dropped.
+   * Per-tap messages (card detected / removed, duplicate suppressed) are logged at 'debug'.
+   * The level and console settings apply to the whole process; each worker thread can have its own sink.
+   * @param {object} options
+   * @param {'off' | 'error' | 'warn' | 'info' | 'debug'} [options.level='info'] - The most verbose level that is logged.
+   * @param {boolean} [options.console=true] - Write to stdout (info, debug) and stderr (warn, error).
+   * @param {((records: { time: number, level: string, message: string }[]) => void) | null} [options.sink] - Receives the log records in batches on this thread's event loop (time is in ms since the epoch). The sink does not keep the event loop alive. null removes it.
+   */
+  configureLogging: addon.configureLogging,
+
   /**
    * Sends a raw APDU command to the card in the specified reader and receives the response.
    * This operation is asynchronous and returns a Promise.
+   * Extended-length APDUs (Lc / Le up to 65535) are supported; the receive buffer is sized from the APDU's Le,
+   * so a 4 KB READ BINARY completes in a single exchange if the reader and card support extended length.
    * @param {string} readerName - The name of the reader to send the command to.
    * @param {Buffer} apdu - A Node.js Buffer object containing the raw APDU command to send.
+   * @param {object} [options] - Optional settings.
+   * @param {boolean} [options.chaining=false] - Handle 61xx / 6Cxx response chaining natively (see transmitBatch()).
+   * @param {boolean} [options.commandChaining=false] - Send an extended-length command as an ISO 7816-4 command chain of short APDUs (CLA bit 0x10 set on all but the last), for readers or cards without extended-length support. Proprietary classes (CLA >= 0x80) are sent unchanged. If the card rejects a segment, that response is returned.
    * @returns {Promise<Buffer>} A Promise that resolves with a Buffer containing the raw APDU response from the card (including the SW1/SW2 status words). The Promise rejects if an error occurs.
    */
-  transmit: addon.transmit // The newly added asynchronous transmit function
+  transmit: addon.transmit, // The newly added asynchronous transmit function
+
+  /**
+   * Sends a list of APDU commands to the card over a single connection in one background job
+   * and resolves once with all responses.
+   * With chaining enabled, 61xx responses are completed with GET RESPONSE and 6Cxx responses
+   * are retried with the corrected Le, so each returned Buffer is the final, complete response.
+   * @param {string} readerName - The name of the reader to send the commands to.
+   * @param {Buffer[]} apdus - The APDU commands to send, in order.
+   * @param {object} [options] - Optional settings.
+   * @param {boolean} [options.stopOnError=false] - Stop after the first response whose status word is not 9000.
+   * @param {boolean} [options.chaining=true] - Handle 61xx / 6Cxx response chaining natively.
+   * @param {boolean} [options.commandChaining=false] - Split extended-length commands into an ISO 7816-4 command chain (see transmit()).
+   * @returns {Promise<Buffer[]>} A Promise that resolves with one response per executed APDU. The Promise rejects if connecting or any transmit fails.
+   */
+  transmitBatch: addon.transmitBatch,
+
+  /**
+   * Reads the memory of a MIFARE Classic (Mini / 1K / 4K) or MIFARE Ultralight / NTAG card in one native call
+   * and returns it as a single Buffer. The card type is taken from the ATR; no probing APDUs are sent.
+   * MIFARE Classic sectors are authenticated once each. The key that opened a sector is remembered per card UID,
+   * so the next read of the same card authenticates every sector on the first attempt. If the reader allows it,
+   * all blocks of a sector are fetched with a single READ BINARY.
+   * @param {string} readerName - The name of the reader.
+   * @param {object} [range] - Blocks (MIFARE Classic, 16 bytes each) or pages (Ultralight / NTAG, 4 bytes each) to read.
+   * @param {number} [range.start=0] - First block or page.
+   * @param {number} [range.count] - Number of blocks or pages; defaults to the rest of the card (for NTAG, whose size is not known from the ATR, the Ultralight size of 16 pages).
+   * @param {Array<Buffer | { key: Buffer, type?: 'A' | 'B' }>} [keys] - MIFARE Classic keys to try, in order. A plain 6-byte Buffer is used as Key A. Defaults to FFFFFFFFFFFF as Key A.
+   * @returns {Promise<Buffer>} A Promise that resolves with the memory contents (sector trailers are returned as the card reports them). The Promise rejects if the card type is not supported or a sector cannot be authenticated or read.
+   */
+  readMemory: addon.readMemory,
+
+  /**
+   * Runs a DESFire EV2 exchange natively in one call: an optional SelectApplication, an optional
+   * AuthenticateEV2First with an AES key, and an optional command under EV2 secure messaging.
+   * The mutual authentication, the session key derivation, and the MAC, encryption and verification
+   * of each command all run on the worker thread over the same card connection. Commands are sent
+   * ISO 7816-4 wrapped (CLA 90). Additional response frames (AF) are collected natively. The
+   * command, including padding and MAC, must fit in one frame (255 bytes).
+   * With a session id the secure channel stays on the session (see CardSession.authenticateEv2()).
+   * With a reader name the card is connected for this call only.
+   * @param {string | number} target - The reader name, or a session id from openSession().
+   * @param {object} request
+   * @param {number | Buffer} [request.aid] - The application to select first (3 bytes; a number is sent little-endian).
+   * @param {Buffer} [request.key] - A 16-byte AES key to authenticate with.
+   * @param {number} [request.keyNo=0] - The key number for request.key.
+   * @param {number} [request.command] - The DESFire command code.
+   * @param {Buffer} [request.header] - The command header, which is sent unencrypted (e.g. file number, offset, length).
+   * @param {Buffer} [request.data] - The command data, encrypted in 'full' mode.
+   * @param {'plain' | 'mac' | 'full'} [request.commMode='plain'] - The command's communication mode. 'mac' and 'full' need an authenticated channel.
+   * @param {'plain' | 'mac' | 'full'} [request.responseMode] - The response's communication mode. Defaults to commMode.
+   * @returns {Promise<Buffer | undefined>} The response data of request.command, with the MAC verified and removed and the data decrypted.
+   */
+  desfire: addon.desfire,
+
+  /**
+   * Reads a DESFire data file in one native call (SelectApplication, AuthenticateEV2First, ReadData).
+   * @param {string | number} target - The reader name, or a session id from openSession().
+   * @param {{ aid?: number | Buffer, keyNo?: number, key?: Buffer, fileNo: number, offset?: number, length?: number, commMode?: 'plain' | 'mac' | 'full' }} options
+   *   The file's communication mode is commMode (default 'full'). A length of 0 reads to the end of the file.
+   * @returns {Promise<Buffer>}
+   */
+  desfireReadData: (target, { aid, keyNo, key, fileNo, offset = 0, length = 0, commMode = 'full' }) => {
+    const header = Buffer.alloc(7);
+    header[0] = fileNo;
+    header.writeUIntLE(offset, 1, 3);
+    header.writeUIntLE(length, 4, 3);
+    return addon.desfire(target, {
+      aid, keyNo, key,
+      command: 0xAD,
+      header,
+      commMode: commMode === 'plain' ? 'plain' : 'mac',
+      responseMode: commMode
+    });
+  },
+
+  /**
+   * Sends a control code (IOCTL) to the reader driver with SCardControl, e.g. a vendor escape command
+   * that changes the RF polling interval or turns off the buzzer. No card is needed: the reader is
+   * opened in SCARD_SHARE_DIRECT mode.
+   * A PC/SC Part 10 feature name is resolved to its control code through the reader's feature table,
+   * which is queried once per reader and cached (see getReaderFeatures()).
+   * @param {string} readerName - The name of the reader.
+   * @param {number | string} controlCode - A platform control code (see scardCtlCode()) or a feature name such as 'CCID_ESC_COMMAND'.
+   * @param {Buffer} [data] - The input bytes for the command.
+   * @returns {Promise<Buffer>} A Promise that resolves with the driver's output bytes. The Promise rejects if the reader does not support the code or feature.
+   */
+  control: addon.control,
+
+  /**
+   * Reads a reader attribute with SCardGetAttrib (no card needed).
+   * @param {string} readerName - The name of the reader.
+   * @param {number} attrId - The attribute id, e.g. one of `readerAttributes`.
+   * @returns {Promise<Buffer>} A Promise that resolves with the raw attribute value.
+   */
+  getAttribute: addon.getAttribute,
+
+  /**
+   * Returns the PC/SC Part 10 features of a reader, as reported by CM_IOCTL_GET_FEATURE_REQUEST.
+   * The table is queried once per reader: when the listener sees the reader attached, or on first use.
+   * Later calls, and feature names passed to control(), are answered from the cache. The entry is
+   * dropped when the reader is detached. Readers without Part 10 support have an empty table.
+   * @param {string} readerName - The name of the reader.
+   * @returns {Promise<Object<string, number>>} A Promise that resolves with a map of feature name (e.g. 'CCID_ESC_COMMAND', 'VERIFY_PIN_DIRECT') to control code.
+   */
+  getReaderFeatures: addon.getReaderFeatures,
+
+  /**
+   * Converts a control function number from vendor documentation to this platform's control code
+   * (SCARD_CTL_CODE: 0x42000000 + code on PCSC-lite, CTL_CODE(FILE_DEVICE_SMARTCARD, code, ...) on Windows).
+   * @param {number} code - The function number, e.g. 3500 for the usual CCID escape command.
+   * @returns {number}
+   */
+  scardCtlCode: addon.scardCtlCode,
+
+  /**
+   * Standard attribute ids for getAttribute(): vendorName, vendorIfdType, vendorIfdVersion,
+   * vendorIfdSerialNo, channelId and atrString.
+   * @type {Object<string, number>}
+   */
+  readerAttributes: addon.readerAttributes,
+
+  /**
+   * Writes a UID access index file: a compact open-addressing hash table of binary UIDs that
+   * loadUidIndex() memory-maps. The file is written next to `path` and renamed into place, so a
+   * process that has the old file loaded keeps reading a complete table. A UID listed twice takes the
+   * verdict of its last occurrence (deny entries come after allow entries).
+   * @param {string} path - Output file.
+   * @param {object} options
+   * @param {(Buffer | string)[]} [options.allow] - UIDs to allow, as Buffers or hex strings (1-10 bytes).
+   * @param {(Buffer | string)[]} [options.deny] - UIDs to deny.
+   * @param {'allow' | 'deny'} [options.defaultVerdict] - Verdict for UIDs not in the index. Defaults to 'deny' when `allow` is given, otherwise 'allow'.
+   * @returns {Promise<{ path: string, entries: number, slots: number, defaultVerdict: string }>}
+   */
+  buildUidIndex: addon.buildUidIndex,
+
+  /**
+   * Memory-maps a UID index file and makes it the active index. The file is validated and paged in
+   * on a worker thread and then swapped in atomically, so a running listener is never blocked and the
+   * previous index is unmapped once no lookup uses it. The index is shared by the whole process
+   * (including worker threads). To update it, write a new file with buildUidIndex() and load it again.
+   * @param {string} path
+   * @returns {Promise<{ path: string, entries: number, slots: number, defaultVerdict: string }>}
+   */
+  loadUidIndex: addon.loadUidIndex,
+
+  /**
+   * Removes the active UID index; card events are then delivered with a null verdict.
+   */
+  unloadUidIndex: addon.unloadUidIndex,
+
+  /**
+   * Looks a UID up in the active index, as the listener does for every card.
+   * @param {Buffer | string} uid - The UID as a Buffer or hex string.
+   * @returns {'allow' | 'deny' | null} null if no index is loaded.
+   */
+  lookupUid: addon.lookupUid,
+
+  /**
+   * Returns the active index and the listener's verdict counters since it was loaded, or null.
+   * @returns {{ path: string, entries: number, slots: number, defaultVerdict: string, allowed: number, denied: number } | null}
+   */
+  getUidIndexInfo: addon.getUidIndexInfo,
+
+  /**
+   * Starts recording every card event read by the listener into an append-only binary journal.
+   * The listener only pushes a fixed-size record into a lock-free queue; a background thread writes
+   * the records into preallocated, memory-mapped segment files ("taps-<sequence>.jnl") in `directory`,
+   * starting a new segment when one is full. Each record holds the timestamp, reader name, UID, ATR,
+   * status word of the UID read, detection-to-record latency and UID index verdict.
+   * The journal is shared by the whole process (including worker threads), like the UID index.
+   * @param {string} directory - Created if it does not exist. Segments of earlier runs are kept; numbering continues after them.
+   * @param {object} [options]
+   * @param {number} [options.segmentSize=8388608] - Bytes preallocated per segment (64 KiB to 1 GiB). A closed segment is truncated to its used size.
+   * @param {number} [options.maxSegments=0] - Keep at most this many segments, deleting the oldest (0 = keep all).
+   * @param {number} [options.queueSize=4096] - Capacity of the native record queue. Records that do not fit are counted in getJournalInfo().dropped.
+   * @returns {Promise<{ directory: string, segment: string, segmentSize: number, segmentBytes: number, written: number, dropped: number, failed: number }>}
+   */
+  openJournal: addon.openJournal,
+
+  /**
+   * Writes the queued records, closes the current segment and stops the journal.
+   * @returns {Promise<boolean>} false if no journal was open.
+   */
+  closeJournal: addon.closeJournal,
+
+  /**
+   * Returns the open journal's current segment and counters, or null.
+   * @returns {{ directory: string, segment: string, segmentSize: number, segmentBytes: number, written: number, dropped: number, failed: number } | null}
+   */
+  getJournalInfo: addon.getJournalInfo,
+
+  /**
+   * Scans a journal directory off the event loop and returns its records, oldest first.
+   * The segment being written can be read while the journal is open; a damaged or
+   * half-written record ends the scan of its segment.
+   * @param {string} directory
+   * @param {object} [options]
+   * @param {number} [options.since] - Only records at or after this time (milliseconds since the epoch, as Date.now()).
+   * @param {number} [options.until] - Only records at or before this time.
+   * @param {string} [options.readerName] - Only records from this reader.
+   * @param {number} [options.limit] - Stop after this many records.
+   * @returns {Promise<{ timestamp: number, readerName: string, uid: Buffer, atr: Buffer, sw: number, latencyUs: number, verdict: 'allow' | 'deny' | null, segment: number }[]>}
+   */
+  readJournal: addon.readJournal,
+
+  /**
+   * Opens a persistent connection to the card in the specified reader.
+   * @param {string} readerName - The name of the reader to connect to.
+   * @returns {Promise<CardSession>} A Promise that resolves with an open session. The Promise rejects if the connection fails.
+   */
+  openSession: (readerName) => addon.openSession(readerName).then((id) => new CardSession(id, readerName)),
+
+  /**
+   * Selects the PC/SC backend used by all subsequent calls.
+   * 'system' talks to Winscard / PCSC-lite; 'simulated' uses the in-process virtual readers scripted via `simulator`.
+   * The backend is shared by every worker thread that loads the addon.
+   * @param {'system' | 'simulated'} name - The backend to use.
+   * @throws {Error} If a listener is running, sessions are open or transmits are pending in any worker thread.
+   */
+  useBackend: addon.useBackend,
+
+  /**
+   * Returns the name of the active PC/SC backend.
+   * @returns {'system' | 'simulated'}
+   */
+  getBackend: addon.getBackend,
+
+  /**
+   * Scripting interface of the simulated backend (see useBackend('simulated')).
+   * Reader and card changes wake the listener exactly like real PC/SC state changes.
+   */
+  simulator: {
+    /**
+     * Adds a virtual reader (a PnP reader-attached notification is raised).
+     * @param {string} readerName
+     */
+    addReader: addon.simAddReader,
+
+    /**
+     * Removes a virtual reader.
+     * @param {string} readerName
+     * @returns {boolean} false if the reader does not exist.
+     */
+    removeReader: addon.simRemoveReader,
+
+    /**
+     * Places a card on a virtual reader. GET UID (FF CA 00 00) is answered with the UID automatically;
+     * other commands are answered from `responses` (first entry whose command is a prefix of the APDU), otherwise 6D00.
+     * @param {string} readerName
+     * @param {{ uid: Buffer, atr?: Buffer, responses?: { command: Buffer, response: Buffer }[] }} card
+     * @returns {boolean} false if the reader does not exist.
+     */
+    insertCard: addon.simInsertCard,
+
+    /**
+     * Removes the card from a virtual reader. Open connections to it fail with SCARD_W_REMOVED_CARD.
+     * @param {string} readerName
+     * @returns {boolean} false if the reader does not exist or is empty.
+     */
+    removeCard: addon.simRemoveCard,
+
+    /**
+     * Adds a fixed delay to every call of an operation.
+     * @param {'establish' | 'listReaders' | 'statusChange' | 'connect' | 'transmit' | 'control'} operation
+     * @param {number} ms - Delay in milliseconds (fractions allowed).
+     */
+    setLatency: addon.simSetLatency,
+
+    /**
+     * Makes the next `count` calls of an operation fail with a PC/SC error code.
+     * @param {'establish' | 'listReaders' | 'statusChange' | 'connect' | 'transmit' | 'control'} operation
+     * @param {number} code - The PC/SC error code, e.g. 0x80100069 (SCARD_W_REMOVED_CARD).
+     * @param {number} [count=1]
+     */
+    injectError: addon.simInjectError,
+
+    /**
+     * Stops the virtual PC/SC service, as if pcscd was restarted: every context becomes invalid
+     * and calls fail with SCARD_E_NO_SERVICE until startService() is called.
+     */
+    stopService: addon.simStopService,
+
+    /**
+     * Starts the virtual PC/SC service again after stopService().
+     */
+    startService: addon.simStartService,
+
+    /**
+     * Removes all virtual readers and clears latencies and injected errors.
+     */
+    reset: addon.simReset
+  },
+
+  /**
+   * Runs the native microbenchmarks used by `npm run bench` (hex encoding, histogram recording,
+   * event queue push/pop and response chaining). Synchronous; blocks the event loop while running.
+   * @param {number} [iterations=1000000] - Iterations per benchmark.
+   * @returns {{ name: string, iterations: number, nsPerOp: number }[]}
+   */
+  runNativeBenchmarks: addon.runNativeBenchmarks,
+
+  CardSession
 };
 
 // Optional: Add simple wrappers around the functions
@@ -11,7 +11,17 @@
 #include <mutex>
 #include <iomanip> // std::hex, std::setw, std::setfill
 #include <cstring> // memset, strlen için
+#include <cstdio>  // snprintf
+#include <cerrno>  // errno (UID indeksi dosya hataları)
 #include <limits>  // numeric_limits
+#include <chrono>
+#include <algorithm> // std::min
+#include <utility>   // std::pair
+#include <map>
+#include <deque>
+#include <condition_variable>
+#include <random>    // std::random_device (DESFire RndA)
+#include <type_traits> // LogLine tamsayı biçimlendirme
 
 // === Platforma Özel Dahil Etmeler ve Tip Tanımları ===
 #ifdef _WIN32
@@ -21,6 +31,7 @@
     using SCardLong = LONG;
     using SCardByte = BYTE;
     using SCardDword = DWORD;
+    using SCardReaderState = SCARD_READERSTATEA; // char* okuyucu adları için ANSI versiyon
     // SCARDHANDLE ve SCARDCONTEXT winscard.h'de tanımlı
 #else // Linux veya macOS
     #include <PCSC/pcsclite.h> // Genellikle Homebrew veya sistem yolu
@@ -29,10 +40,16 @@
     #include <stdint.h>        // uint32_t vs. için
     #include <stdlib.h>        // free için (SCardFreeMemory yerine)
     #include <errno.h>         // Hata kodları için
+    #include <fcntl.h>         // open (UID indeksi ve tap günlüğü eşlemeleri)
+    #include <sys/mman.h>      // mmap, msync
+    #include <sys/stat.h>      // fstat, mkdir
+    #include <unistd.h>        // close, ftruncate
+    #include <dirent.h>        // opendir (tap günlüğü segmentleri)
 
     using SCardLong = long;            // PCSC-lite genellikle long döner
     using SCardByte = unsigned char;   // Standart byte tanımı
     using SCardDword = uint32_t;       // Standart 32-bit unsigned
+    using SCardReaderState = SCARD_READERSTATE;
     // SCARDHANDLE ve SCARDCONTEXT pcsclite.h'de tanımlı
 
     // SCARD_AUTOALLOCATE Windows'a özel, PCSC-lite'da yok.
@@ -43,599 +60,6925 @@
     // Bu kodda ANSI/char* kullandığımız için PCSC-lite ile uyumlu olmalı.
 #endif
 
+// PC/SC Part 10 özellik sorgusu; winsmcrd.h bunu tanımlamaz (PCSC-lite reader.h'de tanımlı)
+#ifndef CM_IOCTL_GET_FEATURE_REQUEST
+    #define CM_IOCTL_GET_FEATURE_REQUEST SCARD_CTL_CODE(3400)
+#endif
+
 namespace PcscAddon {
 
-    std::atomic<bool> g_running{false}; // Listener durumu
-    SCARDCONTEXT g_context = 0;         // Global PC/SC context
-    std::thread g_pollThread;           // Listener thread'i
+    // === PC/SC Arka Ucu ===
+    // Tüm PC/SC çağrıları bu arayüzden geçer. Varsayılan arka uç sistem kütüphanesidir
+    // (Winscard / PCSC-lite); testler ve benchmark'lar için süreç içi bir simülatör de vardır.
+
+    class PcscBackend {
+    public:
+        virtual ~PcscBackend() {}
+        virtual const char* Name() const = 0;
+        virtual SCardLong EstablishContext(SCARDCONTEXT* context) = 0;
+        virtual SCardLong ReleaseContext(SCARDCONTEXT context) = 0;
+        virtual SCardLong IsValidContext(SCARDCONTEXT context) = 0;
+        virtual SCardLong Cancel(SCARDCONTEXT context) = 0;
+        // Okuyucu yoksa SCARD_E_NO_READERS_AVAILABLE döner
+        virtual SCardLong ListReaders(SCARDCONTEXT context, std::vector<std::string>& names) = 0;
+        virtual SCardLong GetStatusChange(SCARDCONTEXT context, SCardDword timeoutMs,
+                                          SCardReaderState* states, SCardDword count) = 0;
+        virtual SCardLong Connect(SCARDCONTEXT context, const char* readerName, SCardDword shareMode,
+                                  SCardDword preferredProtocols, SCARDHANDLE* card, SCardDword* activeProtocol) = 0;
+        virtual SCardLong Reconnect(SCARDHANDLE card, SCardDword shareMode, SCardDword preferredProtocols,
+                                    SCardDword initialization, SCardDword* activeProtocol) = 0;
+        virtual SCardLong Disconnect(SCARDHANDLE card, SCardDword disposition) = 0;
+        virtual SCardLong Transmit(SCARDHANDLE card, const SCARD_IO_REQUEST* sendPci, const SCardByte* sendBuffer,
+                                   SCardDword sendLength, SCardByte* recvBuffer, SCardDword* recvLength) = 0;
+        // Okuyucu sürücüsüne kontrol kodu (IOCTL) gönderir; kart gerekmez (SCARD_SHARE_DIRECT bağlantı yeterli)
+        virtual SCardLong Control(SCARDHANDLE card, SCardDword controlCode, const SCardByte* inBuffer, SCardDword inLength,
+                                  SCardByte* outBuffer, SCardDword outSize, SCardDword* outLength) = 0;
+        virtual SCardLong GetAttrib(SCARDHANDLE card, SCardDword attrId, SCardByte* buffer, SCardDword* length) = 0;
+    };
+
+    // Sistem PC/SC kütüphanesi. DWORD PCSC-lite'ta (Linux) unsigned long olduğundan
+    // çıktı parametreleri yerel DWORD değişkenler üzerinden aktarılır.
+    class SystemBackend : public PcscBackend {
+    public:
+        const char* Name() const override { return "system"; }
+
+        SCardLong EstablishContext(SCARDCONTEXT* context) override {
+            return SCardEstablishContext(SCARD_SCOPE_SYSTEM, NULL, NULL, context);
+        }
+
+        SCardLong ReleaseContext(SCARDCONTEXT context) override {
+            return SCardReleaseContext(context);
+        }
+
+        SCardLong IsValidContext(SCARDCONTEXT context) override {
+            return SCardIsValidContext(context);
+        }
+
+        SCardLong Cancel(SCARDCONTEXT context) override {
+            return SCardCancel(context);
+        }
+
+        SCardLong ListReaders(SCARDCONTEXT context, std::vector<std::string>& names) override {
+            names.clear();
+            char* readers = nullptr;
+            DWORD readersLen = 0;
+
+            #ifdef _WIN32
+                // Windows: SCARD_AUTOALLOCATE kullan
+                readersLen = SCARD_AUTOALLOCATE;
+                SCardLong rv = SCardListReadersA(context, NULL, (LPSTR)&readers, &readersLen);
+            #else
+                // PCSC-lite: İki adımlı işlem
+                // 1. Adım: Boyutu al
+                SCardLong rv = SCardListReaders(context, NULL, NULL, &readersLen);
+                if (rv == SCARD_S_SUCCESS && readersLen > 1) { // Boyut geçerliyse
+                     // 2. Adım: Belleği ayır ve okuyucuları al
+                     readers = new (std::nothrow) char[readersLen]; // Bellek ayırma hatasını kontrol et
+                     if (readers == nullptr) {
+                         rv = SCARD_E_NO_MEMORY;
+                     } else {
+                         rv = SCardListReaders(context, NULL, readers, &readersLen);
+                     }
+                }
+            #endif
+
+            if (rv == SCARD_S_SUCCESS && readers != nullptr && readersLen > 1) { // Multi-string buffer boş değilse
+                const char* currentReader = readers;
+                while (*currentReader != '\0') { // Son çift null'a kadar git
+                    names.emplace_back(currentReader);
+                    currentReader += strlen(currentReader) + 1;
+                }
+            }
+
+            // Ayrılan belleği serbest bırak
+            #ifdef _WIN32
+                if (readers != nullptr) SCardFreeMemory(context, readers);
+            #else
+                delete[] readers; // new[] ile ayrıldığı için delete[] ile sil
+            #endif
+            return rv;
+        }
+
+        SCardLong GetStatusChange(SCARDCONTEXT context, SCardDword timeoutMs,
+                                  SCardReaderState* states, SCardDword count) override {
+            #ifdef _WIN32
+                return SCardGetStatusChangeA(context, timeoutMs, states, count);
+            #else
+                return SCardGetStatusChange(context, timeoutMs, states, count);
+            #endif
+        }
+
+        SCardLong Connect(SCARDCONTEXT context, const char* readerName, SCardDword shareMode,
+                          SCardDword preferredProtocols, SCARDHANDLE* card, SCardDword* activeProtocol) override {
+            DWORD protocol = 0;
+            #ifdef _WIN32
+                SCardLong rv = SCardConnectA(context, readerName, shareMode, preferredProtocols, card, &protocol);
+            #else
+                SCardLong rv = SCardConnect(context, readerName, shareMode, preferredProtocols, card, &protocol);
+            #endif
+            *activeProtocol = static_cast<SCardDword>(protocol);
+            return rv;
+        }
+
+        SCardLong Reconnect(SCARDHANDLE card, SCardDword shareMode, SCardDword preferredProtocols,
+                            SCardDword initialization, SCardDword* activeProtocol) override {
+            DWORD protocol = 0;
+            SCardLong rv = SCardReconnect(card, shareMode, preferredProtocols, initialization, &protocol);
+            *activeProtocol = static_cast<SCardDword>(protocol);
+            return rv;
+        }
+
+        SCardLong Disconnect(SCARDHANDLE card, SCardDword disposition) override {
+            return SCardDisconnect(card, disposition);
+        }
+
+        SCardLong Transmit(SCARDHANDLE card, const SCARD_IO_REQUEST* sendPci, const SCardByte* sendBuffer,
+                           SCardDword sendLength, SCardByte* recvBuffer, SCardDword* recvLength) override {
+            DWORD length = *recvLength;
+            SCardLong rv = SCardTransmit(card, sendPci, sendBuffer, sendLength,
+                                         nullptr, // Yanıt için ek IO isteği yok
+                                         recvBuffer, &length);
+            *recvLength = static_cast<SCardDword>(length);
+            return rv;
+        }
+
+        SCardLong Control(SCARDHANDLE card, SCardDword controlCode, const SCardByte* inBuffer, SCardDword inLength,
+                          SCardByte* outBuffer, SCardDword outSize, SCardDword* outLength) override {
+            DWORD length = 0;
+            SCardLong rv = SCardControl(card, controlCode, inBuffer, inLength, outBuffer, outSize, &length);
+            *outLength = static_cast<SCardDword>(length);
+            return rv;
+        }
+
+        SCardLong GetAttrib(SCARDHANDLE card, SCardDword attrId, SCardByte* buffer, SCardDword* length) override {
+            DWORD attribLength = *length;
+            SCardLong rv = SCardGetAttrib(card, attrId, buffer, &attribLength);
+            *length = static_cast<SCardDword>(attribLength);
+            return rv;
+        }
+    };
+
+    // Okuyucu takma/çıkarma bildirimleri için PC/SC sahte okuyucusu (Windows ve PCSC-lite)
+    const char* const kPnpNotificationReader = "\\\\?PnP?\\Notification";
+
+    // Simülatörde gecikme ve hata enjekte edilebilen işlemler (dizi indeksi olarak kullanılır)
+    enum SimOp {
+        kSimEstablish,
+        kSimListReaders,
+        kSimStatusChange,
+        kSimConnect,
+        kSimTransmit,
+        kSimControl,   // SCardControl / SCardGetAttrib ve SCARD_SHARE_DIRECT bağlantılar
+        kSimOpCount
+    };
+    const char* const kSimOpNames[kSimOpCount] = { "establish", "listReaders", "statusChange", "connect", "transmit", "control" };
+
+    // Süreç içi sanal okuyucular. Okuyucular/kartlar JS'ten betiklenir; durum değişiklikleri
+    // bekleyen SCardGetStatusChange çağrılarını gerçek PC/SC gibi uyandırır (olay sayacı dahil).
+    class SimulatedBackend : public PcscBackend {
+    public:
+        struct Card {
+            std::vector<SCardByte> uid;
+            std::vector<SCardByte> atr;
+            // Komut öneki -> yanıt (ilk eşleşen kullanılır). GET UID (FF CA 00 00) eşleşme yoksa otomatik yanıtlanır.
+            std::vector<std::pair<std::vector<SCardByte>, std::vector<SCardByte>>> responses;
+        };
+
+        const char* Name() const override { return "simulated"; }
+
+        // --- Betik API'si (JS thread'i) ---
+
+        void AddReader(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (FindReader(name)) return;
+            Reader reader;
+            reader.name = name;
+            readers.push_back(std::move(reader));
+            readerListVersion++;
+            changed.notify_all();
+        }
+
+        bool RemoveReader(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = readers.begin(); it != readers.end(); ++it) {
+                if (it->name == name) {
+                    readers.erase(it);
+                    readerListVersion++;
+                    changed.notify_all();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool InsertCard(const std::string& readerName, Card card) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Reader* reader = FindReader(readerName);
+            if (!reader) return false;
+            reader->card = std::move(card);
+            reader->hasCard = true;
+            reader->cardGeneration++;
+            reader->eventCount++;
+            changed.notify_all();
+            return true;
+        }
+
+        bool RemoveCard(const std::string& readerName) {
+            std::lock_guard<std::mutex> lock(mutex);
+            Reader* reader = FindReader(readerName);
+            if (!reader || !reader->hasCard) return false;
+            reader->hasCard = false;
+            reader->eventCount++;
+            changed.notify_all();
+            return true;
+        }
+
+        void SetLatency(SimOp op, std::chrono::microseconds latency) {
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies[op] = latency;
+        }
+
+        // İşlemin sonraki count çağrısı rv ile başarısız olur
+        void InjectError(SimOp op, SCardLong rv, uint32_t count) {
+            std::lock_guard<std::mutex> lock(mutex);
+            faults[op] = Fault{ rv, count };
+        }
+
+        // pcscd'nin durmasını taklit eder: tüm context ve bağlantılar geçersizleşir, servis yeniden
+        // başlatılana kadar her çağrı SCARD_E_NO_SERVICE döner
+        void StopService() {
+            std::lock_guard<std::mutex> lock(mutex);
+            serviceRunning = false;
+            contexts.clear();
+            handles.clear();
+            changed.notify_all();
+        }
+
+        void StartService() {
+            std::lock_guard<std::mutex> lock(mutex);
+            serviceRunning = true;
+        }
+
+        // Okuyucuları, kartları, gecikmeleri ve hataları temizler (context'ler korunur)
+        void Reset() {
+            std::lock_guard<std::mutex> lock(mutex);
+            serviceRunning = true;
+            readers.clear();
+            handles.clear();
+            readerListVersion++;
+            for (int op = 0; op < kSimOpCount; op++) {
+                latencies[op] = std::chrono::microseconds(0);
+                faults[op] = Fault();
+            }
+            changed.notify_all();
+        }
+
+        // --- PcscBackend ---
+
+        SCardLong EstablishContext(SCARDCONTEXT* context) override {
+            SCardLong rv = Enter(kSimEstablish);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            std::lock_guard<std::mutex> lock(mutex);
+            *context = static_cast<SCARDCONTEXT>(nextId++);
+            contexts[*context] = 0;
+            return SCARD_S_SUCCESS;
+        }
+
+        SCardLong ReleaseContext(SCARDCONTEXT context) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (contexts.erase(context) == 0) return SCARD_E_INVALID_HANDLE;
+            changed.notify_all(); // Bu context üzerinde bekleyenler uyanıp hata döner
+            return SCARD_S_SUCCESS;
+        }
+
+        SCardLong IsValidContext(SCARDCONTEXT context) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            return contexts.count(context) ? SCARD_S_SUCCESS : SCARD_E_INVALID_HANDLE;
+        }
+
+        SCardLong Cancel(SCARDCONTEXT context) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = contexts.find(context);
+            if (it == contexts.end()) return SCARD_E_INVALID_HANDLE;
+            it->second++; // İptal sayacı
+            changed.notify_all();
+            return SCARD_S_SUCCESS;
+        }
+
+        SCardLong ListReaders(SCARDCONTEXT context, std::vector<std::string>& names) override {
+            names.clear();
+            SCardLong rv = Enter(kSimListReaders);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (contexts.find(context) == contexts.end()) return SCARD_E_INVALID_HANDLE;
+            for (const auto& reader : readers) names.push_back(reader.name);
+            return names.empty() ? SCARD_E_NO_READERS_AVAILABLE : SCARD_S_SUCCESS;
+        }
+
+        SCardLong GetStatusChange(SCARDCONTEXT context, SCardDword timeoutMs,
+                                  SCardReaderState* states, SCardDword count) override {
+            SCardLong rv = Enter(kSimStatusChange);
+            if (rv != SCARD_S_SUCCESS) return rv;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            auto it = contexts.find(context);
+            if (it == contexts.end()) return SCARD_E_INVALID_HANDLE;
+            uint64_t cancelCount = it->second;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+            while (true) {
+                bool anyChanged = false;
+                for (SCardDword i = 0; i < count; i++) {
+                    anyChanged |= UpdateReaderState(states[i]);
+                }
+                if (anyChanged) return SCARD_S_SUCCESS;
+
+                it = contexts.find(context);
+                if (it == contexts.end()) return serviceRunning ? SCARD_E_INVALID_HANDLE : SCARD_E_NO_SERVICE;
+                if (it->second != cancelCount) return SCARD_E_CANCELLED;
+
+                if (timeoutMs == 0xFFFFFFFF) { // INFINITE
+                    changed.wait(lock);
+                } else if (changed.wait_until(lock, deadline) == std::cv_status::timeout) {
+                    for (SCardDword i = 0; i < count; i++) {
+                        if (UpdateReaderState(states[i])) return SCARD_S_SUCCESS;
+                    }
+                    return SCARD_E_TIMEOUT;
+                }
+            }
+        }
+
+        SCardLong Connect(SCARDCONTEXT context, const char* readerName, SCardDword shareMode,
+                          SCardDword preferredProtocols, SCARDHANDLE* card, SCardDword* activeProtocol) override {
+            // Doğrudan bağlantılar kontrol işlemi sayılır; kart bağlantısına enjekte edilen hataları tüketmez
+            bool direct = shareMode == SCARD_SHARE_DIRECT;
+            SCardLong rv = Enter(direct ? kSimControl : kSimConnect);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (contexts.find(context) == contexts.end()) return SCARD_E_INVALID_HANDLE;
+            Reader* reader = FindReader(readerName);
+            if (!reader) return SCARD_E_UNKNOWN_READER;
+            if (direct) {
+                *card = static_cast<SCARDHANDLE>(nextId++);
+                handles[*card] = Handle{ reader->name, reader->cardGeneration };
+                *activeProtocol = SCARD_PROTOCOL_UNDEFINED;
+                return SCARD_S_SUCCESS;
+            }
+            if (!reader->hasCard) return SCARD_E_NO_SMARTCARD;
+            if (!(preferredProtocols & SCARD_PROTOCOL_T1)) return SCARD_E_PROTO_MISMATCH;
+
+            *card = static_cast<SCARDHANDLE>(nextId++);
+            handles[*card] = Handle{ reader->name, reader->cardGeneration };
+            *activeProtocol = SCARD_PROTOCOL_T1;
+            return SCARD_S_SUCCESS;
+        }
+
+        SCardLong Reconnect(SCARDHANDLE card, SCardDword /*shareMode*/, SCardDword /*preferredProtocols*/,
+                            SCardDword /*initialization*/, SCardDword* activeProtocol) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = handles.find(card);
+            if (it == handles.end()) return SCARD_E_INVALID_HANDLE;
+            Reader* reader = FindReader(it->second.readerName);
+            if (!reader) return SCARD_E_READER_UNAVAILABLE;
+            if (!reader->hasCard) return SCARD_E_NO_SMARTCARD;
+            it->second.cardGeneration = reader->cardGeneration;
+            *activeProtocol = SCARD_PROTOCOL_T1;
+            return SCARD_S_SUCCESS;
+        }
+
+        SCardLong Disconnect(SCARDHANDLE card, SCardDword /*disposition*/) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            return handles.erase(card) ? SCARD_S_SUCCESS : SCARD_E_INVALID_HANDLE;
+        }
+
+        SCardLong Transmit(SCARDHANDLE card, const SCARD_IO_REQUEST* /*sendPci*/, const SCardByte* sendBuffer,
+                           SCardDword sendLength, SCardByte* recvBuffer, SCardDword* recvLength) override {
+            SCardLong rv = Enter(kSimTransmit);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = handles.find(card);
+            if (it == handles.end()) return SCARD_E_INVALID_HANDLE;
+            Reader* reader = FindReader(it->second.readerName);
+            if (!reader) return SCARD_E_READER_UNAVAILABLE;
+            if (!reader->hasCard || reader->cardGeneration != it->second.cardGeneration) return SCARD_W_REMOVED_CARD;
+
+            const std::vector<SCardByte>* response = nullptr;
+            for (const auto& entry : reader->card.responses) {
+                const std::vector<SCardByte>& prefix = entry.first;
+                if (prefix.size() <= sendLength && std::equal(prefix.begin(), prefix.end(), sendBuffer)) {
+                    response = &entry.second;
+                    break;
+                }
+            }
+            std::vector<SCardByte> generated;
+            if (!response) {
+                static const SCardByte kGetUid[] = { 0xFF, 0xCA, 0x00, 0x00 };
+                if (sendLength >= 4 && std::equal(kGetUid, kGetUid + 4, sendBuffer)) {
+                    generated = reader->card.uid;
+                    generated.push_back(0x90);
+                    generated.push_back(0x00);
+                } else {
+                    generated.push_back(0x6D); // INS desteklenmiyor
+                    generated.push_back(0x00);
+                }
+                response = &generated;
+            }
+
+            if (response->size() > *recvLength) return SCARD_E_INSUFFICIENT_BUFFER;
+            if (!response->empty()) memcpy(recvBuffer, response->data(), response->size());
+            *recvLength = static_cast<SCardDword>(response->size());
+            return SCARD_S_SUCCESS;
+        }
+
+        // Sanal okuyucular CCID gibi davranır: özellik sorgusu yalnızca FEATURE_CCID_ESC_COMMAND'ı bildirir,
+        // escape komutu girdisini aynen geri döner
+        SCardLong Control(SCARDHANDLE card, SCardDword controlCode, const SCardByte* inBuffer, SCardDword inLength,
+                          SCardByte* outBuffer, SCardDword outSize, SCardDword* outLength) override {
+            *outLength = 0;
+            SCardLong rv = Enter(kSimControl);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = handles.find(card);
+            if (it == handles.end()) return SCARD_E_INVALID_HANDLE;
+            if (!FindReader(it->second.readerName)) return SCARD_E_READER_UNAVAILABLE;
+
+            std::vector<SCardByte> output;
+            if (controlCode == static_cast<SCardDword>(CM_IOCTL_GET_FEATURE_REQUEST)) {
+                SCardDword escapeCode = static_cast<SCardDword>(SCARD_CTL_CODE(kSimEscapeCode));
+                output = { 0x13, 4, // FEATURE_CCID_ESC_COMMAND
+                           static_cast<SCardByte>(escapeCode >> 24), static_cast<SCardByte>(escapeCode >> 16),
+                           static_cast<SCardByte>(escapeCode >> 8), static_cast<SCardByte>(escapeCode) };
+            } else if (controlCode == static_cast<SCardDword>(SCARD_CTL_CODE(kSimEscapeCode))) {
+                output.assign(inBuffer, inBuffer + inLength);
+            } else {
+                return SCARD_E_UNSUPPORTED_FEATURE;
+            }
+
+            if (output.size() > outSize) return SCARD_E_INSUFFICIENT_BUFFER;
+            if (!output.empty()) memcpy(outBuffer, output.data(), output.size());
+            *outLength = static_cast<SCardDword>(output.size());
+            return SCARD_S_SUCCESS;
+        }
+
+        SCardLong GetAttrib(SCARDHANDLE card, SCardDword attrId, SCardByte* buffer, SCardDword* length) override {
+            SCardLong rv = Enter(kSimControl);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = handles.find(card);
+            if (it == handles.end()) return SCARD_E_INVALID_HANDLE;
+            if (!FindReader(it->second.readerName)) return SCARD_E_READER_UNAVAILABLE;
+            if (attrId != static_cast<SCardDword>(SCARD_ATTR_VENDOR_NAME)) return SCARD_E_UNSUPPORTED_FEATURE;
+
+            static const char kVendor[] = "Simulated";
+            if (*length < sizeof(kVendor)) return SCARD_E_INSUFFICIENT_BUFFER;
+            memcpy(buffer, kVendor, sizeof(kVendor));
+            *length = static_cast<SCardDword>(sizeof(kVendor));
+            return SCARD_S_SUCCESS;
+        }
+
+        static const SCardDword kSimEscapeCode = 3500; // SCARD_CTL_CODE(3500): yaygın CCID escape kodu
+
+    private:
+        struct Reader {
+            std::string name;
+            bool hasCard = false;
+            Card card;
+            uint64_t cardGeneration = 0; // Her kart takılışında artar; eski bağlantılar SCARD_W_REMOVED_CARD alır
+            SCardDword eventCount = 0;   // dwEventState'in üst 16 biti
+        };
+        struct Handle {
+            std::string readerName;
+            uint64_t cardGeneration;
+        };
+        struct Fault {
+            SCardLong rv = SCARD_S_SUCCESS;
+            uint32_t remaining = 0;
+        };
+
+        Reader* FindReader(const std::string& name) {
+            for (auto& reader : readers) {
+                if (reader.name == name) return &reader;
+            }
+            return nullptr;
+        }
+
+        // İşlem girişi: ayarlı gecikmeyi uygular, enjekte edilmiş hatayı tüketir
+        SCardLong Enter(SimOp op) {
+            std::chrono::microseconds latency;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!serviceRunning) return SCARD_E_NO_SERVICE;
+                latency = latencies[op];
+                if (faults[op].remaining > 0) {
+                    faults[op].remaining--;
+                    return faults[op].rv;
+                }
+            }
+            if (latency.count() > 0) std::this_thread::sleep_for(latency);
+            return SCARD_S_SUCCESS;
+        }
+
+        // Okuyucunun gerçek durumunu dwEventState'e yazar; dwCurrentState'ten farklıysa true. mutex tutulmalıdır.
+        bool UpdateReaderState(SCardReaderState& state) {
+            SCardDword current = state.dwCurrentState;
+            SCardDword event;
+            bool stateChanged;
+            if (strcmp(state.szReader, kPnpNotificationReader) == 0) {
+                // PnP sözde okuyucusu: okuyucu listesi değiştikçe olay sayacı artar
+                SCardDword counter = static_cast<SCardDword>(readerListVersion & 0xFFFF);
+                event = counter << 16;
+                stateChanged = ((current >> 16) & 0xFFFF) != counter;
+            } else if (const Reader* reader = FindReader(state.szReader)) {
+                SCardDword presence = reader->hasCard ? SCARD_STATE_PRESENT : SCARD_STATE_EMPTY;
+                SCardDword counter = reader->eventCount & 0xFFFF;
+                event = presence | (counter << 16);
+                stateChanged = (current & (SCARD_STATE_PRESENT | SCARD_STATE_EMPTY)) != presence
+                            || ((current >> 16) & 0xFFFF) != counter;
+                state.cbAtr = 0;
+                if (reader->hasCard) {
+                    size_t atrLength = std::min(reader->card.atr.size(), sizeof(state.rgbAtr));
+                    if (atrLength > 0) memcpy(state.rgbAtr, reader->card.atr.data(), atrLength);
+                    state.cbAtr = static_cast<SCardDword>(atrLength);
+                }
+            } else {
+                event = SCARD_STATE_UNKNOWN | SCARD_STATE_UNAVAILABLE;
+                stateChanged = !(current & SCARD_STATE_UNKNOWN);
+            }
+            state.dwEventState = event | (stateChanged ? SCARD_STATE_CHANGED : 0);
+            return stateChanged;
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool serviceRunning = true;
+        std::vector<Reader> readers;
+        uint64_t readerListVersion = 0;
+        std::map<SCARDCONTEXT, uint64_t> contexts;  // Context -> iptal sayacı
+        std::map<SCARDHANDLE, Handle> handles;
+        uint64_t nextId = 0x1000;
+        std::chrono::microseconds latencies[kSimOpCount] = {};
+        Fault faults[kSimOpCount];
+    };
+
+    SystemBackend g_systemBackend;
+    SimulatedBackend g_simulatedBackend;
+    std::atomic<PcscBackend*> g_backend{&g_systemBackend}; // Sadece dinleyici/oturum/iş yokken değiştirilir
+
+    inline PcscBackend& Backend() { return *g_backend.load(); }
+
+
+    // Bir PC/SC context'i ve onu kuran arka uç. pcsc-lite aynı context üzerindeki çağrıları sıralar ve
+    // SCardCancel context'teki tüm bekleyen çağrıları iptal eder; bu yüzden paralel çalışan her kullanıcı
+    // kendi context'ini tutar: JS thread'i, dinleyici thread'i, havuz thread'leri ve açık oturumlar.
+    struct ContextSlot {
+        std::atomic<SCARDCONTEXT> context{0};      // 0: kurulmamış veya kaybedildi
+        std::atomic<PcscBackend*> backend{nullptr}; // Context'i kuran arka uç
+        bool announce = false;                      // Kurulunca bilgi mesajı yazılır (JS thread'inin slotu)
+    };
+
+    // Oturumların context'leri için küçük havuz: kapanan oturumun context'i bir sonraki oturuma kalır,
+    // böylece her openSession() için servise gidip yeni context kurulmaz
+    class ContextPool {
+    public:
+        static const size_t kMaxIdle = 4;
+
+        std::unique_ptr<ContextSlot> Acquire();
+        void Release(std::unique_ptr<ContextSlot> slot);
+        void Clear(); // Boştaki context'leri bırakır
+
+    private:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ContextSlot>> idle;
+    };
+
+    ContextPool g_contextPool;
+    std::mutex g_contextMutex;     // Context kurma/bırakma işlemlerini ve geri çekilmeyi sıralar
+    thread_local ContextSlot* t_threadContext = nullptr; // Havuz thread'inin kendi context'i
+
+    struct ListenerEventQueue; // Dinleyici olay kuyruğu (aşağıda tanımlı)
+    struct ListenerCommandQueue; // Çalışan dinleyiciye giden güncellemeler (aşağıda tanımlı)
+    struct ReaderStats;        // Okuyucu başına ölçümler (aşağıda tanımlı)
+    struct AddonInstance;      // Ortam başına eklenti durumu (aşağıda tanımlı)
+    struct DesfireSecureChannel; // DESFire EV2 oturum anahtarları (aşağıda tanımlı)
+
+    // Aktif dinleyici bilgileri
+    struct ListenerInfo {
+        AddonInstance* instance = nullptr;    // Dinleyiciyi başlatan ortam (durum bayrağı ve context)
+        std::vector<std::string> readerNames; // İzlenecek okuyucular
+        bool watchAll = false;                // true ise bağlı tüm okuyucular izlenir
+        std::shared_ptr<ListenerEventQueue> events;    // JS callback'lerine giden olaylar
+        std::shared_ptr<ListenerCommandQueue> commands; // updateListener() komutları
+        std::vector<std::vector<SCardByte>> program;   // Kart algılanınca UID'den sonra çalıştırılan APDU'lar
+        bool programStopOnError = false;               // SW != 9000 olunca programı durdur
+        std::chrono::milliseconds sameUidCooldown{0};  // Kaldırılan kartın aynı UID ile tekrar raporlanması için bekleme
+    };
+
+    // Birden fazla transmit arasında açık tutulan kart bağlantısı
+    struct CardSession {
+        uint32_t id = 0;
+        std::string readerName;
+        SCARDHANDLE hCard = 0;
+        SCardDword activeProtocol = 0;
+        ReaderStats* stats = nullptr;
+        std::unique_ptr<ContextSlot> slot; // Oturumun kendi context'i (havuzdan)
+        std::mutex mutex;    // Aynı oturum üzerindeki işlemleri sıralar
+        bool closed = false;
+        uint32_t reconnects = 0;  // Kart resetlenip yeniden bağlanınca artar (kart tarafındaki kimlik doğrulaması düşer)
+        std::shared_ptr<DesfireSecureChannel> secureChannel; // desfire() ile kurulan EV2 kanalı, yoksa nullptr
+
+        ~CardSession() {
+            g_contextPool.Release(std::move(slot));
+        }
+
+        // Kart bağlantısını kapatır ve context'i havuza bırakır. Çağıran mutex'i tutmalıdır.
+        void Disconnect() {
+            if (closed) return;
+            closed = true;
+            secureChannel.reset();
+            if (hCard != 0) {
+                Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+                hCard = 0;
+            }
+            g_contextPool.Release(std::move(slot));
+        }
+    };
+
+    // Son bilinen okuyucu listesi; listener PnP bildirimleriyle güncel tutar, JS'e IPC'siz sunulur
+    std::mutex g_readerCacheMutex;
+    std::vector<std::string> g_cachedReaders;
+
+    // === Kilitsiz Halka Tamponlar ===
+
+    // Tek üretici / tek tüketici kilitsiz halka tampon. Kapasite 2'nin kuvvetine yuvarlanır.
+    // Slotlar önceden ayrılır; üretici slotu yerinde doldurur, olay başına malloc yapılmaz.
+    template <typename T>
+    class SpscRing {
+    public:
+        explicit SpscRing(size_t requestedCapacity) {
+            size_t capacity = 2;
+            while (capacity < requestedCapacity) capacity <<= 1;
+            slots.reset(new T[capacity]);
+            mask = capacity - 1;
+        }
+
+        size_t Capacity() const { return mask + 1; }
+        size_t Size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+        // Üretici: yazılacak boş slot, kuyruk doluysa nullptr
+        T* BeginPush() {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) > mask) return nullptr;
+            return &slots[h & mask];
+        }
+        // Üretici: BeginPush ile doldurulan slotu tüketiciye yayınlar
+        void CommitPush() {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Tüketici: en eski slot, kuyruk boşsa nullptr
+        T* Front() {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) return nullptr;
+            return &slots[t & mask];
+        }
+        // Tüketici: Front ile okunan slotu üreticiye geri verir
+        void Pop() {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        std::unique_ptr<T[]> slots;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> head{0}; // Sadece üretici yazar
+        alignas(64) std::atomic<size_t> tail{0}; // Sadece tüketici yazar
+    };
+
+    // Sınırlı çok üreticili / tek tüketicili halka (Vyukov): tap günlüğü (her worker'ın dinleyicisi yazar) ve
+    // dinleyici komut kuyruğu için
+    template <typename T>
+    class MpscRing {
+    public:
+        explicit MpscRing(size_t requestedCapacity) {
+            size_t capacity = 2;
+            while (capacity < requestedCapacity) capacity <<= 1;
+            cells.reset(new Cell[capacity]);
+            for (size_t i = 0; i < capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+            mask = capacity - 1;
+        }
+
+        size_t Capacity() const { return mask + 1; }
+
+        // Üretici: kopyalayarak ekler; kuyruk doluysa false
+        bool TryPush(const T& value) {
+            size_t position = head.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0) {
+                    if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Tüketici: en eski dolu slot, kuyruk boşsa (veya sıradaki yazım bitmediyse) nullptr
+        T* Front() {
+            Cell& cell = cells[tail & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != tail + 1) return nullptr;
+            return &cell.value;
+        }
+        // Tüketici: Front ile okunan slotu üreticilere geri verir
+        void Pop() {
+            cells[tail & mask].sequence.store(tail + mask + 1, std::memory_order_release);
+            tail++;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence{0};
+            T value;
+        };
+        std::unique_ptr<Cell[]> cells;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) size_t tail = 0; // Sadece tüketici
+    };
+
+
+    // === Günlük Kaydı (Seviyeli, Asenkron) ===
+    // Mesaj yazan thread'de sabit boyutlu bir kayda biçimlenir ve o thread'in kilitsiz halkasına itilir; konsola
+    // (stdout / stderr) ve JS sink'lerine arka plan thread'i kısa aralıklarla yazar. Böylece kart algılama yolu
+    // kilitli bir akışa hiç yazmaz. Halka doluysa kayıt düşürülür ve sayılır. Seviye kapalıysa mesaj biçimlenmez.
+
+    enum LogLevel : uint8_t { kLogOff, kLogError, kLogWarn, kLogInfo, kLogDebug };
+    const char* const kLogLevelNames[] = { "off", "error", "warn", "info", "debug" };
+    const char* const kLogPrefixes[] = { "", "ERROR: ", "WARN: ", "INFO: ", "DEBUG: " };
+
+    const size_t kMaxLogText = 240;
+    const size_t kLogThreadRingSize = 256;  // Thread başına bekleyen kayıt
+    const size_t kLogSinkRingSize = 1024;   // JS sink'i başına iletilmeyi bekleyen kayıt
+    const auto kLogFlushInterval = std::chrono::milliseconds(50);
+
+    struct LogRecord {
+        int64_t timestampUs = 0;    // system_clock (JS Date ile karşılaştırılabilir)
+        LogLevel level = kLogInfo;
+        uint16_t length = 0;
+        char text[kMaxLogText];
+    };
+
+    std::atomic<int> g_logLevel{kLogInfo};
+    std::atomic<bool> g_logConsole{true};
+    std::atomic<bool> g_logFlusherRunning{false}; // false: kayıtlar çağıran thread'de doğrudan konsola yazılır
+    std::atomic<int> g_logActiveWriters{0};       // Bayrağı true görüp halkasına yazmakta olan thread'ler
+    std::atomic<uint64_t> g_logRecords{0};
+    std::atomic<uint64_t> g_logDropped{0};
+
+    inline bool LogEnabled(LogLevel level) {
+        return level <= g_logLevel.load(std::memory_order_relaxed);
+    }
+
+    // Tek bir thread'in kayıtları; üretici sahibi thread, tüketici yazıcı thread'idir
+    struct LogThreadBuffer {
+        SpscRing<LogRecord> ring{kLogThreadRingSize};
+        std::atomic<bool> exited{false}; // Thread sonlandı; boşaltılınca listeden çıkarılır
+    };
+
+    std::mutex g_logBuffersMutex;
+    std::vector<std::shared_ptr<LogThreadBuffer>> g_logBuffers;
+
+    struct LogThreadHandle {
+        std::shared_ptr<LogThreadBuffer> buffer;
+        ~LogThreadHandle() {
+            if (buffer) buffer->exited.store(true, std::memory_order_release);
+        }
+    };
+    thread_local LogThreadHandle t_logBuffer;
+
+    // Thread'in halkası; ilk kayıtta oluşturulup kaydedilir (thread başına bir kez kilit)
+    LogThreadBuffer& ThreadLogBuffer() {
+        if (!t_logBuffer.buffer) {
+            t_logBuffer.buffer = std::make_shared<LogThreadBuffer>();
+            std::lock_guard<std::mutex> lock(g_logBuffersMutex);
+            g_logBuffers.push_back(t_logBuffer.buffer);
+        }
+        return *t_logBuffer.buffer;
+    }
+
+    void WriteLogToConsole(const LogRecord& record) {
+        std::ostream& stream = record.level <= kLogWarn ? std::cerr : std::cout;
+        stream << kLogPrefixes[record.level];
+        stream.write(record.text, record.length);
+        stream << '\n';
+    }
+
+    // Yazıcı thread'i çalışmıyorsa (modül başlatılırken / kapanırken) kayıt doğrudan yazılır
+    void SubmitLogRecord(LogRecord& record) {
+        record.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        // Sayaç bayraktan önce artırılır: StopLogger bayrağı indirdikten sonra sayacın sıfırlanmasını bekler,
+        // böylece true görüp yazan hiçbir thread son boşaltmadan sonra halkada kayıt bırakmaz
+        g_logActiveWriters.fetch_add(1);
+        if (!g_logFlusherRunning.load()) {
+            g_logActiveWriters.fetch_sub(1, std::memory_order_release);
+            g_logRecords.fetch_add(1, std::memory_order_relaxed);
+            if (g_logConsole.load(std::memory_order_relaxed)) {
+                WriteLogToConsole(record);
+                (record.level <= kLogWarn ? std::cerr : std::cout).flush();
+            }
+            return;
+        }
+        SpscRing<LogRecord>& ring = ThreadLogBuffer().ring;
+        LogRecord* slot = ring.BeginPush();
+        if (slot) {
+            slot->timestampUs = record.timestampUs;
+            slot->level = record.level;
+            slot->length = record.length;
+            memcpy(slot->text, record.text, record.length);
+            ring.CommitPush();
+        } else {
+            g_logDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        g_logActiveWriters.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Tek satırlık kayıt; akış gibi doldurulur, ifade sonunda yıkılırken gönderilir. Yığın ayırmaz,
+    // kilit almaz; sığmayan metin kısaltılır.
+    class LogLine {
+    public:
+        explicit LogLine(LogLevel level) { record.level = level; }
+        ~LogLine() { SubmitLogRecord(record); }
+
+        LogLine& operator<<(const char* text) { return Append(text, strlen(text)); }
+        LogLine& operator<<(const std::string& text) { return Append(text.data(), text.size()); }
+        LogLine& operator<<(char c) { return Append(&c, 1); }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, LogLine&>::type operator<<(T value) {
+            char digits[24];
+            int length = std::is_signed<T>::value || std::is_enum<T>::value
+                ? snprintf(digits, sizeof(digits), "%lld", static_cast<long long>(value))
+                : snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(value));
+            return Append(digits, static_cast<size_t>(std::max(length, 0)));
+        }
+
+    private:
+        LogLine& Append(const char* text, size_t length) {
+            length = std::min(length, kMaxLogText - record.length);
+            memcpy(record.text + record.length, text, length);
+            record.length = static_cast<uint16_t>(record.length + length);
+            return *this;
+        }
+
+        LogRecord record;
+    };
+
+    // Seviye kapalıysa satır hiç kurulmaz (argümanlar değerlendirilmez): PCSC_LOG(kLogInfo) << "..." << value;
+    #define PCSC_LOG(level) if (!::PcscAddon::LogEnabled(::PcscAddon::level)) {} else ::PcscAddon::LogLine(::PcscAddon::level)
+
+    // JS sink'i: yazıcı thread'i kayıtları halkaya ekler, JS thread'i tek bir NonBlockingCall ile toplu olarak
+    // boşaltır (dinleyici olay kuyruğu gibi). Her ortamın en fazla bir sink'i vardır.
+    struct LogSink {
+        LogSink() : ring(kLogSinkRingSize) {}
+
+        const AddonInstance* owner = nullptr;
+        SpscRing<LogRecord> ring;
+        Napi::ThreadSafeFunction dispatcher;
+        Napi::FunctionReference callback;       // Sadece JS thread'inde kullanılır
+        std::atomic<bool> drainScheduled{false};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    std::mutex g_logSinksMutex;  // Yazıcı iletirken listeyi tutar; sink çıkarıldıktan sonra çağrı yapılmaz
+    std::vector<std::shared_ptr<LogSink>> g_logSinks;
+
+    // JS thread'inde çalışır: biriken kayıtları tek bir dizi olarak sink callback'ine verir
+    void DrainLogSink(Napi::Env env, Napi::Function /*jsCallback*/, LogSink* sink) {
+        sink->drainScheduled.store(false, std::memory_order_release);
+        Napi::HandleScope scope(env);
+        Napi::Array batch = Napi::Array::New(env);
+        uint32_t count = 0;
+        while (LogRecord* record = sink->ring.Front()) {
+            Napi::Object item = Napi::Object::New(env);
+            item.Set("time", Napi::Number::New(env, record->timestampUs / 1000.0));
+            item.Set("level", Napi::String::New(env, kLogLevelNames[record->level]));
+            item.Set("message", Napi::String::New(env, record->text, record->length));
+            batch.Set(count++, item);
+            sink->ring.Pop();
+        }
+        if (count == 0) return;
+        sink->callback.Call({batch});
+        if (env.IsExceptionPending()) {
+            Napi::Error error = env.GetAndClearPendingException();
+            napi_fatal_exception(env, error.Value());
+        }
+    }
+
+    // Yazıcı thread'i: tüm thread halkalarını boşaltır, kayıtları zamana göre sıralayıp konsola ve sink'lere yazar
+    void FlushLogBuffers() {
+        std::vector<std::shared_ptr<LogThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(g_logBuffersMutex);
+            buffers = g_logBuffers;
+        }
+        std::vector<LogRecord> batch;
+        std::vector<LogThreadBuffer*> finished;
+        for (const auto& buffer : buffers) {
+            bool exited = buffer->exited.load(std::memory_order_acquire); // Boşaltmadan önce: sonrasında yazılmaz
+            while (LogRecord* record = buffer->ring.Front()) {
+                batch.push_back(*record);
+                buffer->ring.Pop();
+            }
+            if (exited) finished.push_back(buffer.get());
+        }
+        if (!finished.empty()) {
+            std::lock_guard<std::mutex> lock(g_logBuffersMutex);
+            g_logBuffers.erase(std::remove_if(g_logBuffers.begin(), g_logBuffers.end(), [&](const std::shared_ptr<LogThreadBuffer>& buffer) {
+                return std::find(finished.begin(), finished.end(), buffer.get()) != finished.end();
+            }), g_logBuffers.end());
+        }
+        if (batch.empty()) return;
+
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+            return a.timestampUs < b.timestampUs;
+        });
+        g_logRecords.fetch_add(batch.size(), std::memory_order_relaxed);
+        if (g_logConsole.load(std::memory_order_relaxed)) {
+            for (const auto& record : batch) WriteLogToConsole(record);
+            std::cout.flush();
+            std::cerr.flush();
+        }
+
+        std::lock_guard<std::mutex> lock(g_logSinksMutex);
+        for (const auto& sink : g_logSinks) {
+            for (const auto& record : batch) {
+                LogRecord* slot = sink->ring.BeginPush();
+                if (!slot) {
+                    sink->dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                *slot = record;
+                sink->ring.CommitPush();
+            }
+            if (!sink->drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+                if (sink->dispatcher.NonBlockingCall(sink.get(), DrainLogSink) != napi_ok) {
+                    sink->drainScheduled.store(false, std::memory_order_release);
+                }
+            }
+        }
+    }
+
+    // Süreç genelinde tek yazıcı thread'i; ilk ortam başlatırken açılır, son ortam kapanırken durur
+    struct LogFlusher {
+        std::mutex mutex;   // Başlatma / durdurmayı ve uyandırmayı sıralar
+        std::condition_variable wake;
+        std::thread thread;
+        bool stopping = false;
+
+        // Ortamlar temizlenmeden çıkılırsa (statik yıkım) thread burada durdurulur
+        ~LogFlusher() {
+            if (!thread.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        void Run() {
+            {
+                // Bayrağı thread'in kendisi kaldırır: thread hiç çalışmazsa kayıtlar eşzamanlı yolda kalır
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!stopping) g_logFlusherRunning.store(true, std::memory_order_release);
+            }
+            bool done = false;
+            while (!done) {
+                {
+                    // Üretici uyandırmaz (kart yolunda kilit ve sistem çağrısı yok); kısa aralıklarla boşaltılır
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait_for(lock, kLogFlushInterval, [this] { return stopping; });
+                    done = stopping;
+                }
+                FlushLogBuffers();
+            }
+        }
+    };
+    LogFlusher g_logFlusher;
+
+    void StartLogger() {
+        std::lock_guard<std::mutex> lock(g_logFlusher.mutex);
+        if (g_logFlusher.thread.joinable()) return;
+        g_logFlusher.stopping = false;
+        try {
+            g_logFlusher.thread = std::thread(&LogFlusher::Run, &g_logFlusher);
+        } catch (const std::system_error& e) {
+            // Bayrak kalkmadığı için kayıtlar eşzamanlı yolda kalır
+            std::cerr << "WARN: Failed to start the log writer thread, logging synchronously: " << e.what() << std::endl;
+        }
+    }
+
+    // Kalan kayıtları yazar; sonraki kayıtlar doğrudan konsola gider
+    void StopLogger() {
+        {
+            std::lock_guard<std::mutex> lock(g_logFlusher.mutex);
+            if (!g_logFlusher.thread.joinable()) return;
+            g_logFlusherRunning.store(false);
+            g_logFlusher.stopping = true;
+        }
+        g_logFlusher.wake.notify_one();
+        g_logFlusher.thread.join();
+        // Bayrak inmeden önce yazmaya başlamış thread'ler bitince son kez boşaltılır
+        while (g_logActiveWriters.load() != 0) std::this_thread::yield();
+        FlushLogBuffers();
+    }
+
+    // Ortamın sink'ini kaldırır (JS thread'inde); TSFN bırakılır, son referans finalizer'da düşer
+    void RemoveLogSink(const AddonInstance* owner) {
+        std::shared_ptr<LogSink> removed;
+        {
+            std::lock_guard<std::mutex> lock(g_logSinksMutex);
+            auto it = std::find_if(g_logSinks.begin(), g_logSinks.end(), [owner](const std::shared_ptr<LogSink>& sink) {
+                return sink->owner == owner;
+            });
+            if (it == g_logSinks.end()) return;
+            removed = *it;
+            g_logSinks.erase(it);
+        }
+        removed->dispatcher.Release();
+    }
+
+
+    // === Hata İşleme Yardımcıları ===
+
+    std::string SCardErrorToString(SCardLong rv) {
+        #ifdef _WIN32
+        // Windows'a özel detaylı hata mesajı alma
+        LPSTR errorMsg = nullptr;
+        DWORD flags = FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
+        HMODULE hWinscard = GetModuleHandleA("winscard.dll");
+        if (hWinscard) flags |= FORMAT_MESSAGE_FROM_HMODULE;
+        DWORD len = FormatMessageA(flags, hWinscard, rv, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&errorMsg, 0, NULL);
+        if (len > 0 && errorMsg != nullptr) {
+            std::string result(errorMsg);
+            LocalFree(errorMsg);
+            while (!result.empty() && (result.back() == '\r' || result.back() == '\n')) {
+                result.pop_back();
+            }
+            // Hata kodunu da ekle
+            std::stringstream ss;
+            ss << result << " (0x" << std::hex << std::uppercase << rv << ")";
+            return ss.str();
+        }
+        #else
+        // PCSC-lite için (pcsc_stringify_error kullanılabilir ama kütüphaneye bağlı)
+        // Şimdilik sadece hex kodu döndürelim
+        // const char* pcscError = pcsc_stringify_error(rv); // Eğer PCSC kütüphanesi linklenmişse
+        // if (pcscError) return std::string(pcscError) + " (0x" + ... + ")";
+        #endif
+
+        // Genel veya Windows'ta mesaj bulunamayan durum
+        std::stringstream ss;
+        ss << "PC/SC Error Code: 0x" << std::hex << std::uppercase << rv;
+        return ss.str();
+    }
+
+    void ThrowNapiError(const Napi::Env& env, const std::string& message, SCardLong rv = 0) {
+        std::string fullMessage = message;
+        if (rv != 0) {
+            fullMessage += " (" + SCardErrorToString(rv) + ")";
+        }
+        Napi::Error::New(env, fullMessage).ThrowAsJavaScriptException();
+    }
+
+    // === Context Yönetimi ===
+
+    // Context'in kaybedildiğini gösteren hatalar (pcscd / Smart Card servisi yeniden başladı)
+    inline bool IsContextLost(SCardLong rv) {
+        return rv == SCARD_E_NO_SERVICE || rv == SCARD_E_SERVICE_STOPPED || rv == SCARD_E_INVALID_HANDLE;
+    }
+
+    // Başarısız kurma denemeleri arasında üstel geri çekilme (100 ms .. 5 s)
+    std::chrono::milliseconds g_establishBackoff{0};
+    std::chrono::steady_clock::time_point g_nextEstablishAttempt{};
+
+    // g_contextMutex tutulurken çağrılır
+    SCardLong EstablishContextLocked(ContextSlot& slot) {
+        auto now = std::chrono::steady_clock::now();
+        if (now < g_nextEstablishAttempt) return SCARD_E_NO_SERVICE; // Geri çekilme süresi dolmadı
+
+        SCARDCONTEXT context = 0;
+        SCardLong rv = Backend().EstablishContext(&context);
+        if (rv != SCARD_S_SUCCESS) {
+            g_establishBackoff = std::min(std::max(g_establishBackoff * 2, std::chrono::milliseconds(100)),
+                                          std::chrono::milliseconds(5000));
+            g_nextEstablishAttempt = now + g_establishBackoff;
+            PCSC_LOG(kLogError) << "Failed to establish PC/SC context! " << SCardErrorToString(rv)
+                      << " Next attempt in " << g_establishBackoff.count() << " ms.";
+            return rv;
+        }
+        g_establishBackoff = std::chrono::milliseconds(0);
+        g_nextEstablishAttempt = std::chrono::steady_clock::time_point();
+        slot.backend = &Backend();
+        slot.context = context;
+        if (slot.announce) {
+            PCSC_LOG(kLogInfo) << "PC/SC context established successfully.";
+        }
+        return SCARD_S_SUCCESS;
+    }
+
+    // g_contextMutex tutulurken çağrılır. Context, kendisini kuran arka uçta bırakılır.
+    void ReleaseContextLocked(ContextSlot& slot) {
+        SCARDCONTEXT context = slot.context.exchange(0);
+        PcscBackend* backend = slot.backend.exchange(nullptr);
+        if (context != 0 && backend) backend->ReleaseContext(context);
+    }
+
+    // Slotta geçerli bir context olmasını sağlar. SCardIsValidContext yereldir (IPC yok), bu yüzden
+    // context sağlamsa kilit alınmaz; thread'ler birbirini beklemez.
+    bool EnsureContext(ContextSlot& slot, const Napi::Env* env = nullptr) {
+        if (slot.context != 0 && slot.backend == &Backend()
+            && Backend().IsValidContext(slot.context) == SCARD_S_SUCCESS) {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(g_contextMutex);
+        if (slot.context != 0) {
+            if (slot.backend == &Backend()) {
+                // Servis yeniden başladıysa context geçersizdir
+                if (Backend().IsValidContext(slot.context) == SCARD_S_SUCCESS) return true;
+                PCSC_LOG(kLogWarn) << "PC/SC context is no longer valid, re-establishing.";
+            }
+            ReleaseContextLocked(slot); // Geçersiz veya başka arka uca ait
+        }
+
+        SCardLong rv = EstablishContextLocked(slot);
+        if (rv != SCARD_S_SUCCESS) {
+            if (env) {
+                ThrowNapiError(*env, "Failed to establish PC/SC context", rv);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // lostContext üzerinde context kaybı hatası alındıktan sonra çağrılır. Başka bir thread context'i
+    // zaten yenilediyse ona dokunmaz; yeniden kurma geri çekilmeye tabidir. Geçerli bir context varsa true.
+    bool RecoverContext(ContextSlot& slot, SCARDCONTEXT lostContext, SCardLong rv) {
+        std::lock_guard<std::mutex> lock(g_contextMutex);
+        if (slot.context != 0 && slot.context == lostContext) {
+            // SCARD_E_INVALID_HANDLE kart handle'ından da gelebilir; context hâlâ geçerliyse bırakılmaz
+            if (rv == SCARD_E_INVALID_HANDLE && Backend().IsValidContext(lostContext) == SCARD_S_SUCCESS) return true;
+            PCSC_LOG(kLogWarn) << "PC/SC context lost (" << SCardErrorToString(rv) << "), re-establishing.";
+            ReleaseContextLocked(slot);
+        }
+        if (slot.context != 0) return true;
+        return EstablishContextLocked(slot) == SCARD_S_SUCCESS;
+    }
+
+    // Havuz thread'inin kendi context'i; yalnız iş thread'lerinde (ReaderWorker::Execute) çağrılır
+    inline ContextSlot& ThreadContext() {
+        return *t_threadContext;
+    }
+
+    std::unique_ptr<ContextSlot> ContextPool::Acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.empty()) return std::make_unique<ContextSlot>(); // Context ilk kullanımda kurulur
+        std::unique_ptr<ContextSlot> slot = std::move(idle.back());
+        idle.pop_back();
+        return slot;
+    }
+
+    void ContextPool::Release(std::unique_ptr<ContextSlot> slot) {
+        if (!slot) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (slot->context != 0 && idle.size() < kMaxIdle) {
+                idle.push_back(std::move(slot));
+                return;
+            }
+        }
+        std::lock_guard<std::mutex> lock(g_contextMutex);
+        ReleaseContextLocked(*slot);
+    }
+
+    void ContextPool::Clear() {
+        std::vector<std::unique_ptr<ContextSlot>> slots;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slots.swap(idle);
+        }
+        std::lock_guard<std::mutex> lock(g_contextMutex);
+        for (auto& slot : slots) ReleaseContextLocked(*slot);
+    }
+
+    // === Platforma Bağımlı PCI İşaretçileri ===
+    // SCardTransmit'te SCARD_IO_REQUEST yerine bunları kullanmak daha taşınabilir
+    const SCARD_IO_REQUEST* GetPci(SCardDword protocol) {
+        switch (protocol) {
+            case SCARD_PROTOCOL_T0:
+                return SCARD_PCI_T0;
+            case SCARD_PROTOCOL_T1:
+                return SCARD_PCI_T1;
+            // case SCARD_PROTOCOL_RAW: // Gerekirse eklenebilir
+            //     return SCARD_PCI_RAW;
+            default:
+                // Desteklenmeyen veya bilinmeyen protokol için null dönmek güvenli olabilir
+                // veya T1'i varsayalım (daha modern)
+                PCSC_LOG(kLogWarn) << "Unknown or unsupported protocol " << protocol << ", using T1 PCI.";
+                return SCARD_PCI_T1;
+        }
+    }
+
+    // === Okuyucu Listeleme ===
+
+    // Aktif arka uçtaki okuyucu adlarını listeler.
+    // Okuyucu yoksa SCARD_S_SUCCESS ve boş liste döner.
+    SCardLong ListReaderNames(SCARDCONTEXT context, std::vector<std::string>& out) {
+        SCardLong rv = Backend().ListReaders(context, out);
+        if (rv == SCARD_E_NO_READERS_AVAILABLE) {
+            // Okuyucu yoksa sorun değil, boş liste
+            rv = SCARD_S_SUCCESS;
+        }
+        return rv;
+    }
+
+    // Slotun context'i üzerinden listeler; servis yeniden başladıysa context yenilenip bir kez daha denenir
+    SCardLong ListReaderNames(ContextSlot& slot, std::vector<std::string>& out) {
+        SCARDCONTEXT context = slot.context;
+        SCardLong rv = ListReaderNames(context, out);
+        if (IsContextLost(rv) && RecoverContext(slot, context, rv)) {
+            out.clear();
+            rv = ListReaderNames(slot.context, out);
+        }
+        return rv;
+    }
+
+    // Okuyucu önbelleğini günceller; istenirse eklenen ve çıkarılan okuyucuları döner
+    void UpdateReaderCache(const std::vector<std::string>& readerNames,
+                           std::vector<std::string>* attached = nullptr,
+                           std::vector<std::string>* detached = nullptr) {
+        std::lock_guard<std::mutex> lock(g_readerCacheMutex);
+        if (attached) {
+            for (const auto& name : readerNames) {
+                if (std::find(g_cachedReaders.begin(), g_cachedReaders.end(), name) == g_cachedReaders.end()) {
+                    attached->push_back(name);
+                }
+            }
+        }
+        if (detached) {
+            for (const auto& name : g_cachedReaders) {
+                if (std::find(readerNames.begin(), readerNames.end(), name) == readerNames.end()) {
+                    detached->push_back(name);
+                }
+            }
+        }
+        g_cachedReaders = readerNames;
+    }
+
+
+    // === Ölçümler (Gecikme Histogramları ve Sayaçlar) ===
+
+    // Mikrosaniye cinsinden log-lineer (HDR tarzı) histogram. Her ikinin kuvveti aralığı 8 alt kovaya
+    // bölünür (~%12.5 göreli hata). Kayıt kilitsizdir; okuma sadece anlık görüntü içindir.
+    class LatencyHistogram {
+    public:
+        static const int kSubBucketBits = 3;
+        static const int kSubBuckets = 1 << kSubBucketBits;
+        static const int kMaxExponent = 39;  // ~6 gün; üstü son kovaya yazılır
+        static const int kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+        void Record(uint64_t micros) {
+            buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(micros, std::memory_order_relaxed);
+            uint64_t previousMax = max.load(std::memory_order_relaxed);
+            while (micros > previousMax && !max.compare_exchange_weak(previousMax, micros, std::memory_order_relaxed)) {}
+        }
+
+        void Reset() {
+            for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+            count.store(0, std::memory_order_relaxed);
+            sum.store(0, std::memory_order_relaxed);
+            max.store(0, std::memory_order_relaxed);
+        }
+
+        uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+        uint64_t Sum() const { return sum.load(std::memory_order_relaxed); }
+        uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+
+        // Verilen yüzdelik (0-100) için kovanın üst sınırı (en fazla gözlenen max)
+        uint64_t Percentile(double percentile) const {
+            uint64_t total = Count();
+            if (total == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+            if (rank == 0) rank = 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < kBucketCount; i++) {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank) return i == kBucketCount - 1 ? Max() : std::min(BucketUpperBound(i), Max());
+            }
+            return Max();
+        }
+
+    private:
+        static int BucketIndex(uint64_t value) {
+            if (value < static_cast<uint64_t>(kSubBuckets)) return static_cast<int>(value);
+            int exponent = 0;
+            for (uint64_t v = value; v > 1; v >>= 1) exponent++;
+            if (exponent > kMaxExponent) return kBucketCount - 1;
+            int shift = exponent - kSubBucketBits;
+            return (shift + 1) * kSubBuckets + static_cast<int>((value >> shift) - kSubBuckets);
+        }
+
+        static uint64_t BucketUpperBound(int index) {
+            if (index < kSubBuckets) return static_cast<uint64_t>(index);
+            int shift = index / kSubBuckets - 1;
+            uint64_t mantissa = kSubBuckets + index % kSubBuckets;
+            return ((mantissa + 1) << shift) - 1;
+        }
+
+        std::atomic<uint64_t> buckets[kBucketCount] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    // Okuyucu başına ölçülen işlemler (dizi indeksi olarak kullanılır)
+    enum PcscOp {
+        kOpConnect,        // SCardConnect
+        kOpTransmit,       // SCardTransmit
+        kOpReconnect,      // SCardReconnect (oturum kurtarma)
+        kOpControl,        // SCardControl / SCardGetAttrib
+        kOpQueueWait,      // İşin okuyucu kuyruğunda beklediği süre
+        kOpDelivery,       // Olayın kuyruğa yazılmasından JS callback'ine kadar
+        kOpTapToCallback,  // Kartın algılanmasından onUid çağrısına kadar
+        kOpCount
+    };
+    const char* const kOpNames[kOpCount] = { "connect", "transmit", "reconnect", "control", "queueWait", "delivery", "tapToCallback" };
+
+    struct ReaderStats {
+        LatencyHistogram latency[kOpCount];
+        std::atomic<uint64_t> errors[kOpCount] = {};
+    };
+
+    std::mutex g_statsMutex;
+    std::map<std::string, std::unique_ptr<ReaderStats>> g_readerStats; // Kayıtlar silinmez, işaretçiler kalıcıdır
+    std::map<SCardLong, uint64_t> g_errorCounts;                        // PC/SC hata kodu -> adet
+    std::atomic<uint64_t> g_statusChangeWakeups{0};
+    std::atomic<uint64_t> g_statusChangeTimeouts{0};
+    std::atomic<uint64_t> g_statusChangeCancels{0};  // Dinleyici güncellemesi için SCardCancel ile uyandırmalar
+    std::chrono::steady_clock::time_point g_statsSince = std::chrono::steady_clock::now();
+
+    // Okuyucunun ölçüm kaydı (yoksa oluşturulur); dönen işaretçi eklenti ömrü boyunca geçerlidir.
+    // Kayıtlar silinmediği için yalnız başarılı bir bağlantıdan sonra oluşturulur (ConnectReader).
+    ReaderStats* StatsFor(const std::string& readerName) {
+        std::lock_guard<std::mutex> lock(g_statsMutex);
+        std::unique_ptr<ReaderStats>& stats = g_readerStats[readerName];
+        if (!stats) stats.reset(new ReaderStats());
+        return stats.get();
+    }
+
+    // Okuyucunun ölçüm kaydı; okuyucuya henüz hiç bağlanılmadıysa nullptr (kayıt oluşturmaz)
+    ReaderStats* FindStats(const std::string& readerName) {
+        std::lock_guard<std::mutex> lock(g_statsMutex);
+        auto it = g_readerStats.find(readerName);
+        return it == g_readerStats.end() ? nullptr : it->second.get();
+    }
+
+    void CountError(SCardLong rv) {
+        std::lock_guard<std::mutex> lock(g_statsMutex);
+        g_errorCounts[rv]++;
+    }
+
+    inline uint64_t MicrosSince(std::chrono::steady_clock::time_point start) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+
+    // Bir işlemin süresini ve (başarısızsa) hata kodunu kaydeder
+    void RecordOp(ReaderStats* stats, PcscOp op, std::chrono::steady_clock::time_point start, SCardLong rv = SCARD_S_SUCCESS) {
+        if (stats) {
+            stats->latency[op].Record(MicrosSince(start));
+            if (rv != SCARD_S_SUCCESS) stats->errors[op].fetch_add(1, std::memory_order_relaxed);
+        }
+        if (rv != SCARD_S_SUCCESS) CountError(rv);
+    }
+
+    // Okuyucuya slotun context'i üzerinden bağlanır (ölçülür).
+    // Servis yeniden başladıysa context yenilenip bir kez daha denenir. Okuyucunun ölçüm kaydı yoksa
+    // ilk başarılı bağlantıda oluşturulur ve 'stats'a yazılır; var olmayan okuyucu adları kayıt bırakmaz.
+    SCardLong ConnectReader(ContextSlot& slot, const std::string& readerName, ReaderStats*& stats, SCardDword shareMode,
+                            SCardDword preferredProtocols, SCARDHANDLE* hCard, SCardDword* activeProtocol) {
+        SCARDCONTEXT context = slot.context;
+        auto start = std::chrono::steady_clock::now();
+        SCardLong rv = Backend().Connect(context, readerName.c_str(), shareMode, preferredProtocols, hCard, activeProtocol);
+        if (IsContextLost(rv) && RecoverContext(slot, context, rv) && slot.context != context) {
+            RecordOp(stats, kOpConnect, start, rv);
+            start = std::chrono::steady_clock::now();
+            rv = Backend().Connect(slot.context, readerName.c_str(), shareMode, preferredProtocols, hCard, activeProtocol);
+        }
+        if (rv == SCARD_S_SUCCESS && !stats) stats = StatsFor(readerName);
+        RecordOp(stats, kOpConnect, start, rv);
+        return rv;
+    }
+
+    // Okuyucudaki karta paylaşımlı modda bağlanır
+    SCardLong ConnectCard(ContextSlot& slot, const std::string& readerName, ReaderStats*& stats,
+                          SCARDHANDLE* hCard, SCardDword* activeProtocol) {
+        return ConnectReader(slot, readerName, stats, SCARD_SHARE_SHARED,
+                             SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1, hCard, activeProtocol);
+    }
+
+    // Okuyucunun kendisine bağlanır (SCARD_SHARE_DIRECT): kart gerekmez; kontrol kodları ve öznitelikler için
+    SCardLong ConnectDirect(ContextSlot& slot, const std::string& readerName, ReaderStats*& stats, SCARDHANDLE* hCard) {
+        SCardDword activeProtocol = 0;
+        return ConnectReader(slot, readerName, stats, SCARD_SHARE_DIRECT, 0, hCard, &activeProtocol);
+    }
+
+
+    // === APDU Yapısı ve Zincirleme ===
+
+    // ISO 7816-4 APDU gövdesi (durum 1-4, kısa veya uzatılmış alanlar)
+    struct ApduShape {
+        bool extended = false;
+        size_t lc = 0;          // Komut verisi uzunluğu
+        size_t dataOffset = 0;  // Komut verisinin başladığı konum
+        bool hasLe = false;
+        size_t le = 0;          // Beklenen en fazla yanıt verisi (Le=0: 256 veya 65536)
+    };
+
+    bool ParseApdu(const SCardByte* apdu, size_t length, ApduShape& shape) {
+        shape = ApduShape();
+        if (length < 4) return false;
+        if (length == 4) return true;                   // Durum 1
+        if (length == 5) {                              // Durum 2S
+            shape.hasLe = true;
+            shape.le = apdu[4] ? apdu[4] : 256;
+            return true;
+        }
+        if (apdu[4] != 0) {                             // Durum 3S / 4S
+            shape.lc = apdu[4];
+            shape.dataOffset = 5;
+            if (length == 5 + shape.lc) return true;
+            if (length != 6 + shape.lc) return false;
+            shape.hasLe = true;
+            shape.le = apdu[length - 1] ? apdu[length - 1] : 256;
+            return true;
+        }
+
+        // 00 ile başlayan uzatılmış alanlar
+        if (length < 7) return false;
+        shape.extended = true;
+        if (length == 7) {                              // Durum 2E
+            size_t le = (apdu[5] << 8) | apdu[6];
+            shape.hasLe = true;
+            shape.le = le ? le : 65536;
+            return true;
+        }
+        shape.lc = (apdu[5] << 8) | apdu[6];
+        shape.dataOffset = 7;
+        if (shape.lc == 0) return false;
+        if (length == 7 + shape.lc) return true;        // Durum 3E
+        if (length != 9 + shape.lc) return false;       // Durum 4E
+        size_t le = (apdu[length - 2] << 8) | apdu[length - 1];
+        shape.hasLe = true;
+        shape.le = le ? le : 65536;
+        return true;
+    }
+
+    // SCardTransmit'e verilecek alım tamponu boyu: kısa APDU'lar için 256 veri + SW (260 makul bir boyut),
+    // uzatılmış Le için Le + SW (en fazla 65538)
+    size_t ExpectedResponseLength(const SCardByte* apdu, size_t length) {
+        const size_t kShortResponseBuffer = 260;
+        ApduShape shape;
+        if (ParseApdu(apdu, length, shape) && shape.extended && shape.hasLe) {
+            return std::max(shape.le + 2, kShortResponseBuffer);
+        }
+        return kShortResponseBuffer;
+    }
+
+    // Yanıtın son iki baytı (SW1 SW2); yanıt kısaysa 0
+    uint16_t StatusWord(const std::vector<SCardByte>& response) {
+        if (response.size() < 2) return 0;
+        return static_cast<uint16_t>((response[response.size() - 2] << 8) | response[response.size() - 1]);
+    }
+
+    // Kısa APDU'nun Le baytını verilen değerle değiştirir (Le yoksa ekler). 6Cxx tekrarı için kullanılır.
+    bool WithLe(const std::vector<SCardByte>& apdu, SCardByte le, std::vector<SCardByte>& out) {
+        out = apdu;
+        if (apdu.size() == 4) {                           // Case 1: Le ekle
+            out.push_back(le);
+        } else if (apdu.size() == 5) {                    // Case 2: Le değiştir
+            out[4] = le;
+        } else if (apdu.size() > 5 && apdu[4] != 0) {
+            size_t lc = apdu[4];
+            if (apdu.size() == 5 + lc) out.push_back(le); // Case 3: Le ekle
+            else if (apdu.size() == 6 + lc) out.back() = le; // Case 4: Le değiştir
+            else return false;
+        } else {
+            return false; // Extended APDU, dokunma
+        }
+        return true;
+    }
+
+    // APDU'yu gönderir ve ISO 7816-4 yanıt zincirlemesini yerel olarak tamamlar:
+    //  - 6Cxx: APDU, kartın bildirdiği Le ile bir kez tekrarlanır
+    //  - 61xx: kalan veri GET RESPONSE (00 C0 00 00 xx) ile toplanır
+    // transmit: SCardLong(const SCardByte*, size_t, std::vector<SCardByte>&) imzalı çağrılabilir
+    template <typename TransmitFn>
+    SCardLong TransmitChained(TransmitFn&& transmit, const std::vector<SCardByte>& apdu, std::vector<SCardByte>& response) {
+        const int kMaxGetResponse = 256; // Sonsuz döngüye karşı üst sınır (~64 KB)
+        SCardLong rv = transmit(apdu.data(), apdu.size(), response);
+        if (rv != SCARD_S_SUCCESS) return rv;
+
+        std::vector<SCardByte> retryApdu;
+        if ((StatusWord(response) >> 8) == 0x6C && WithLe(apdu, static_cast<SCardByte>(StatusWord(response) & 0xFF), retryApdu)) {
+            rv = transmit(retryApdu.data(), retryApdu.size(), response);
+            if (rv != SCARD_S_SUCCESS) return rv;
+        }
+
+        std::vector<SCardByte> chunk;
+        for (int i = 0; i < kMaxGetResponse && (StatusWord(response) >> 8) == 0x61; i++) {
+            // Sınıf baytının lojik kanal bitleri korunur
+            SCardByte getResponse[] = { static_cast<SCardByte>(apdu.empty() ? 0x00 : (apdu[0] & 0x03)), 0xC0, 0x00, 0x00,
+                                        static_cast<SCardByte>(StatusWord(response) & 0xFF) };
+            rv = transmit(getResponse, sizeof(getResponse), chunk);
+            if (rv != SCARD_S_SUCCESS) return rv;
+            response.resize(response.size() - 2); // Önceki SW'yi at, veriyi birleştir
+            response.insert(response.end(), chunk.begin(), chunk.end());
+        }
+        return SCARD_S_SUCCESS;
+    }
+
+    // Uzatılmış bir komutu (Lc > 0) ISO 7816-4 komut zincirine böler: veri en fazla 255 baytlık kısa
+    // APDU'larla gönderilir, sonuncusu hariç hepsinde CLA'nın zincirleme biti (0x10) set edilir. Uzatılmış
+    // alanları desteklemeyen okuyucu ve kartlar için. Zincirlenecek bir şey yoksa false döner; özel
+    // sınıflar (CLA b8 = 1, ör. DESFire 90 veya okuyucu FF komutları) kendi çerçevelemelerini kullandığı için bölünmez.
+    bool SplitCommandChain(const std::vector<SCardByte>& apdu, std::vector<std::vector<SCardByte>>& segments) {
+        ApduShape shape;
+        if (!ParseApdu(apdu.data(), apdu.size(), shape) || !shape.extended || shape.lc == 0) return false;
+        if (apdu[0] & 0x80) return false;
+
+        const SCardByte* data = apdu.data() + shape.dataOffset;
+        for (size_t offset = 0; offset < shape.lc; offset += 255) {
+            size_t chunk = std::min<size_t>(255, shape.lc - offset);
+            bool last = offset + chunk >= shape.lc;
+            std::vector<SCardByte> segment = { static_cast<SCardByte>(last ? apdu[0] : (apdu[0] | 0x10)),
+                                               apdu[1], apdu[2], apdu[3], static_cast<SCardByte>(chunk) };
+            segment.insert(segment.end(), data + offset, data + offset + chunk);
+            if (last && shape.hasLe) segment.push_back(shape.le >= 256 ? 0x00 : static_cast<SCardByte>(shape.le));
+            segments.push_back(std::move(segment));
+        }
+        return true;
+    }
+
+    // Tek APDU için zincirleme ayarları
+    struct ChainingOptions {
+        bool responses = false; // 61xx / 6Cxx yanıt zincirlemesi (TransmitChained)
+        bool commands = false;  // Uzatılmış komutları ISO 7816-4 komut zincirine böl
+    };
+
+    // APDU'yu ayarlara göre gönderir. Komut zincirinin ara parçalarından biri 9000 dışında bir yanıt
+    // alırsa zincir durur ve o yanıt döner.
+    template <typename TransmitFn>
+    SCardLong TransmitWithChaining(TransmitFn&& transmit, const std::vector<SCardByte>& apdu,
+                                   const ChainingOptions& chaining, std::vector<SCardByte>& response) {
+        std::vector<std::vector<SCardByte>> segments;
+        if (chaining.commands && SplitCommandChain(apdu, segments)) {
+            for (size_t i = 0; i + 1 < segments.size(); i++) {
+                SCardLong rv = transmit(segments[i].data(), segments[i].size(), response);
+                if (rv != SCARD_S_SUCCESS || StatusWord(response) != 0x9000) return rv;
+            }
+            return chaining.responses ? TransmitChained(transmit, segments.back(), response)
+                                      : transmit(segments.back().data(), segments.back().size(), response);
+        }
+        return chaining.responses ? TransmitChained(transmit, apdu, response)
+                                  : transmit(apdu.data(), apdu.size(), response);
+    }
+
+    // JS seçenek nesnesinden { chaining, commandChaining } okur (boolean olmayan değerler yok sayılır)
+    void ReadChainingOptions(const Napi::Object& options, ChainingOptions& chaining) {
+        if (options.Get("chaining").IsBoolean()) chaining.responses = options.Get("chaining").As<Napi::Boolean>().Value();
+        if (options.Get("commandChaining").IsBoolean()) chaining.commands = options.Get("commandChaining").As<Napi::Boolean>().Value();
+    }
+
+
+    // === APDU Transmit Worker (Asenkron İşlem) ===
+
+    // Bağlı karta tek bir APDU gönderir; yanıt alınan gerçek boyuta küçültülür. stats verilirse süre ölçülür.
+    SCardLong TransmitApdu(SCARDHANDLE hCard, SCardDword protocol, const SCardByte* apdu, size_t apduLength,
+                           std::vector<SCardByte>& response, ReaderStats* stats = nullptr) {
+        // Platforma uygun PCI yapısını al
+        const SCARD_IO_REQUEST* pci = GetPci(protocol);
+        if (!pci) {
+            response.clear();
+            return SCARD_E_PROTO_MISMATCH;
+        }
+
+        // Alım tamponu APDU'nun Le'sine göre boyutlanır (uzatılmış Le ile 64 KB'a kadar) ve thread başına
+        // yeniden kullanılır; yanıt gerçek boyunda kopyalanır, böylece JS'e büyük boş vektörler devredilmez
+        thread_local std::vector<SCardByte> receiveBuffer;
+        size_t expectedLength = ExpectedResponseLength(apdu, apduLength);
+        if (receiveBuffer.size() < expectedLength) receiveBuffer.resize(expectedLength);
+        SCardDword dwRecvLength = static_cast<SCardDword>(expectedLength);
+
+        // APDU'yu gönder
+        auto start = std::chrono::steady_clock::now();
+        SCardLong rv = Backend().Transmit(hCard, pci, apdu, (SCardDword)apduLength, receiveBuffer.data(), &dwRecvLength);
+        RecordOp(stats, kOpTransmit, start, rv);
+
+        if (rv == SCARD_S_SUCCESS) {
+            response.assign(receiveBuffer.begin(), receiveBuffer.begin() + std::min<size_t>(dwRecvLength, expectedLength));
+        } else {
+            response.clear();
+        }
+        return rv;
+    }
+
+    // Vektörü kopyalamadan JS Buffer'ına devreder; bellek GC finalizer'ında serbest bırakılır.
+    // Harici buffer'a izin vermeyen ortamlarda (ör. V8 sandbox) NewOrCopy kopyaya düşer.
+    Napi::Buffer<SCardByte> TakeBuffer(Napi::Env env, std::vector<SCardByte>&& bytes) {
+        if (bytes.empty()) return Napi::Buffer<SCardByte>::New(env, 0);
+        auto owned = new std::vector<SCardByte>(std::move(bytes));
+        return Napi::Buffer<SCardByte>::NewOrCopy(env, owned->data(), owned->size(),
+            [](Napi::Env /*env*/, SCardByte* /*data*/, std::vector<SCardByte>* hint) { delete hint; }, owned);
+    }
+
+    // Bayt başına iki karakterlik büyük harf hex tablosu
+    struct HexTable {
+        char pairs[256][2];
+        HexTable() {
+            const char digits[] = "0123456789ABCDEF";
+            for (int i = 0; i < 256; i++) {
+                pairs[i][0] = digits[i >> 4];
+                pairs[i][1] = digits[i & 0x0F];
+            }
+        }
+    };
+    const HexTable kHexTable;
+
+    // Baytları out'a hex olarak yazar (out en az 2 * length karakter olmalı); yazılan karakter sayısını döner
+    size_t EncodeHex(const SCardByte* bytes, size_t length, char* out) {
+        for (size_t i = 0; i < length; i++) {
+            memcpy(out + 2 * i, kHexTable.pairs[bytes[i]], 2);
+        }
+        return 2 * length;
+    }
+
+    // Hex string'i baytlara çevirir (boşluk ve ':' ayraçları atlanır); geçersiz karakter veya tek sayıda hane olursa false
+    bool DecodeHex(const std::string& text, std::vector<SCardByte>& out) {
+        out.clear();
+        int high = -1;
+        for (char c : text) {
+            int nibble;
+            if (c >= '0' && c <= '9') nibble = c - '0';
+            else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+            else if (c == ' ' || c == ':') continue;
+            else return false;
+            if (high < 0) {
+                high = nibble;
+            } else {
+                out.push_back(static_cast<SCardByte>((high << 4) | nibble));
+                high = -1;
+            }
+        }
+        return high < 0;
+    }
+
+    // === Okuyucu Başına İş Kuyrukları ===
+    // PC/SC işleri libuv thread havuzu yerine özel bir havuzda çalışır. Her okuyucunun kendi
+    // sıralı kuyruğu vardır: aynı okuyucuya giden işler sırayla, farklı okuyucular paralel çalışır.
+
+    // Okuyucuya bağlı olmayan işlerin (okuyucu listesi, durum görüntüsü) kuyruğu; boş ad bir okuyucuya ait olamaz
+    const char* const kControlQueueKey = "";
+    // Tap günlüğü işleri; uzun taramalar kontrol kuyruğunu bekletmesin. Okuyucu adı kontrol karakteriyle başlamaz.
+    const char* const kJournalQueueKey = "\x01journal";
+    // Dinleyici güncellemeleri; dinleyici uygulayana kadar bekleyen işler kontrol kuyruğunu tutmasın
+    const char* const kListenerQueueKey = "\x01listener";
+
+    inline bool IsReaderQueueKey(const std::string& key) {
+        return !key.empty() && key[0] != '\x01';
+    }
+
+    class ReaderWorker {
+    public:
+        ReaderWorker(Napi::Env env, const std::string& readerKey)
+            : env(env), instance(env.GetInstanceData<AddonInstance>()), readerKey(readerKey) {}
+        virtual ~ReaderWorker() {}
+
+        // İşi okuyucunun kuyruğuna ekler (JS thread'inden çağrılır); tamamlanınca kendini siler
+        void Queue();
+
+        // İş thread'inde çalışır
+        void Run() {
+            uint64_t waitedUs = MicrosSince(queuedAt);
+            Execute();
+            // Kuyruk beklemesi iş bittikten sonra, yalnız bağlanılabilmiş (ölçüm kaydı olan) okuyucular için kaydedilir
+            ReaderStats* stats = IsReaderQueueKey(readerKey) ? FindStats(readerKey) : nullptr;
+            if (stats) stats->latency[kOpQueueWait].Record(waitedUs);
+        }
+
+        // JS thread'inde çalışır: sonucu iletir ve işi siler
+        void Finish() {
+            Napi::HandleScope scope(env);
+            if (failed) {
+                OnError(Napi::Error::New(env, error));
+            } else {
+                OnOK();
+            }
+        }
+
+        // JS thread'inde: işi çalıştırmadan hatayla sonuçlandırır (çağıran siler)
+        void Reject(const std::string& message) {
+            SetError(message);
+            Finish();
+        }
+
+        const std::string& ReaderKey() const { return readerKey; }
+        Napi::Env Env() const { return env; }
+        AddonInstance& Instance() const { return *instance; } // İşi kuyruğa ekleyen ortam
+
+    protected:
+        virtual void Execute() = 0;
+        virtual void OnOK() = 0;
+        virtual void OnError(const Napi::Error& e) = 0;
+
+        void SetError(const std::string& message) {
+            error = message;
+            failed = true;
+        }
+
+    private:
+        Napi::Env env;
+        AddonInstance* instance;
+        std::string readerKey;
+        std::string error;
+        bool failed = false;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    class ReaderScheduler {
+    public:
+        static const size_t kMaxThreads = 8;
+
+        // Bekleyen iş yoksa true (başka bir ortamın JS thread'inden de okunabilir)
+        bool Idle() const { return inFlight.load() == 0; }
+
+        // Tamamlama TSFN'ini oluşturur (Init'te, JS thread'inde)
+        bool Start(Napi::Env env) {
+            if (completions) return true;
+            Napi::Function noop = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+            completions = Napi::ThreadSafeFunction::New(env, noop, "PCSC_Reader_Scheduler", 0, 1);
+            if (!completions) return false;
+            completions.Unref(env); // Bekleyen iş yokken event loop'u canlı tutma
+            // TSFN'den sonra kaydedilen hook ondan önce çalışır: thread'ler TSFN kapanmadan durdurulur
+            napi_add_env_cleanup_hook(env, [](void* arg) { static_cast<ReaderScheduler*>(arg)->Shutdown(); }, this);
+            return true;
+        }
+
+        // JS thread'inden çağrılır
+        void Submit(ReaderWorker* worker) {
+            if (!completions) {
+                // Start() başarısız oldu: sonuç iletilemez, Promise hemen reddedilir
+                worker->Reject("PC/SC job scheduler is not running.");
+                delete worker;
+                return;
+            }
+            inFlight++;
+            if (!referenced) {
+                completions.Ref(worker->Env());
+                referenced = true;
+            }
+            bool queued = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const std::string& readerKey = worker->ReaderKey();
+                std::deque<ReaderWorker*>& queue = queues[readerKey];
+                // Uyandırılmış ama henüz işi almamış thread'ler de boşta sayılır: hazır okuyucu sayısı boştaki
+                // thread sayısına ulaştıysa yeni okuyucuyu alacak thread yoktur, havuz büyütülür
+                if (queue.empty() && ready.size() >= idleThreads && threads.size() < kMaxThreads
+                        && !StartThreadLocked() && threads.empty()) {
+                    // Hiç iş thread'i yok ve açılamıyor: iş çalıştırılamaz
+                    queues.erase(readerKey);
+                    queued = false;
+                } else {
+                    // Havuz büyüyemediyse iş mevcut thread'leri bekler
+                    queue.push_back(worker);
+                    if (queue.size() == 1) {
+                        // Okuyucu boştaydı: çalışmaya hazır
+                        ready.push_back(readerKey);
+                        wake.notify_one();
+                    }
+                }
+            }
+            if (!queued) {
+                Napi::Env env = worker->Env();
+                worker->Reject("Failed to start a PC/SC worker thread.");
+                delete worker;
+                if (--inFlight == 0 && referenced) {
+                    completions.Unref(env);
+                    referenced = false;
+                }
+            }
+        }
+
+        // Thread'leri durdurur; çalışmakta olan işlerin bitmesini bekler, bekleyenleri atar
+        void Shutdown() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) return;
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& thread : threads) {
+                if (thread.joinable()) thread.join();
+            }
+            threads.clear();
+            for (auto& entry : queues) {
+                for (ReaderWorker* worker : entry.second) delete worker;
+            }
+            queues.clear();
+            ready.clear();
+        }
+
+    private:
+        // Havuza bir thread ekler (mutex tutulurken); açılamazsa false
+        bool StartThreadLocked() {
+            try {
+                threads.emplace_back(&ReaderScheduler::WorkerLoop, this);
+            } catch (const std::system_error& e) {
+                PCSC_LOG(kLogWarn) << "Failed to start a PC/SC worker thread: " << e.what();
+                return false;
+            }
+            return true;
+        }
+
+        void WorkerLoop() {
+            // Her havuz thread'i kendi context'ini kullanır: farklı okuyuculardaki işler pcsc-lite'ta
+            // aynı context kilidinde beklemez. Context ilk işte kurulur, thread bitince havuza döner.
+            struct ThreadContextGuard {
+                std::unique_ptr<ContextSlot> slot = g_contextPool.Acquire();
+                ThreadContextGuard() { t_threadContext = slot.get(); }
+                ~ThreadContextGuard() {
+                    t_threadContext = nullptr;
+                    g_contextPool.Release(std::move(slot));
+                }
+            } threadContext;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                idleThreads++;
+                wake.wait(lock, [this] { return stopping || !ready.empty(); });
+                idleThreads--;
+                if (stopping) return;
+
+                std::string readerKey = std::move(ready.front());
+                ready.pop_front();
+                // İş kuyrukta kalır; önde olması okuyucunun meşgul olduğunu gösterir
+                ReaderWorker* worker = queues[readerKey].front();
+                lock.unlock();
+                worker->Run();
+                lock.lock();
+
+                std::deque<ReaderWorker*>& queue = queues[readerKey];
+                queue.pop_front();
+                if (queue.empty()) {
+                    queues.erase(readerKey);
+                } else {
+                    ready.push_back(readerKey);
+                    wake.notify_one();
+                }
+
+                napi_status status = completions.NonBlockingCall(worker, Complete);
+                if (status != napi_ok) {
+                    // Sonuç JS thread'ine iletilemez (TSFN kapanıyor): iş silinir ve sayaçtan düşülür. Unref yalnız
+                    // JS thread'inden çağrılabilir; kapanan TSFN'de Ref'in etkisi yoktur, yine de sonraki Complete
+                    // sayaç sıfırlanınca 'referenced'ı kapatır.
+                    PCSC_LOG(kLogError) << "Failed to deliver PC/SC job result: " << status;
+                    delete worker;
+                    inFlight--;
+                }
+            }
+        }
+
+        static void Complete(Napi::Env env, Napi::Function /*jsCallback*/, ReaderWorker* worker);
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::map<std::string, std::deque<ReaderWorker*>> queues; // Okuyucu -> bekleyen işler (öndeki çalışıyor)
+        std::deque<std::string> ready;                           // Boşta olup işi bekleyen okuyucular
+        std::vector<std::thread> threads;
+        size_t idleThreads = 0;
+        bool stopping = false;
+        Napi::ThreadSafeFunction completions;
+        std::atomic<size_t> inFlight{0}; // Kuyruktaki ve çalışan işler
+        bool referenced = false;         // completions Ref'li mi (sadece JS thread'i)
+    };
+
+    // === Ortam Başına Eklenti Durumu ===
+    // Modül her worker_threads ortamında ayrıca başlatılır (napi_set_instance_data). Dinleyici, açık
+    // oturumlar, iş havuzu ve JS thread'inin context'i ortama aittir: bir worker'ın dinleyicisi ya da
+    // kapanışı diğerlerini etkilemez. Arka uç seçimi, ölçümler ve ATR / anahtar / okuyucu önbellekleri
+    // süreç genelidir (okuyucular ortak donanımdır) ve kendi kilitleriyle korunur.
+    struct AddonInstance {
+        ContextSlot mainContext;     // JS thread'indeki çağrılar (okuyucu listesi, ön doğrulama)
+        ContextSlot listenerContext; // Dinleyici thread'i; stopListening yalnız bunu iptal eder
+
+        std::atomic<bool> running{false};            // Listener durumu
+        std::atomic<bool> listenerExited{true};      // PollForCard döndü (durdurma iptali bunu bekler)
+        std::thread pollThread;                      // Listener thread'i
+        std::mutex listenerMutex;                    // activeListener'ı korur
+        std::unique_ptr<ListenerInfo> activeListener;
+
+        std::mutex sessionsMutex;
+        std::map<uint32_t, std::shared_ptr<CardSession>> sessions; // Açık oturumlar (id -> oturum)
+        uint32_t nextSessionId = 1;
+
+        ReaderScheduler scheduler; // Bu ortamın işleri; tamamlamalar ortamın JS thread'ine iletilir
+
+        AddonInstance() { mainContext.announce = true; }
+    };
+
+    // Yüklü ortamlar; arka uç değiştirilirken hepsinin boşta olduğu doğrulanır
+    std::mutex g_instancesMutex;
+    std::vector<AddonInstance*> g_instances;
+
+    inline AddonInstance& InstanceFor(Napi::Env env) {
+        return *env.GetInstanceData<AddonInstance>();
+    }
+
+    void ReaderScheduler::Complete(Napi::Env env, Napi::Function /*jsCallback*/, ReaderWorker* worker) {
+        ReaderScheduler& scheduler = worker->Instance().scheduler;
+        worker->Finish();
+        delete worker;
+        if (--scheduler.inFlight == 0 && scheduler.referenced) {
+            scheduler.completions.Unref(env);
+            scheduler.referenced = false;
+        }
+    }
+
+    void ReaderWorker::Queue() {
+        queuedAt = std::chrono::steady_clock::now();
+        instance->scheduler.Submit(this);
+    }
+
+    // Dinleyiciyi durdurur ve thread'ini bekler. Dinleyici süresiz beklediği ve SCardCancel kalıcı olmadığı
+    // için (running kontrolü ile SCardGetStatusChange arasına düşen iptal kaybolur) iptal, thread çıkana
+    // kadar artan aralıklarla yinelenir.
+    void StopListenerThread(AddonInstance& instance) {
+        instance.running = false;
+        auto delay = std::chrono::milliseconds(1);
+        while (!instance.listenerExited.load() && instance.listenerContext.context != 0) {
+            // Yalnız bu ortamın dinleyici context'i iptal edilir; transmit'ler ve diğer worker'ların dinleyicileri etkilenmez
+            SCardLong rv = Backend().Cancel(instance.listenerContext.context);
+            if (rv != SCARD_S_SUCCESS && rv != SCARD_E_INVALID_HANDLE) {
+                // PCSC-lite'da SCARD_W_CANCELLED_BY_USER olmayabilir, bu yüzden kontrol etme
+                PCSC_LOG(kLogWarn) << "SCardCancel failed: " << SCardErrorToString(rv);
+            }
+            std::this_thread::sleep_for(delay);
+            delay = std::min(delay * 2, std::chrono::milliseconds(50));
+        }
+        if (instance.pollThread.joinable()) {
+            try {
+                instance.pollThread.join(); // Thread'in bitmesini bekle
+            } catch (const std::system_error& e) {
+                PCSC_LOG(kLogError) << "Failed joining listener thread: " << e.what();
+            }
+        }
+    }
+
+    // Ortam kapanırken (env cleanup hook): dinleyiciyi durdurur, oturumları kapatır ve ortamın context'lerini
+    // bırakır. Diğer ortamların dinleyicileri ve context'leri etkilenmez.
+    bool CloseTapJournal(); // Tap günlüğünü kapatır (aşağıda tanımlı)
+
+    void CleanupInstance(void* arg) {
+        AddonInstance& instance = *static_cast<AddonInstance*>(arg);
+        PCSC_LOG(kLogInfo) << "Cleaning up PC/SC context...";
+        // Çalışan listener'ı durdur. SCardCancel context serbest bırakılmadan çağrılmalı.
+        StopListenerThread(instance);
+         // Listener bilgisini temizle
+        {
+            std::lock_guard<std::mutex> lock(instance.listenerMutex);
+            instance.activeListener.reset();
+        }
+        // Açık oturumları kapat (handle'lar context'e bağlı)
+        {
+            std::lock_guard<std::mutex> lock(instance.sessionsMutex);
+            for (auto& entry : instance.sessions) {
+                std::lock_guard<std::mutex> sessionLock(entry.second->mutex);
+                entry.second->Disconnect();
+            }
+            instance.sessions.clear();
+        }
+        bool lastInstance;
+        {
+            std::lock_guard<std::mutex> lock(g_instancesMutex);
+            g_instances.erase(std::remove(g_instances.begin(), g_instances.end(), &instance), g_instances.end());
+            lastInstance = g_instances.empty();
+        }
+        // Context'leri serbest bırak (havuz thread'leri zaten durdu ve slotlarını havuza bıraktı).
+        // Havuzdaki boş context'ler son ortam kapanırken bırakılır.
+        RemoveLogSink(&instance);
+        if (lastInstance) {
+            g_contextPool.Clear();
+            CloseTapJournal();
+            StopLogger(); // Sonraki mesajlar doğrudan konsola yazılır
+        }
+        std::lock_guard<std::mutex> lock(g_contextMutex);
+        ReleaseContextLocked(instance.listenerContext);
+        if (instance.mainContext.context != 0) {
+            ReleaseContextLocked(instance.mainContext);
+            PCSC_LOG(kLogInfo) << "PC/SC context released successfully.";
+        }
+    }
+
+    // Promise döndüren PC/SC işçileri için ortak taban; hata mesajına PC/SC kodunu ekler
+    class PcscPromiseWorker : public ReaderWorker {
+    public:
+        PcscPromiseWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& readerName)
+            : ReaderWorker(env, readerName),
+              deferred(deferred),
+              lastRv(SCARD_S_SUCCESS) {}
+
+    protected:
+        // Ana thread'de çalışır (hatalıysa)
+        void OnError(const Napi::Error& e) override {
+            Napi::Env env = Env();
+            std::string errorMessage = e.Message();
+            // PC/SC hata kodunu ekle (eğer set edilmişse)
+            if (lastRv != SCARD_S_SUCCESS) {
+                errorMessage += " (" + SCardErrorToString(lastRv) + ")";
+            }
+            deferred.Reject(Napi::Error::New(env, errorMessage).Value());
+        }
+
+        Napi::Promise::Deferred deferred;
+        SCardLong lastRv; // Son PC/SC hata kodu
+    };
+
+    class TransmitWorker : public PcscPromiseWorker {
+    public:
+        TransmitWorker(Napi::Env env,
+                       Napi::Promise::Deferred deferred,
+                       const std::string& readerName,
+                       const std::vector<SCardByte>& apduToSend,
+                       const ChainingOptions& chaining)
+            : PcscPromiseWorker(env, deferred, readerName),
+              readerName(readerName),
+              apduToSend(apduToSend),
+              chaining(chaining),
+              responseApdu() {}
+
+        ~TransmitWorker() override {} // Sanal yıkıcı
+
+    protected:
+        // Arka plan thread'inde çalışır
+        void Execute() override {
+            if (!EnsureContext(ThreadContext())) {
+                lastRv = SCARD_E_INVALID_HANDLE; // Veya uygun PCSC-lite kodu
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            SCARDHANDLE hCard = 0;
+            SCardDword dwActiveProtocol = 0;
+
+            // Karta bağlan (SCARD_SHARE_SHARED en yaygın)
+            ReaderStats* stats = FindStats(readerName);
+            lastRv = ConnectCard(ThreadContext(), readerName, stats, &hCard, &dwActiveProtocol);
+
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to card in reader: " + readerName);
+                return;
+            }
+
+            // RAII Guard ile bağlantının kesilmesini garanti et
+            struct CardConnectionGuard {
+                SCARDHANDLE& handleRef;
+                CardConnectionGuard(SCARDHANDLE& h) : handleRef(h) {}
+                ~CardConnectionGuard() {
+                    if (handleRef != 0) {
+                        Backend().Disconnect(handleRef, SCARD_LEAVE_CARD);
+                        handleRef = 0;
+                    }
+                }
+            } guard(hCard);
+
+            // APDU'yu gönder (istenirse yanıt/komut zincirlemesiyle)
+            lastRv = TransmitWithChaining([hCard, dwActiveProtocol, stats](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                return TransmitApdu(hCard, dwActiveProtocol, apdu, apduLength, response, stats);
+            }, apduToSend, chaining, responseApdu);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("APDU transmit/receive failed");
+                // Guard bağlantıyı kesecek
+                return;
+            }
+            // Guard bağlantıyı kesecek
+        }
+
+        // Ana thread'de çalışır (başarılıysa)
+        void OnOK() override {
+            Napi::Env env = Env();
+            // Yanıt kopyalanmadan Napi::Buffer'a devredilir
+            deferred.Resolve(TakeBuffer(env, std::move(responseApdu)));
+        }
+
+    private:
+        std::string readerName;
+        std::vector<SCardByte> apduToSend;
+        ChainingOptions chaining;
+        std::vector<SCardByte> responseApdu; // Alınan yanıt
+    };
+
+
+    // === Kart Oturumları (Kalıcı Bağlantı) ===
+
+    std::shared_ptr<CardSession> FindSession(AddonInstance& instance, uint32_t sessionId) {
+        std::lock_guard<std::mutex> lock(instance.sessionsMutex);
+        auto it = instance.sessions.find(sessionId);
+        return it != instance.sessions.end() ? it->second : nullptr;
+    }
+
+    // Oturum üzerinden APDU gönderir. Kart başka bir uygulama tarafından resetlendiyse
+    // (SCARD_W_RESET_CARD) bağlantı SCardReconnect ile yenilenir; PC/SC servisi yeniden başladıysa
+    // context yenilenip karta yeniden bağlanılır. Her iki durumda APDU bir kez tekrarlanır.
+    // Çağıran session.mutex'i tutmalıdır.
+    SCardLong SessionTransmitApdu(CardSession& session, const SCardByte* apdu, size_t apduLength,
+                                  std::vector<SCardByte>& response) {
+        SCardLong rv = TransmitApdu(session.hCard, session.activeProtocol, apdu, apduLength, response, session.stats);
+        if (rv == SCARD_W_RESET_CARD) {
+            PCSC_LOG(kLogInfo) << "Card was reset, reconnecting session " << session.id << ".";
+            auto start = std::chrono::steady_clock::now();
+            rv = Backend().Reconnect(session.hCard, SCARD_SHARE_SHARED, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1,
+                                     SCARD_LEAVE_CARD, &session.activeProtocol);
+            RecordOp(session.stats, kOpReconnect, start, rv);
+            session.reconnects++;
+            if (rv == SCARD_S_SUCCESS) {
+                rv = TransmitApdu(session.hCard, session.activeProtocol, apdu, apduLength, response, session.stats);
+            }
+        } else if (IsContextLost(rv) && RecoverContext(*session.slot, session.slot->context, rv)) {
+            PCSC_LOG(kLogInfo) << "PC/SC handle lost, reconnecting session " << session.id << ".";
+            SCARDHANDLE hCard = 0;
+            rv = ConnectCard(*session.slot, session.readerName, session.stats, &hCard, &session.activeProtocol);
+            session.reconnects++;
+            if (rv == SCARD_S_SUCCESS) {
+                session.hCard = hCard; // Eski handle eski context'le birlikte geçersizleşti
+                rv = TransmitApdu(session.hCard, session.activeProtocol, apdu, apduLength, response, session.stats);
+            }
+        }
+        return rv;
+    }
+
+    class OpenSessionWorker : public PcscPromiseWorker {
+    public:
+        OpenSessionWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& readerName)
+            : PcscPromiseWorker(env, deferred, readerName),
+              readerName(readerName),
+              sessionId(0) {}
+
+    protected:
+        void Execute() override {
+            // Her oturum kendi context'ini kullanır: diğer okuyuculardaki işlerle pcsc-lite'ta sıralanmaz
+            auto session = std::make_shared<CardSession>();
+            session->slot = g_contextPool.Acquire();
+            if (!EnsureContext(*session->slot)) {
+                lastRv = SCARD_E_INVALID_HANDLE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            session->readerName = readerName;
+            session->stats = FindStats(readerName);
+            lastRv = ConnectCard(*session->slot, readerName, session->stats, &session->hCard, &session->activeProtocol);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to card in reader: " + readerName);
+                return;
+            }
+
+            AddonInstance& instance = Instance();
+            std::lock_guard<std::mutex> lock(instance.sessionsMutex);
+            session->id = instance.nextSessionId++;
+            sessionId = session->id;
+            instance.sessions[sessionId] = session;
+        }
+
+        void OnOK() override {
+            deferred.Resolve(Napi::Number::New(Env(), sessionId));
+        }
+
+    private:
+        std::string readerName;
+        uint32_t sessionId;
+    };
+
+    class SessionTransmitWorker : public PcscPromiseWorker {
+    public:
+        SessionTransmitWorker(Napi::Env env, Napi::Promise::Deferred deferred,
+                              std::shared_ptr<CardSession> session, const std::vector<SCardByte>& apduToSend,
+                              const ChainingOptions& chaining)
+            : PcscPromiseWorker(env, deferred, session->readerName),
+              session(std::move(session)),
+              apduToSend(apduToSend),
+              chaining(chaining),
+              responseApdu() {}
+
+    protected:
+        void Execute() override {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->closed) {
+                SetError("Session is closed.");
+                return;
+            }
+            lastRv = TransmitWithChaining([this](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                return SessionTransmitApdu(*session, apdu, apduLength, response);
+            }, apduToSend, chaining, responseApdu);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("APDU transmit/receive failed");
+            }
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            deferred.Resolve(TakeBuffer(env, std::move(responseApdu)));
+        }
+
+    private:
+        std::shared_ptr<CardSession> session;
+        std::vector<SCardByte> apduToSend;
+        ChainingOptions chaining;
+        std::vector<SCardByte> responseApdu;
+    };
+
+    class CloseSessionWorker : public PcscPromiseWorker {
+    public:
+        CloseSessionWorker(Napi::Env env, Napi::Promise::Deferred deferred, std::shared_ptr<CardSession> session)
+            : PcscPromiseWorker(env, deferred, session->readerName),
+              session(std::move(session)) {}
+
+    protected:
+        void Execute() override {
+            // Devam eden transmit'lerin bitmesini bekler
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->Disconnect();
+        }
+
+        void OnOK() override {
+            deferred.Resolve(Env().Undefined());
+        }
+
+    private:
+        std::shared_ptr<CardSession> session;
+    };
+
+
+    // === APDU Betikleri (Toplu Transmit) ===
+
+    // Bir APDU listesini tek bağlantı ve tek işçi adımında çalıştırır; tüm yanıtlarla tek seferde çözülür.
+    // Okuyucu adı verilirse geçici bağlantı açılır, oturum verilirse oturumun bağlantısı kullanılır.
+    class TransmitBatchWorker : public PcscPromiseWorker {
+    public:
+        TransmitBatchWorker(Napi::Env env, Napi::Promise::Deferred deferred,
+                            const std::string& readerName, std::shared_ptr<CardSession> session,
+                            std::vector<std::vector<SCardByte>> apdus, bool stopOnError, const ChainingOptions& chaining)
+            : PcscPromiseWorker(env, deferred, session ? session->readerName : readerName),
+              readerName(readerName),
+              session(std::move(session)),
+              apdus(std::move(apdus)),
+              stopOnError(stopOnError),
+              chaining(chaining) {}
+
+    protected:
+        void Execute() override {
+            if (session) {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                if (session->closed) {
+                    SetError("Session is closed.");
+                    return;
+                }
+                RunScript([this](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                    return SessionTransmitApdu(*session, apdu, apduLength, response);
+                });
+                return;
+            }
+
+            if (!EnsureContext(ThreadContext())) {
+                lastRv = SCARD_E_INVALID_HANDLE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            SCARDHANDLE hCard = 0;
+            SCardDword dwActiveProtocol = 0;
+            ReaderStats* stats = FindStats(readerName);
+            lastRv = ConnectCard(ThreadContext(), readerName, stats, &hCard, &dwActiveProtocol);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to card in reader: " + readerName);
+                return;
+            }
+            RunScript([hCard, dwActiveProtocol, stats](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                return TransmitApdu(hCard, dwActiveProtocol, apdu, apduLength, response, stats);
+            });
+            Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            Napi::Array result = Napi::Array::New(env, responses.size());
+            for (uint32_t i = 0; i < responses.size(); i++) {
+                result.Set(i, TakeBuffer(env, std::move(responses[i])));
+            }
+            deferred.Resolve(result);
+        }
+
+    private:
+        template <typename TransmitFn>
+        void RunScript(TransmitFn&& transmit) {
+            responses.reserve(apdus.size());
+            for (size_t i = 0; i < apdus.size(); i++) {
+                std::vector<SCardByte> response;
+                lastRv = TransmitWithChaining(transmit, apdus[i], chaining, response);
+                if (lastRv != SCARD_S_SUCCESS) {
+                    SetError("APDU transmit/receive failed at index " + std::to_string(i));
+                    return;
+                }
+                responses.push_back(std::move(response));
+                if (stopOnError && StatusWord(responses.back()) != 0x9000) break;
+            }
+        }
+
+        std::string readerName;
+        std::shared_ptr<CardSession> session;
+        std::vector<std::vector<SCardByte>> apdus;
+        std::vector<std::vector<SCardByte>> responses;
+        bool stopOnError;
+        ChainingOptions chaining;
+    };
+
+
+    // === ATR Çözümleme ve Kart Türü Sınıflandırması ===
+
+    // Bir ATR'ın çözümlenmiş hali. Temassız kartlar için okuyucu PC/SC Part 3'e göre bir ATR üretir:
+    // depolama kartları (MIFARE Classic, Ultralight, ...) RID A0 00 00 03 06 ile standart ve kart adını,
+    // ISO 14443-4 kartlar ise ATS'in tarihsel baytlarını taşır.
+    struct AtrInfo {
+        std::vector<SCardByte> atr;
+        std::vector<SCardByte> historicalBytes;
+        uint32_t protocols = 0;      // Bit n: T=n (TD baytı yoksa yalnız T=0)
+        bool valid = false;          // ISO 7816-3 yapısı ve (varsa) TCK tutarlı
+        bool contactless = false;    // PC/SC Part 3 temassız ATR'ı (3B 8n 80 01 ...)
+        bool storageCard = false;    // PC/SC Part 3 depolama kartı (standard/cardName geçerli)
+        uint8_t standard = 0;        // SS: 03 = ISO 14443A part 3, 11 = FeliCa, ...
+        uint16_t cardName = 0;       // NN NN: 0001 = MIFARE Classic 1K, ...
+        const char* type = "unknown";
+    };
+
+    // PC/SC Part 3 kart adları (NN NN) ve kart türleri
+    const std::pair<uint16_t, const char*> kStorageCardTypes[] = {
+        { 0x0001, "mifare-classic-1k" },
+        { 0x0002, "mifare-classic-4k" },
+        { 0x0003, "mifare-ultralight" },
+        { 0x0014, "icode-sli" },
+        { 0x0026, "mifare-mini" },
+        { 0x002F, "jewel" },
+        { 0x0030, "topaz" },
+        { 0x003A, "mifare-ultralight-c" },
+        { 0x003B, "felica" },
+    };
+
+    // ISO 7816-3 yapısını çözer (TS, T0, arayüz baytları, tarihsel baytlar, TCK)
+    void ParseAtrStructure(AtrInfo& info) {
+        const std::vector<SCardByte>& atr = info.atr;
+        if (atr.size() < 2 || (atr[0] != 0x3B && atr[0] != 0x3F)) return;
+
+        size_t historicalCount = atr[1] & 0x0F;
+        SCardByte indicator = atr[1]; // Üst 4 bit: izleyen TA/TB/TC/TD baytları
+        size_t pos = 2;
+        bool tckPresent = false;
+        bool protocolIndicated = false;
+        while (true) {
+            for (int bit = 4; bit < 7; bit++) {
+                if (indicator & (1 << bit)) pos++; // TA, TB, TC
+            }
+            if (!(indicator & 0x80)) break;       // TD yok
+            if (pos >= atr.size()) return;
+            indicator = atr[pos++];
+            SCardByte protocol = indicator & 0x0F;
+            if (protocol != 15) {                   // T=15 genel arayüz baytlarını gösterir, protokol değil
+                info.protocols |= 1u << protocol;
+                protocolIndicated = true;
+            }
+            if (protocol != 0) tckPresent = true;
+        }
+        if (!protocolIndicated) info.protocols = 1u << 0;
+        if (pos + historicalCount > atr.size()) return;
+        info.historicalBytes.assign(atr.begin() + pos, atr.begin() + pos + historicalCount);
+        pos += historicalCount;
+
+        if (tckPresent) {
+            if (pos + 1 != atr.size()) return;
+            SCardByte check = 0;
+            for (size_t i = 1; i < atr.size(); i++) check ^= atr[i]; // T0'dan TCK'ya XOR sıfır olmalı
+            info.valid = check == 0;
+        } else {
+            info.valid = pos == atr.size();
+        }
+    }
+
+    // Kart türünü yalnızca ATR'dan belirler; APDU gerektirmez
+    void ClassifyAtr(AtrInfo& info) {
+        const std::vector<SCardByte>& atr = info.atr;
+        const std::vector<SCardByte>& historical = info.historicalBytes;
+        info.contactless = info.valid && atr.size() >= 4 && atr[0] == 0x3B && (atr[1] & 0xF0) == 0x80
+                        && atr[2] == 0x80 && atr[3] == 0x01;
+        if (!info.valid) return;
+        if (!info.contactless) {
+            info.type = "contact";
+            return;
+        }
+
+        // Depolama kartı: 80 4F 0C <RID A0 00 00 03 06> SS NN NN 00 00 00 00
+        static const SCardByte kPcscRid[] = { 0xA0, 0x00, 0x00, 0x03, 0x06 };
+        if (historical.size() >= 11 && historical[0] == 0x80 && historical[1] == 0x4F
+                && memcmp(historical.data() + 3, kPcscRid, sizeof(kPcscRid)) == 0) {
+            info.storageCard = true;
+            info.standard = historical[8];
+            info.cardName = static_cast<uint16_t>((historical[9] << 8) | historical[10]);
+            info.type = "storage";
+            for (const auto& entry : kStorageCardTypes) {
+                if (entry.first == info.cardName) info.type = entry.second;
+            }
+            return;
+        }
+
+        // ISO 14443-4 (ISO-DEP): tarihsel baytlar ATS'ten gelir
+        static const SCardByte kMifarePlusPrefix[] = { 0xC1, 0x05, 0x2F, 0x2F };
+        if (historical.size() == 1 && historical[0] == 0x80) {
+            info.type = "mifare-desfire"; // DESFire EV1/EV2/EV3 ATS'i yalnız kategori baytı taşır
+        } else if (historical.size() >= sizeof(kMifarePlusPrefix)
+                && memcmp(historical.data(), kMifarePlusPrefix, sizeof(kMifarePlusPrefix)) == 0) {
+            info.type = "mifare-plus";
+        } else {
+            info.type = "iso14443-4"; // Telefonlar (HCE), banka kartları, kimlik kartları, ...
+        }
+    }
+
+    // ATR -> sınıflandırma önbelleği. Aynı kart türleri tekrar tekrar okunduğundan her dokunuşta
+    // çözümleme yerine tek bir arama yapılır; sınır aşılırsa önbellek boşaltılır.
+    const size_t kMaxAtrCacheEntries = 256;
+    std::mutex g_atrCacheMutex;
+    std::map<std::vector<SCardByte>, std::shared_ptr<const AtrInfo>> g_atrCache;
+    std::atomic<uint64_t> g_atrCacheHits{0};
+    std::atomic<uint64_t> g_atrCacheMisses{0};
+
+    std::shared_ptr<const AtrInfo> LookupAtr(const SCardByte* atr, size_t length) {
+        std::vector<SCardByte> key(atr, atr + length);
+        {
+            std::lock_guard<std::mutex> lock(g_atrCacheMutex);
+            auto it = g_atrCache.find(key);
+            if (it != g_atrCache.end()) {
+                g_atrCacheHits.fetch_add(1, std::memory_order_relaxed);
+                return it->second;
+            }
+        }
+        g_atrCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+        auto info = std::make_shared<AtrInfo>();
+        info->atr = key;
+        ParseAtrStructure(*info);
+        ClassifyAtr(*info);
+
+        std::lock_guard<std::mutex> lock(g_atrCacheMutex);
+        if (g_atrCache.size() >= kMaxAtrCacheEntries) g_atrCache.clear();
+        g_atrCache[std::move(key)] = info;
+        return info;
+    }
+
+    // JS nesnesi: { atr, type, historicalBytes, protocols, contactless, valid[, standard, cardName] }
+    Napi::Object AtrInfoToObject(Napi::Env env, const AtrInfo& info) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("atr", Napi::Buffer<SCardByte>::Copy(env, info.atr.data(), info.atr.size()));
+        result.Set("type", Napi::String::New(env, info.type));
+        result.Set("historicalBytes", Napi::Buffer<SCardByte>::Copy(env, info.historicalBytes.data(), info.historicalBytes.size()));
+        Napi::Array protocols = Napi::Array::New(env);
+        uint32_t protocolCount = 0;
+        for (uint32_t t = 0; t < 15; t++) {
+            if (info.protocols & (1u << t)) protocols.Set(protocolCount++, Napi::Number::New(env, t));
+        }
+        result.Set("protocols", protocols);
+        result.Set("contactless", Napi::Boolean::New(env, info.contactless));
+        result.Set("valid", Napi::Boolean::New(env, info.valid));
+        if (info.storageCard) {
+            result.Set("standard", Napi::Number::New(env, info.standard));
+            result.Set("cardName", Napi::Number::New(env, info.cardName));
+        }
+        return result;
+    }
+
+
+    // === Okuyucu Listesi ve Durum Görüntüsü (Asenkron) ===
+
+    // SCardGetStatusChange durum bayraklarının JS'e verilen adları
+    const std::pair<SCardDword, const char*> kReaderStateFlags[] = {
+        { SCARD_STATE_IGNORE, "ignore" },
+        { SCARD_STATE_UNKNOWN, "unknown" },
+        { SCARD_STATE_UNAVAILABLE, "unavailable" },
+        { SCARD_STATE_EMPTY, "empty" },
+        { SCARD_STATE_PRESENT, "present" },
+        { SCARD_STATE_ATRMATCH, "atrmatch" },
+        { SCARD_STATE_EXCLUSIVE, "exclusive" },
+        { SCARD_STATE_INUSE, "inuse" },
+        { SCARD_STATE_MUTE, "mute" },
+        { SCARD_STATE_UNPOWERED, "unpowered" },
+    };
+
+    // Okuyucu adlarını JS thread'ini bekletmeden listeler
+    class ListReadersWorker : public PcscPromiseWorker {
+    public:
+        ListReadersWorker(Napi::Env env, Napi::Promise::Deferred deferred)
+            : PcscPromiseWorker(env, deferred, kControlQueueKey) {}
+
+    protected:
+        void Execute() override {
+            if (!EnsureContext(ThreadContext())) {
+                lastRv = SCARD_E_NO_SERVICE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+            lastRv = ListReaderNames(ThreadContext(), readerNames);
+            if (lastRv != SCARD_S_SUCCESS) {
+                CountError(lastRv);
+                SetError("Failed to list readers");
+                return;
+            }
+            UpdateReaderCache(readerNames);
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            Napi::Array result = Napi::Array::New(env, readerNames.size());
+            for (uint32_t i = 0; i < readerNames.size(); i++) {
+                result.Set(i, Napi::String::New(env, readerNames[i]));
+            }
+            deferred.Resolve(result);
+        }
+
+        std::vector<std::string> readerNames;
+    };
+
+    // Tüm okuyucuların durumunu (bayraklar, ATR, kart varlığı) tek bir sıfır timeout'lu
+    // SCardGetStatusChange çağrısıyla okur. UNAWARE ile sorulan okuyucular beklemeden raporlanır.
+    class ReaderStatusWorker : public PcscPromiseWorker {
+    public:
+        ReaderStatusWorker(Napi::Env env, Napi::Promise::Deferred deferred)
+            : PcscPromiseWorker(env, deferred, kControlQueueKey) {}
+
+    protected:
+        void Execute() override {
+            ContextSlot& slot = ThreadContext();
+            if (!EnsureContext(slot)) {
+                lastRv = SCARD_E_NO_SERVICE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            // Listeleme ile durum okuma arasında okuyucu çıkarılırsa liste bir kez yenilenir
+            for (int attempt = 0; attempt < 2; attempt++) {
+                readerNames.clear();
+                lastRv = ListReaderNames(slot, readerNames);
+                if (lastRv != SCARD_S_SUCCESS) {
+                    CountError(lastRv);
+                    SetError("Failed to list readers");
+                    return;
+                }
+                UpdateReaderCache(readerNames);
+                if (readerNames.empty()) return;
+
+                states.assign(readerNames.size(), SCardReaderState());
+                for (size_t i = 0; i < readerNames.size(); i++) {
+                    states[i].szReader = readerNames[i].c_str();
+                    states[i].dwCurrentState = SCARD_STATE_UNAWARE;
+                }
+                lastRv = Backend().GetStatusChange(slot.context, 0, states.data(), (SCardDword)states.size());
+                if (lastRv == SCARD_E_TIMEOUT) lastRv = SCARD_S_SUCCESS; // Değişiklik yok; durumlar doldurulmuştur
+                if (lastRv != SCARD_E_UNKNOWN_READER) break;
+            }
+            if (lastRv != SCARD_S_SUCCESS) {
+                CountError(lastRv);
+                SetError("Failed to read reader status");
+            }
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            Napi::Array result = Napi::Array::New(env, readerNames.size());
+            for (uint32_t i = 0; i < readerNames.size(); i++) {
+                const SCardReaderState& state = states[i];
+                SCardDword flags = state.dwEventState & 0xFFFF & ~SCARD_STATE_CHANGED; // Üst 16 bit olay sayacı
+
+                Napi::Object entry = Napi::Object::New(env);
+                entry.Set("name", Napi::String::New(env, readerNames[i]));
+                entry.Set("state", Napi::Number::New(env, flags));
+                Napi::Array flagNames = Napi::Array::New(env);
+                uint32_t flagCount = 0;
+                for (const auto& flag : kReaderStateFlags) {
+                    if (flags & flag.first) flagNames.Set(flagCount++, Napi::String::New(env, flag.second));
+                }
+                entry.Set("flags", flagNames);
+                bool present = (flags & SCARD_STATE_PRESENT) != 0;
+                entry.Set("cardPresent", Napi::Boolean::New(env, present));
+                size_t atrLength = std::min<size_t>(state.cbAtr, sizeof(state.rgbAtr));
+                if (present && atrLength > 0) {
+                    entry.Set("atr", Napi::Buffer<SCardByte>::Copy(env, state.rgbAtr, atrLength));
+                    entry.Set("cardType", Napi::String::New(env, LookupAtr(state.rgbAtr, atrLength)->type));
+                } else {
+                    entry.Set("atr", env.Null());
+                    entry.Set("cardType", env.Null());
+                }
+                result.Set(i, entry);
+            }
+            deferred.Resolve(result);
+        }
+
+        std::vector<std::string> readerNames;
+        std::vector<SCardReaderState> states; // szReader, readerNames'teki dizgelere işaret eder
+    };
+
+
+    // === Bellek Okuma (MIFARE Classic / Ultralight / NTAG) ===
+
+    // MIFARE Classic anahtarı; okuyucunun geçici anahtar yuvasına (FF 82) yüklenir
+    struct MifareKey {
+        SCardByte type = 0x60;   // 0x60: Key A, 0x61: Key B
+        SCardByte key[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+        bool operator==(const MifareKey& other) const {
+            return type == other.type && memcmp(key, other.key, sizeof(key)) == 0;
+        }
+    };
+
+    // UID başına hangi anahtarın hangi sektörü açtığı. Aynı kart tekrar okunduğunda her sektör ilk
+    // denemede doğru anahtarla doğrulanır; sınır aşılırsa önbellek boşaltılır.
+    const size_t kMaxSectorKeyCacheCards = 1024;
+    std::mutex g_sectorKeyCacheMutex;
+    std::map<std::vector<SCardByte>, std::map<int, MifareKey>> g_sectorKeyCache;
+
+    bool FindSectorKey(const std::vector<SCardByte>& uid, int sector, MifareKey& key) {
+        std::lock_guard<std::mutex> lock(g_sectorKeyCacheMutex);
+        auto card = g_sectorKeyCache.find(uid);
+        if (card == g_sectorKeyCache.end()) return false;
+        auto entry = card->second.find(sector);
+        if (entry == card->second.end()) return false;
+        key = entry->second;
+        return true;
+    }
+
+    void StoreSectorKey(const std::vector<SCardByte>& uid, int sector, const MifareKey& key) {
+        std::lock_guard<std::mutex> lock(g_sectorKeyCacheMutex);
+        if (g_sectorKeyCache.size() >= kMaxSectorKeyCacheCards && g_sectorKeyCache.find(uid) == g_sectorKeyCache.end()) {
+            g_sectorKeyCache.clear();
+        }
+        g_sectorKeyCache[uid][sector] = key;
+    }
+
+    // MIFARE Classic düzeni: ilk 32 sektör 4 blok, 4K kartlarda sonraki 8 sektör 16 blok
+    inline int ClassicSectorOf(int block) { return block < 128 ? block / 4 : 32 + (block - 128) / 16; }
+    inline int ClassicFirstBlock(int sector) { return sector < 32 ? sector * 4 : 128 + (sector - 32) * 16; }
+    inline int ClassicBlocksIn(int sector) { return sector < 32 ? 4 : 16; }
+
+    // Kart türüne göre bellek birimi (Classic: 16 baytlık blok, Ultralight/NTAG: 4 baytlık sayfa)
+    struct MemoryLayout {
+        bool classic = false;
+        uint32_t unitSize = 0;
+        uint32_t units = 0;      // Bilinen toplam birim (count verilmezse okunan); Ultralight ailesinde asgari boyut
+    };
+
+    bool MemoryLayoutFor(const std::string& type, MemoryLayout& layout) {
+        if (type == "mifare-classic-1k") layout = MemoryLayout{ true, 16, 64 };
+        else if (type == "mifare-classic-4k") layout = MemoryLayout{ true, 16, 256 };
+        else if (type == "mifare-mini") layout = MemoryLayout{ true, 16, 20 };
+        else if (type == "mifare-ultralight") layout = MemoryLayout{ false, 4, 16 }; // NTAG21x da bu ATR ile gelir
+        else if (type == "mifare-ultralight-c") layout = MemoryLayout{ false, 4, 48 };
+        else return false;
+        return true;
+    }
+
+    // Okuyucudaki kartın ATR'ını sıfır timeout'lu SCardGetStatusChange ile okur (karta APDU gitmez)
+    SCardLong ReadReaderAtr(SCARDCONTEXT context, const std::string& readerName, std::vector<SCardByte>& atr) {
+        SCardReaderState state = SCardReaderState();
+        state.szReader = readerName.c_str();
+        state.dwCurrentState = SCARD_STATE_UNAWARE;
+        SCardLong rv = Backend().GetStatusChange(context, 0, &state, 1);
+        if (rv == SCARD_E_TIMEOUT) rv = SCARD_S_SUCCESS;
+        if (rv != SCARD_S_SUCCESS) return rv;
+        atr.assign(state.rgbAtr, state.rgbAtr + std::min<size_t>(state.cbAtr, sizeof(state.rgbAtr)));
+        return SCARD_S_SUCCESS;
+    }
+
+    // Kart belleğini PC/SC Part 3 sözde APDU'larıyla (FF CA / FF 82 / FF 86 / FF B0) tek bağlantıda okur.
+    // Classic kartlarda sektör başına bir doğrulama yapılır ve okuyucu destekliyorsa sektörün blokları
+    // tek READ BINARY ile alınır; anahtar yalnız değiştiğinde yeniden yüklenir.
+    class ReadMemoryWorker : public PcscPromiseWorker {
+    public:
+        ReadMemoryWorker(Napi::Env env, Napi::Promise::Deferred deferred,
+                         const std::string& readerName, std::shared_ptr<CardSession> session,
+                         uint32_t start, uint32_t count, std::vector<MifareKey> keys)
+            : PcscPromiseWorker(env, deferred, session ? session->readerName : readerName),
+              readerName(session ? session->readerName : readerName),
+              session(std::move(session)),
+              start(start),
+              count(count),
+              keys(std::move(keys)) {}
+
+    protected:
+        void Execute() override {
+            if (session) {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                if (session->closed) {
+                    SetError("Session is closed.");
+                    return;
+                }
+                ReadCard(session->slot->context, [this](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                    return SessionTransmitApdu(*session, apdu, apduLength, response);
+                });
+                return;
+            }
+
+            if (!EnsureContext(ThreadContext())) {
+                lastRv = SCARD_E_INVALID_HANDLE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            SCARDHANDLE hCard = 0;
+            SCardDword dwActiveProtocol = 0;
+            ReaderStats* stats = FindStats(readerName);
+            lastRv = ConnectCard(ThreadContext(), readerName, stats, &hCard, &dwActiveProtocol);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to card in reader: " + readerName);
+                return;
+            }
+            ReadCard(ThreadContext().context, [hCard, dwActiveProtocol, stats](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                return TransmitApdu(hCard, dwActiveProtocol, apdu, apduLength, response, stats);
+            });
+            Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            deferred.Resolve(TakeBuffer(env, std::move(memory)));
+        }
+
+    private:
+        template <typename TransmitFn>
+        void ReadCard(SCARDCONTEXT context, TransmitFn&& transmit) {
+            std::vector<SCardByte> atr;
+            lastRv = ReadReaderAtr(context, readerName, atr);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to read the card's ATR");
+                return;
+            }
+            MemoryLayout layout;
+            std::string type = atr.empty() ? "unknown" : LookupAtr(atr.data(), atr.size())->type;
+            if (!MemoryLayoutFor(type, layout)) {
+                SetError("readMemory supports MIFARE Classic and Ultralight / NTAG cards, found: " + type);
+                return;
+            }
+            if (count == 0) count = start < layout.units ? layout.units - start : 0;
+            if (count == 0 || (layout.classic && start + count > layout.units)) {
+                SetError("Memory range is outside the card (" + std::to_string(layout.units) + " blocks).");
+                return;
+            }
+            memory.reserve(static_cast<size_t>(count) * layout.unitSize);
+
+            if (layout.classic) {
+                ReadClassic(transmit);
+            } else {
+                ReadUltralight(transmit);
+            }
+        }
+
+        // Ultralight / NTAG: READ BINARY her seferinde 4 sayfa (16 bayt) döner
+        template <typename TransmitFn>
+        void ReadUltralight(TransmitFn&& transmit) {
+            std::vector<SCardByte> response;
+            for (uint32_t page = start; page < start + count; page += 4) {
+                SCardByte read[] = { 0xFF, 0xB0, static_cast<SCardByte>(page >> 8), static_cast<SCardByte>(page & 0xFF), 0x10 };
+                if (!Exchange(transmit, read, sizeof(read), response, "Read failed at page " + std::to_string(page))) return;
+                size_t wanted = std::min<size_t>(16, static_cast<size_t>(start + count - page) * 4);
+                if (response.size() - 2 < wanted) {
+                    SetError("Short read at page " + std::to_string(page));
+                    return;
+                }
+                memory.insert(memory.end(), response.begin(), response.begin() + wanted);
+            }
+        }
+
+        template <typename TransmitFn>
+        void ReadClassic(TransmitFn&& transmit) {
+            std::vector<SCardByte> response;
+            SCardByte getUid[] = { 0xFF, 0xCA, 0x00, 0x00, 0x00 };
+            if (!Exchange(transmit, getUid, sizeof(getUid), response, "Failed to read UID")) return;
+            std::vector<SCardByte> uid(response.begin(), response.end() - 2);
+
+            int lastBlock = static_cast<int>(start + count) - 1;
+            for (int sector = ClassicSectorOf(start); sector <= ClassicSectorOf(lastBlock); sector++) {
+                int first = std::max(ClassicFirstBlock(sector), static_cast<int>(start));
+                int last = std::min(ClassicFirstBlock(sector) + ClassicBlocksIn(sector) - 1, lastBlock);
+                if (!Authenticate(transmit, uid, sector)) return;
+
+                // Okuyucu destekliyorsa sektördeki bloklar tek READ BINARY ile (Le = n * 16)
+                int blocks = last - first + 1;
+                if (multiBlockReads && blocks > 1) {
+                    SCardByte read[] = { 0xFF, 0xB0, 0x00, static_cast<SCardByte>(first), static_cast<SCardByte>(blocks * 16) };
+                    lastRv = transmit(read, sizeof(read), response);
+                    if (lastRv != SCARD_S_SUCCESS) {
+                        SetError("Read failed at block " + std::to_string(first));
+                        return;
+                    }
+                    if (StatusWord(response) == 0x9000 && response.size() == static_cast<size_t>(blocks) * 16 + 2) {
+                        memory.insert(memory.end(), response.begin(), response.end() - 2);
+                        continue;
+                    }
+                    multiBlockReads = false; // Bu okuyucu blok blok okuyor; bu çağrıda tekrar deneme
+                }
+                for (int block = first; block <= last; block++) {
+                    SCardByte read[] = { 0xFF, 0xB0, 0x00, static_cast<SCardByte>(block), 0x10 };
+                    if (!Exchange(transmit, read, sizeof(read), response, "Read failed at block " + std::to_string(block))) return;
+                    if (response.size() != 18) {
+                        SetError("Short read at block " + std::to_string(block));
+                        return;
+                    }
+                    memory.insert(memory.end(), response.begin(), response.end() - 2);
+                }
+            }
+        }
+
+        // Önce bu UID için önbellekteki anahtar, sonra verilen anahtarlar sırayla denenir
+        template <typename TransmitFn>
+        bool Authenticate(TransmitFn&& transmit, const std::vector<SCardByte>& uid, int sector) {
+            std::vector<MifareKey> candidates;
+            MifareKey cached;
+            bool hasCached = FindSectorKey(uid, sector, cached);
+            if (hasCached) candidates.push_back(cached);
+            for (const auto& key : keys) {
+                if (std::find(candidates.begin(), candidates.end(), key) == candidates.end()) candidates.push_back(key);
+            }
+
+            std::vector<SCardByte> response;
+            for (const auto& key : candidates) {
+                if (!keyLoaded || !(loadedKey == key)) {
+                    SCardByte load[11] = { 0xFF, 0x82, 0x00, 0x00, 0x06 };
+                    memcpy(load + 5, key.key, sizeof(key.key));
+                    if (!Exchange(transmit, load, sizeof(load), response, "Failed to load key")) return false;
+                    loadedKey = key;
+                    keyLoaded = true;
+                }
+                SCardByte authenticate[] = { 0xFF, 0x86, 0x00, 0x00, 0x05, 0x01, 0x00,
+                                             static_cast<SCardByte>(ClassicFirstBlock(sector)), key.type, 0x00 };
+                lastRv = transmit(authenticate, sizeof(authenticate), response);
+                if (lastRv != SCARD_S_SUCCESS) {
+                    SetError("Authentication failed for sector " + std::to_string(sector));
+                    return false;
+                }
+                if (StatusWord(response) == 0x9000) {
+                    if (!hasCached || !(key == cached)) StoreSectorKey(uid, sector, key);
+                    return true;
+                }
+            }
+            SetError("No key authenticated sector " + std::to_string(sector));
+            return false;
+        }
+
+        // APDU'yu gönderir; PC/SC hatası veya 9000 dışı SW'de hata mesajını ayarlar
+        template <typename TransmitFn>
+        bool Exchange(TransmitFn&& transmit, const SCardByte* apdu, size_t apduLength,
+                      std::vector<SCardByte>& response, const std::string& what) {
+            lastRv = transmit(apdu, apduLength, response);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError(what);
+                return false;
+            }
+            if (StatusWord(response) != 0x9000) {
+                char sw[8];
+                snprintf(sw, sizeof(sw), "%04X", StatusWord(response));
+                SetError(what + " (SW " + sw + ")");
+                return false;
+            }
+            return true;
+        }
+
+        std::string readerName;
+        std::shared_ptr<CardSession> session;
+        uint32_t start;
+        uint32_t count;                 // 0: karttaki son birime kadar
+        std::vector<MifareKey> keys;
+        std::vector<SCardByte> memory;
+        MifareKey loadedKey;            // Okuyucunun geçici yuvasındaki anahtar
+        bool keyLoaded = false;
+        bool multiBlockReads = true;
+    };
+
+
+    // === AES-128 ve DESFire EV2 Güvenli Mesajlaşma ===
+    // DESFire EV2 kimlik doğrulaması (AuthenticateEV2First), oturum anahtarı türetme ve komut başına
+    // MAC / şifreleme / doğrulama iş thread'inde, tek bağlantı üzerinde yapılır; kimlik doğrulanmış bir
+    // okuma JS'e tek bir asenkron çağrıdır. Harici kripto kütüphanesine bağımlılık eklememek için
+    // AES-128 burada tanımlıdır (yalnızca ECB blok, CBC ve CMAC gerekir).
+
+    const SCardByte kAesSbox[256] = {
+        0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+        0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+        0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+        0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+        0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+        0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+        0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+        0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+        0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+        0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+        0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+        0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+        0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+        0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+        0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+        0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+    };
+
+    // Ters S-kutusu S-kutusundan bir kez üretilir
+    struct AesInverseSbox {
+        SCardByte table[256];
+        AesInverseSbox() {
+            for (int i = 0; i < 256; i++) table[kAesSbox[i]] = static_cast<SCardByte>(i);
+        }
+    };
+    const AesInverseSbox kAesInverseSbox;
+
+    inline SCardByte AesXtime(SCardByte value) {
+        return static_cast<SCardByte>((value << 1) ^ ((value & 0x80) ? 0x1B : 0x00));
+    }
+
+    inline SCardByte AesMultiply(SCardByte a, SCardByte b) {
+        SCardByte result = 0;
+        while (b) {
+            if (b & 1) result ^= a;
+            a = AesXtime(a);
+            b >>= 1;
+        }
+        return result;
+    }
+
+    // Anahtar ve ara değerleri bellekten siler (derleyici eleyemesin diye volatile)
+    inline void SecureWipe(void* data, size_t length) {
+        volatile SCardByte* bytes = static_cast<volatile SCardByte*>(data);
+        while (length--) *bytes++ = 0;
+    }
+
+    const size_t kAesBlockSize = 16;
+
+    class Aes128 {
+    public:
+        Aes128() { memset(roundKeys, 0, sizeof(roundKeys)); }
+        explicit Aes128(const SCardByte* key) { SetKey(key); }
+        Aes128(const Aes128& other) { memcpy(roundKeys, other.roundKeys, sizeof(roundKeys)); }
+        Aes128& operator=(const Aes128& other) {
+            memcpy(roundKeys, other.roundKeys, sizeof(roundKeys));
+            return *this;
+        }
+        ~Aes128() { SecureWipe(roundKeys, sizeof(roundKeys)); }
+
+        void SetKey(const SCardByte* key) {
+            static const SCardByte kRcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+            memcpy(roundKeys, key, kAesBlockSize);
+            for (int i = 4; i < 44; i++) {
+                SCardByte word[4];
+                memcpy(word, roundKeys + 4 * (i - 1), 4);
+                if (i % 4 == 0) {
+                    SCardByte first = word[0];
+                    word[0] = static_cast<SCardByte>(kAesSbox[word[1]] ^ kRcon[i / 4 - 1]);
+                    word[1] = kAesSbox[word[2]];
+                    word[2] = kAesSbox[word[3]];
+                    word[3] = kAesSbox[first];
+                }
+                for (int j = 0; j < 4; j++) roundKeys[4 * i + j] = roundKeys[4 * (i - 4) + j] ^ word[j];
+            }
+        }
+
+        void EncryptBlock(const SCardByte* in, SCardByte* out) const {
+            SCardByte state[16];
+            for (int i = 0; i < 16; i++) state[i] = in[i] ^ roundKeys[i];
+            for (int round = 1; round <= 10; round++) {
+                SCardByte shifted[16];
+                // SubBytes + ShiftRows (durum sütun sıralı: state[4 * sütun + satır])
+                for (int column = 0; column < 4; column++) {
+                    for (int row = 0; row < 4; row++) {
+                        shifted[4 * column + row] = kAesSbox[state[4 * ((column + row) % 4) + row]];
+                    }
+                }
+                if (round < 10) {
+                    for (int column = 0; column < 4; column++) {
+                        SCardByte* c = shifted + 4 * column;
+                        SCardByte all = c[0] ^ c[1] ^ c[2] ^ c[3];
+                        SCardByte first = c[0];
+                        c[0] ^= all ^ AesXtime(c[0] ^ c[1]);
+                        c[1] ^= all ^ AesXtime(c[1] ^ c[2]);
+                        c[2] ^= all ^ AesXtime(c[2] ^ c[3]);
+                        c[3] ^= all ^ AesXtime(c[3] ^ first);
+                    }
+                }
+                for (int i = 0; i < 16; i++) state[i] = shifted[i] ^ roundKeys[16 * round + i];
+            }
+            memcpy(out, state, sizeof(state));
+        }
+
+        void DecryptBlock(const SCardByte* in, SCardByte* out) const {
+            SCardByte state[16];
+            for (int i = 0; i < 16; i++) state[i] = in[i] ^ roundKeys[160 + i];
+            for (int round = 9; round >= 0; round--) {
+                SCardByte shifted[16];
+                // InvShiftRows + InvSubBytes
+                for (int column = 0; column < 4; column++) {
+                    for (int row = 0; row < 4; row++) {
+                        shifted[4 * ((column + row) % 4) + row] = kAesInverseSbox.table[state[4 * column + row]];
+                    }
+                }
+                for (int i = 0; i < 16; i++) shifted[i] ^= roundKeys[16 * round + i];
+                if (round > 0) {
+                    for (int column = 0; column < 4; column++) {
+                        SCardByte* c = shifted + 4 * column;
+                        SCardByte a0 = c[0], a1 = c[1], a2 = c[2], a3 = c[3];
+                        c[0] = AesMultiply(a0, 14) ^ AesMultiply(a1, 11) ^ AesMultiply(a2, 13) ^ AesMultiply(a3, 9);
+                        c[1] = AesMultiply(a0, 9) ^ AesMultiply(a1, 14) ^ AesMultiply(a2, 11) ^ AesMultiply(a3, 13);
+                        c[2] = AesMultiply(a0, 13) ^ AesMultiply(a1, 9) ^ AesMultiply(a2, 14) ^ AesMultiply(a3, 11);
+                        c[3] = AesMultiply(a0, 11) ^ AesMultiply(a1, 13) ^ AesMultiply(a2, 9) ^ AesMultiply(a3, 14);
+                    }
+                }
+                memcpy(state, shifted, sizeof(state));
+            }
+            memcpy(out, state, sizeof(state));
+        }
+
+        // CBC; length blok boyutunun katı olmalı. iv sonraki zincir için güncellenir.
+        void CbcEncrypt(SCardByte* data, size_t length, SCardByte* iv) const {
+            for (size_t offset = 0; offset < length; offset += kAesBlockSize) {
+                for (size_t i = 0; i < kAesBlockSize; i++) data[offset + i] ^= iv[i];
+                EncryptBlock(data + offset, data + offset);
+                memcpy(iv, data + offset, kAesBlockSize);
+            }
+        }
+
+        void CbcDecrypt(SCardByte* data, size_t length, SCardByte* iv) const {
+            SCardByte next[kAesBlockSize];
+            for (size_t offset = 0; offset < length; offset += kAesBlockSize) {
+                memcpy(next, data + offset, kAesBlockSize);
+                DecryptBlock(data + offset, data + offset);
+                for (size_t i = 0; i < kAesBlockSize; i++) data[offset + i] ^= iv[i];
+                memcpy(iv, next, kAesBlockSize);
+            }
+        }
+
+        // AES-CMAC (NIST SP 800-38B / RFC 4493)
+        void Cmac(const SCardByte* data, size_t length, SCardByte* mac) const {
+            SCardByte k1[kAesBlockSize] = {0};
+            SCardByte k2[kAesBlockSize];
+            EncryptBlock(k1, k1);
+            auto shift = [](const SCardByte* in, SCardByte* out) {
+                SCardByte carry = in[0] & 0x80;
+                for (size_t i = 0; i < kAesBlockSize - 1; i++) out[i] = static_cast<SCardByte>((in[i] << 1) | (in[i + 1] >> 7));
+                out[kAesBlockSize - 1] = static_cast<SCardByte>(in[kAesBlockSize - 1] << 1);
+                if (carry) out[kAesBlockSize - 1] ^= 0x87;
+            };
+            shift(k1, k1);
+            shift(k1, k2);
+
+            size_t blocks = length == 0 ? 1 : (length + kAesBlockSize - 1) / kAesBlockSize;
+            bool complete = length != 0 && length % kAesBlockSize == 0;
+            SCardByte state[kAesBlockSize] = {0};
+            for (size_t block = 0; block < blocks; block++) {
+                SCardByte input[kAesBlockSize] = {0};
+                size_t offset = block * kAesBlockSize;
+                size_t take = std::min(kAesBlockSize, length - std::min(length, offset));
+                memcpy(input, data + offset, take);
+                if (block == blocks - 1) {
+                    if (!complete) input[take] = 0x80;
+                    const SCardByte* subkey = complete ? k1 : k2;
+                    for (size_t i = 0; i < kAesBlockSize; i++) input[i] ^= subkey[i];
+                }
+                for (size_t i = 0; i < kAesBlockSize; i++) state[i] ^= input[i];
+                EncryptBlock(state, state);
+            }
+            memcpy(mac, state, kAesBlockSize);
+            SecureWipe(k1, sizeof(k1));
+            SecureWipe(k2, sizeof(k2));
+        }
+
+    private:
+        SCardByte roundKeys[176];
+    };
+
+    // DESFire iletişim modları (dosya ayarlarındaki kodlamayla)
+    enum DesfireCommMode : uint8_t { kCommPlain = 0x00, kCommMac = 0x01, kCommFull = 0x03 };
+
+    const size_t kDesfireMacLength = 8;      // Kesilmiş MAC (CMAC'in tek indeksli baytları)
+    const size_t kDesfireMaxFrameData = 255; // ISO 7816-4 kısa APDU Lc sınırı; komut tek çerçevede gönderilir
+    const size_t kDesfireMaxFrames = 256;    // Ek çerçeve (AF) sınırı; kart sonsuza kadar AF dönerse
+
+    // AuthenticateEV2First sonrası oturum durumu
+    struct DesfireSecureChannel {
+        Aes128 encKey;            // KSesAuthENC
+        Aes128 macKey;            // KSesAuthMAC
+        SCardByte ti[4];          // Transaction Identifier
+        uint16_t commandCounter = 0;
+    };
+
+    const char* DesfireStatusName(SCardByte status) {
+        switch (status) {
+            case 0x0C: return "NO_CHANGES";
+            case 0x0E: return "OUT_OF_EEPROM_ERROR";
+            case 0x1C: return "ILLEGAL_COMMAND_CODE";
+            case 0x1E: return "INTEGRITY_ERROR";
+            case 0x40: return "NO_SUCH_KEY";
+            case 0x7E: return "LENGTH_ERROR";
+            case 0x9D: return "PERMISSION_DENIED";
+            case 0x9E: return "PARAMETER_ERROR";
+            case 0xA0: return "APPLICATION_NOT_FOUND";
+            case 0xAE: return "AUTHENTICATION_ERROR";
+            case 0xAF: return "ADDITIONAL_FRAME";
+            case 0xBE: return "BOUNDARY_ERROR";
+            case 0xCA: return "COMMAND_ABORTED";
+            case 0xEE: return "MEMORY_ERROR";
+            case 0xF0: return "FILE_NOT_FOUND";
+            default: return "UNKNOWN_ERROR";
+        }
+    }
+
+    std::string DesfireStatusError(SCardByte command, SCardByte status) {
+        char text[96];
+        snprintf(text, sizeof(text), "DESFire command 0x%02X failed with status 0x%02X (%s)", command, status, DesfireStatusName(status));
+        return text;
+    }
+
+    // Komut çerçevesinin (başlık + veri + dolgu + MAC) uzunluğu; tek çerçeveye sığıp sığmadığını kontrol etmek için
+    size_t DesfireFrameLength(size_t headerLength, size_t dataLength, DesfireCommMode mode, bool authenticated) {
+        size_t length = headerLength + dataLength;
+        if (authenticated && mode == kCommFull && dataLength > 0) {
+            length = headerLength + (dataLength / kAesBlockSize + 1) * kAesBlockSize;
+        }
+        if (authenticated && mode != kCommPlain) length += kDesfireMacLength;
+        return length;
+    }
+
+    // ISO 7816-4 sarmalı tek bir DESFire çerçevesi: 90 cmd 00 00 [Lc veri] 00 -> veri + 91 durum
+    template <typename TransmitFn>
+    bool DesfireTransceive(TransmitFn& transmit, SCardByte command, const SCardByte* data, size_t length,
+                           std::vector<SCardByte>& response, SCardByte& status, SCardLong& rv, std::string& error) {
+        std::vector<SCardByte> apdu = { 0x90, command, 0x00, 0x00 };
+        if (length > 0) {
+            apdu.push_back(static_cast<SCardByte>(length));
+            apdu.insert(apdu.end(), data, data + length);
+        }
+        apdu.push_back(0x00);
+        rv = transmit(apdu.data(), apdu.size(), response);
+        if (rv != SCARD_S_SUCCESS) {
+            error = "DESFire command transmit failed";
+            return false;
+        }
+        if (response.size() < 2 || response[response.size() - 2] != 0x91) {
+            char text[80];
+            snprintf(text, sizeof(text), "DESFire command 0x%02X returned unexpected status word %04X", command, StatusWord(response));
+            error = text;
+            return false;
+        }
+        status = response.back();
+        response.resize(response.size() - 2);
+        return true;
+    }
+
+    // Komutu gönderir ve kart ek çerçeve (AF) döndükçe yanıtın kalanını toplar
+    template <typename TransmitFn>
+    bool DesfireExchange(TransmitFn& transmit, SCardByte command, const std::vector<SCardByte>& frame,
+                         std::vector<SCardByte>& response, SCardByte& status, SCardLong& rv, std::string& error) {
+        response.clear();
+        std::vector<SCardByte> part;
+        if (!DesfireTransceive(transmit, command, frame.data(), frame.size(), part, status, rv, error)) return false;
+        response.insert(response.end(), part.begin(), part.end());
+        for (size_t frames = 0; status == 0xAF; frames++) {
+            if (frames == kDesfireMaxFrames) {
+                error = "DESFire response exceeds the additional frame limit";
+                return false;
+            }
+            if (!DesfireTransceive(transmit, 0xAF, nullptr, 0, part, status, rv, error)) return false;
+            response.insert(response.end(), part.begin(), part.end());
+        }
+        return true;
+    }
+
+    inline void RotateLeft(const SCardByte* in, SCardByte* out) {
+        for (size_t i = 0; i < kAesBlockSize; i++) out[i] = in[(i + 1) % kAesBlockSize];
+    }
+
+    // Kesilmiş MAC: CMAC(KSesAuthMAC, girdi) baytlarından 1, 3, ..., 15. indeksler
+    void DesfireMac(const DesfireSecureChannel& channel, const std::vector<SCardByte>& input, SCardByte* mac) {
+        SCardByte full[kAesBlockSize];
+        channel.macKey.Cmac(input.data(), input.size(), full);
+        for (size_t i = 0; i < kDesfireMacLength; i++) mac[i] = full[2 * i + 1];
+    }
+
+    // Komut (A5 5A) / yanıt (5A A5) şifreleme IV'si: E(KSesAuthENC, etiket || TI || CmdCtr || 0^8)
+    void DesfireIv(const DesfireSecureChannel& channel, SCardByte first, SCardByte second, uint16_t counter, SCardByte* iv) {
+        SCardByte block[kAesBlockSize] = { first, second, channel.ti[0], channel.ti[1], channel.ti[2], channel.ti[3],
+                                           static_cast<SCardByte>(counter & 0xFF), static_cast<SCardByte>(counter >> 8) };
+        channel.encKey.EncryptBlock(block, iv);
+    }
+
+    // AuthenticateEV2First (0x71): karşılıklı kimlik doğrulama ve oturum anahtarlarının türetilmesi (NXP AN12343)
+    template <typename TransmitFn>
+    bool DesfireAuthenticateEv2First(TransmitFn& transmit, SCardByte keyNo, const SCardByte* key,
+                                     DesfireSecureChannel& channel, SCardLong& rv, std::string& error) {
+        Aes128 cipher(key);
+        std::vector<SCardByte> response;
+        SCardByte status = 0;
+        SCardByte start[2] = { keyNo, 0x00 }; // LenCap = 0
+        if (!DesfireTransceive(transmit, 0x71, start, sizeof(start), response, status, rv, error)) return false;
+        if (status != 0xAF || response.size() != kAesBlockSize) {
+            error = status != 0xAF ? DesfireStatusError(0x71, status) : "Unexpected AuthenticateEV2First response length";
+            return false;
+        }
+
+        SCardByte iv[kAesBlockSize] = {0};
+        SCardByte rndB[kAesBlockSize];
+        memcpy(rndB, response.data(), kAesBlockSize);
+        cipher.CbcDecrypt(rndB, kAesBlockSize, iv);
+
+        SCardByte rndA[kAesBlockSize];
+        std::random_device random;
+        for (size_t i = 0; i < kAesBlockSize; i += 4) {
+            uint32_t value = random();
+            memcpy(rndA + i, &value, 4);
+        }
+        SCardByte token[2 * kAesBlockSize];
+        memcpy(token, rndA, kAesBlockSize);
+        RotateLeft(rndB, token + kAesBlockSize);
+        memset(iv, 0, sizeof(iv));
+        cipher.CbcEncrypt(token, sizeof(token), iv);
+
+        if (!DesfireTransceive(transmit, 0xAF, token, sizeof(token), response, status, rv, error)) return false;
+        if (status != 0x00 || response.size() != 2 * kAesBlockSize) {
+            error = status != 0x00 ? DesfireStatusError(0x71, status) : "Unexpected AuthenticateEV2First response length";
+            return false;
+        }
+        // TI (4) || RndA' (16) || PDcap2 (6) || PCDcap2 (6)
+        memset(iv, 0, sizeof(iv));
+        cipher.CbcDecrypt(response.data(), response.size(), iv);
+        SCardByte expected[kAesBlockSize];
+        RotateLeft(rndA, expected);
+        if (memcmp(response.data() + 4, expected, kAesBlockSize) != 0) {
+            error = "DESFire authentication failed: card returned a wrong RndA' (wrong key?)";
+            return false;
+        }
+
+        // SV1/SV2 = etiket || 00 01 00 80 || RndA[15..14] || (RndA[13..8] ^ RndB[15..10]) || RndB[9..0] || RndA[7..0]
+        SCardByte sv[32] = { 0xA5, 0x5A, 0x00, 0x01, 0x00, 0x80 };
+        memcpy(sv + 6, rndA, 2);
+        for (size_t i = 0; i < 6; i++) sv[8 + i] = rndA[2 + i] ^ rndB[i];
+        memcpy(sv + 14, rndB + 6, 10);
+        memcpy(sv + 24, rndA + 8, 8);
+        SCardByte sessionKey[kAesBlockSize];
+        cipher.Cmac(sv, sizeof(sv), sessionKey);
+        channel.encKey.SetKey(sessionKey);
+        sv[0] = 0x5A;
+        sv[1] = 0xA5;
+        cipher.Cmac(sv, sizeof(sv), sessionKey);
+        channel.macKey.SetKey(sessionKey);
+        memcpy(channel.ti, response.data(), sizeof(channel.ti));
+        channel.commandCounter = 0;
+
+        SecureWipe(sessionKey, sizeof(sessionKey));
+        SecureWipe(rndA, sizeof(rndA));
+        SecureWipe(rndB, sizeof(rndB));
+        SecureWipe(sv, sizeof(sv));
+        SecureWipe(response.data(), response.size());
+        return true;
+    }
+
+    // Tek bir DESFire komutu. channel varsa EV2 güvenli mesajlaşma uygulanır: komut verisi commandMode'a göre
+    // şifrelenir / MAC'lenir, yanıt responseMode'a göre doğrulanıp çözülür ve CmdCtr ilerletilir. out düz yanıt
+    // verisidir. Başarısızlıkta EV2 oturumu kart tarafında da sonlanmış sayılır; çağıran kanalı bırakmalıdır.
+    template <typename TransmitFn>
+    bool DesfireCommand(TransmitFn& transmit, DesfireSecureChannel* channel, SCardByte command,
+                        const std::vector<SCardByte>& header, const std::vector<SCardByte>& data,
+                        DesfireCommMode commandMode, DesfireCommMode responseMode,
+                        std::vector<SCardByte>& out, SCardLong& rv, std::string& error) {
+        std::vector<SCardByte> frame(header);
+        if (!channel || commandMode != kCommFull || data.empty()) {
+            frame.insert(frame.end(), data.begin(), data.end());
+        } else {
+            // ISO/IEC 9797-1 yöntem 2 dolgusu (80 00 ...); veri blok katı olsa da eklenir
+            std::vector<SCardByte> encrypted(data);
+            encrypted.push_back(0x80);
+            encrypted.resize((encrypted.size() + kAesBlockSize - 1) / kAesBlockSize * kAesBlockSize, 0x00);
+            SCardByte iv[kAesBlockSize];
+            DesfireIv(*channel, 0xA5, 0x5A, channel->commandCounter, iv);
+            channel->encKey.CbcEncrypt(encrypted.data(), encrypted.size(), iv);
+            frame.insert(frame.end(), encrypted.begin(), encrypted.end());
+            SecureWipe(encrypted.data(), encrypted.size());
+        }
+        if (channel && commandMode != kCommPlain) {
+            // MAC girdisi: Cmd || CmdCtr || TI || CmdHeader || CmdData (şifreli)
+            std::vector<SCardByte> macInput = { command, static_cast<SCardByte>(channel->commandCounter & 0xFF),
+                                                static_cast<SCardByte>(channel->commandCounter >> 8) };
+            macInput.insert(macInput.end(), channel->ti, channel->ti + sizeof(channel->ti));
+            macInput.insert(macInput.end(), frame.begin(), frame.end());
+            SCardByte mac[kDesfireMacLength];
+            DesfireMac(*channel, macInput, mac);
+            frame.insert(frame.end(), mac, mac + kDesfireMacLength);
+        }
+        if (frame.size() > kDesfireMaxFrameData) {
+            error = "DESFire command data does not fit in a single frame";
+            return false;
+        }
+
+        SCardByte status = 0;
+        if (!DesfireExchange(transmit, command, frame, out, status, rv, error)) return false;
+        if (status != 0x00) {
+            error = DesfireStatusError(command, status);
+            return false;
+        }
+        if (!channel) return true;
+
+        channel->commandCounter++;
+        if (responseMode == kCommPlain) return true;
+        if (out.size() < kDesfireMacLength) {
+            error = "DESFire response is missing its MAC";
+            return false;
+        }
+        size_t dataLength = out.size() - kDesfireMacLength;
+        // MAC girdisi: RC || CmdCtr || TI || RespData (şifreli)
+        std::vector<SCardByte> macInput = { status, static_cast<SCardByte>(channel->commandCounter & 0xFF),
+                                            static_cast<SCardByte>(channel->commandCounter >> 8) };
+        macInput.insert(macInput.end(), channel->ti, channel->ti + sizeof(channel->ti));
+        macInput.insert(macInput.end(), out.begin(), out.begin() + dataLength);
+        SCardByte mac[kDesfireMacLength];
+        DesfireMac(*channel, macInput, mac);
+        if (memcmp(mac, out.data() + dataLength, kDesfireMacLength) != 0) {
+            error = "DESFire response MAC verification failed";
+            return false;
+        }
+        out.resize(dataLength);
+
+        if (responseMode == kCommFull && !out.empty()) {
+            if (out.size() % kAesBlockSize != 0) {
+                error = "DESFire encrypted response has an invalid length";
+                return false;
+            }
+            SCardByte iv[kAesBlockSize];
+            DesfireIv(*channel, 0x5A, 0xA5, channel->commandCounter, iv);
+            channel->encKey.CbcDecrypt(out.data(), out.size(), iv);
+            size_t end = out.size();
+            while (end > 0 && out[end - 1] == 0x00) end--;
+            if (end == 0 || out[end - 1] != 0x80) {
+                error = "DESFire decrypted response has invalid padding";
+                return false;
+            }
+            out.resize(end - 1);
+        }
+        return true;
+    }
+
+    // desfire() isteği: sırasıyla uygulama seçimi, kimlik doğrulama ve bir komut (her biri isteğe bağlı)
+    struct DesfireRequest {
+        bool selectApplication = false;
+        SCardByte aid[3] = {0};
+        bool authenticate = false;
+        SCardByte keyNo = 0;
+        SCardByte key[kAesBlockSize] = {0};
+        bool hasCommand = false;
+        SCardByte command = 0;
+        std::vector<SCardByte> header;
+        std::vector<SCardByte> data;
+        DesfireCommMode commandMode = kCommPlain;
+        DesfireCommMode responseMode = kCommPlain;
+
+        DesfireRequest() {}
+        DesfireRequest(const DesfireRequest&) = default;
+        ~DesfireRequest() {
+            SecureWipe(key, sizeof(key));
+            if (!data.empty()) SecureWipe(data.data(), data.size());
+        }
+    };
+
+    class DesfireWorker : public PcscPromiseWorker {
+    public:
+        DesfireWorker(Napi::Env env, Napi::Promise::Deferred deferred,
+                      const std::string& readerName, std::shared_ptr<CardSession> session, const DesfireRequest& request)
+            : PcscPromiseWorker(env, deferred, session ? session->readerName : readerName),
+              readerName(session ? session->readerName : readerName),
+              session(std::move(session)),
+              request(request) {}
+
+    protected:
+        void Execute() override {
+            if (session) {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                if (session->closed) {
+                    SetError("Session is closed.");
+                    return;
+                }
+                // Kanal oturumda kalır; çalışma sırasında kart resetlenip yeniden bağlanıldıysa geçersizdir
+                uint32_t reconnects = session->reconnects;
+                std::shared_ptr<DesfireSecureChannel> channel = session->secureChannel;
+                auto transmit = [this](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                    return SessionTransmitApdu(*session, apdu, apduLength, response);
+                };
+                RunRequest(transmit, channel);
+                session->secureChannel = session->reconnects == reconnects ? channel : nullptr;
+                return;
+            }
+
+            if (!EnsureContext(ThreadContext())) {
+                lastRv = SCARD_E_INVALID_HANDLE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+            SCARDHANDLE hCard = 0;
+            SCardDword dwActiveProtocol = 0;
+            ReaderStats* stats = FindStats(readerName);
+            lastRv = ConnectCard(ThreadContext(), readerName, stats, &hCard, &dwActiveProtocol);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to card in reader: " + readerName);
+                return;
+            }
+            auto transmit = [hCard, dwActiveProtocol, stats](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& response) {
+                return TransmitApdu(hCard, dwActiveProtocol, apdu, apduLength, response, stats);
+            };
+            std::shared_ptr<DesfireSecureChannel> channel;
+            RunRequest(transmit, channel);
+            Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            if (request.hasCommand) {
+                deferred.Resolve(TakeBuffer(env, std::move(result)));
+            } else {
+                deferred.Resolve(env.Undefined());
+            }
+        }
+
+    private:
+        template <typename TransmitFn>
+        void RunRequest(TransmitFn& transmit, std::shared_ptr<DesfireSecureChannel>& channel) {
+            std::string error;
+            SCardLong rv = SCARD_S_SUCCESS;
+            if (request.selectApplication) {
+                // SelectApplication kart tarafındaki kimlik doğrulamasını sonlandırır
+                channel.reset();
+                std::vector<SCardByte> aid(request.aid, request.aid + sizeof(request.aid));
+                if (!DesfireCommand(transmit, nullptr, 0x5A, aid, {}, kCommPlain, kCommPlain, result, rv, error)) {
+                    Fail(rv, error);
+                    return;
+                }
+            }
+            if (request.authenticate) {
+                channel.reset();
+                auto fresh = std::make_shared<DesfireSecureChannel>();
+                if (!DesfireAuthenticateEv2First(transmit, request.keyNo, request.key, *fresh, rv, error)) {
+                    Fail(rv, error);
+                    return;
+                }
+                channel = fresh;
+            }
+            if (request.hasCommand) {
+                if (!channel && (request.commandMode != kCommPlain || request.responseMode != kCommPlain)) {
+                    SetError("Not authenticated: 'mac' and 'full' communication modes need a key.");
+                    return;
+                }
+                if (!DesfireCommand(transmit, channel.get(), request.command, request.header, request.data,
+                                    request.commandMode, request.responseMode, result, rv, error)) {
+                    channel.reset();
+                    Fail(rv, error);
+                    return;
+                }
+            }
+        }
+
+        void Fail(SCardLong rv, const std::string& error) {
+            lastRv = rv;
+            result.clear();
+            SetError(error);
+        }
+
+        std::string readerName;
+        std::shared_ptr<CardSession> session;
+        DesfireRequest request;
+        std::vector<SCardByte> result;
+    };
+
+
+    // === Okuyucu Kontrol Kodları ve Özellik Tablosu (SCardControl / SCardGetAttrib) ===
+
+    // PC/SC Part 10 özellik etiketleri; dizi indeksi CM_IOCTL_GET_FEATURE_REQUEST yanıtındaki tag'dir
+    const char* const kReaderFeatureNames[] = {
+        nullptr, "VERIFY_PIN_START", "VERIFY_PIN_FINISH", "MODIFY_PIN_START", "MODIFY_PIN_FINISH",
+        "GET_KEY_PRESSED", "VERIFY_PIN_DIRECT", "MODIFY_PIN_DIRECT", "MCT_READER_DIRECT", "MCT_UNIVERSAL",
+        "IFD_PIN_PROPERTIES", "ABORT", "SET_SPE_MESSAGE", "VERIFY_PIN_DIRECT_APP_ID", "MODIFY_PIN_DIRECT_APP_ID",
+        "WRITE_DISPLAY", "GET_KEY", "IFD_DISPLAY_PROPERTIES", "GET_TLV_PROPERTIES", "CCID_ESC_COMMAND",
+    };
+    const size_t kReaderFeatureCount = sizeof(kReaderFeatureNames) / sizeof(kReaderFeatureNames[0]);
+
+    const size_t kMaxControlResponse = 65538; // Genişletilmiş APDU yanıtı kadar (escape komutları APDU taşıyabilir)
+    const size_t kMaxAttribLength = 1024;     // Standart özniteliklerin hepsinden büyük
+
+    // Okuyucunun desteklediği Part 10 özellikleri: etiket -> kontrol kodu
+    struct ReaderFeatures {
+        std::map<SCardByte, SCardDword> controlCodes;
+    };
+
+    // Okuyucu adı -> özellik tablosu. Okuyucu takıldığında (dinleyici) veya ilk kullanımda bir kez
+    // sorgulanır, çıkarıldığında silinir; sonraki aramalar servise gitmez.
+    std::mutex g_featureCacheMutex;
+    std::map<std::string, std::shared_ptr<const ReaderFeatures>> g_featureCache;
+
+    std::shared_ptr<const ReaderFeatures> CachedReaderFeatures(const std::string& readerName) {
+        std::lock_guard<std::mutex> lock(g_featureCacheMutex);
+        auto it = g_featureCache.find(readerName);
+        return it != g_featureCache.end() ? it->second : nullptr;
+    }
+
+    void ForgetReaderFeatures(const std::string& readerName) {
+        std::lock_guard<std::mutex> lock(g_featureCacheMutex);
+        g_featureCache.erase(readerName);
+    }
+
+    // Sürücünün kontrol kodunu tanımadığını bildiren hatalar (Windows sürücüleri Win32 kodu döner)
+    bool IsUnsupportedControl(SCardLong rv) {
+        #ifdef _WIN32
+            if (rv == ERROR_INVALID_FUNCTION || rv == ERROR_NOT_SUPPORTED) return true;
+        #endif
+        return rv == SCARD_E_UNSUPPORTED_FEATURE;
+    }
+
+    // Part 10 TLV listesi: tag (1) | uzunluk (1, = 4) | kontrol kodu (4, big-endian)
+    void ParseFeatureTlv(const SCardByte* data, size_t length, ReaderFeatures& features) {
+        size_t offset = 0;
+        while (offset + 2 <= length) {
+            SCardByte tag = data[offset];
+            size_t valueLength = data[offset + 1];
+            if (offset + 2 + valueLength > length) break;
+            if (valueLength == 4) {
+                const SCardByte* value = data + offset + 2;
+                features.controlCodes[tag] = (static_cast<SCardDword>(value[0]) << 24) | (static_cast<SCardDword>(value[1]) << 16)
+                                           | (static_cast<SCardDword>(value[2]) << 8) | value[3];
+            }
+            offset += 2 + valueLength;
+        }
+    }
+
+    // Kontrol kodunu gönderir (ölçülür); çıktı thread başına tampona alınıp gerçek boyunda kopyalanır
+    SCardLong ControlReader(SCARDHANDLE hCard, SCardDword controlCode, const std::vector<SCardByte>& input,
+                            std::vector<SCardByte>& output, ReaderStats* stats) {
+        thread_local std::vector<SCardByte> outputBuffer(kMaxControlResponse);
+        SCardDword outputLength = 0;
+        auto start = std::chrono::steady_clock::now();
+        SCardLong rv = Backend().Control(hCard, controlCode, input.empty() ? nullptr : input.data(), (SCardDword)input.size(),
+                                         outputBuffer.data(), (SCardDword)outputBuffer.size(), &outputLength);
+        RecordOp(stats, kOpControl, start, rv);
+        if (rv == SCARD_S_SUCCESS) {
+            output.assign(outputBuffer.begin(), outputBuffer.begin() + std::min<size_t>(outputLength, outputBuffer.size()));
+        } else {
+            output.clear();
+        }
+        return rv;
+    }
+
+    // Okuyucunun özellik tablosunu önbellekten döner; yoksa açık doğrudan bağlantı üzerinden sorgulayıp saklar.
+    // Part 10 desteklemeyen okuyucu için boş tablo saklanır; bağlantı/servis hataları saklanmaz.
+    SCardLong ReaderFeaturesFor(const std::string& readerName, SCARDHANDLE hCard, ReaderStats* stats,
+                                std::shared_ptr<const ReaderFeatures>& out) {
+        out = CachedReaderFeatures(readerName);
+        if (out) return SCARD_S_SUCCESS;
+
+        std::vector<SCardByte> tlv;
+        SCardLong rv = ControlReader(hCard, CM_IOCTL_GET_FEATURE_REQUEST, std::vector<SCardByte>(), tlv, stats);
+        if (rv != SCARD_S_SUCCESS && !IsUnsupportedControl(rv)) return rv;
+
+        auto features = std::make_shared<ReaderFeatures>();
+        ParseFeatureTlv(tlv.data(), tlv.size(), *features);
+        std::lock_guard<std::mutex> lock(g_featureCacheMutex);
+        out = g_featureCache.emplace(readerName, std::move(features)).first->second;
+        return SCARD_S_SUCCESS;
+    }
+
+    // Doğrudan bağlantıyı kapsam sonunda kapatır
+    struct DirectConnection {
+        SCARDHANDLE hCard = 0;
+        ~DirectConnection() {
+            if (hCard != 0) Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+        }
+    };
+
+    // Yeni takılan okuyucunun özellik tablosunu doldurur (dinleyici thread'i)
+    void PrefetchReaderFeatures(ContextSlot& slot, const std::string& readerName) {
+        if (CachedReaderFeatures(readerName)) return;
+        ReaderStats* stats = FindStats(readerName);
+        DirectConnection connection;
+        std::shared_ptr<const ReaderFeatures> features;
+        SCardLong rv = ConnectDirect(slot, readerName, stats, &connection.hCard);
+        if (rv == SCARD_S_SUCCESS) rv = ReaderFeaturesFor(readerName, connection.hCard, stats, features);
+        if (rv != SCARD_S_SUCCESS) {
+            PCSC_LOG(kLogWarn) << "Could not query features of reader " << readerName << ": " << SCardErrorToString(rv);
+        }
+    }
+
+    // Bir özellik etiketinin adı; bilinmeyen etiketler "0x.." olarak adlandırılır
+    std::string ReaderFeatureName(SCardByte tag) {
+        if (tag < kReaderFeatureCount && kReaderFeatureNames[tag]) return kReaderFeatureNames[tag];
+        char name[5];
+        snprintf(name, sizeof(name), "0x%02X", tag);
+        return name;
+    }
+
+    // SCardControl: kontrol kodu doğrudan veya Part 10 özellik etiketiyle (önbellekten çözülerek) verilir
+    class ControlWorker : public PcscPromiseWorker {
+    public:
+        ControlWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& readerName,
+                      SCardDword controlCode, int featureTag, std::vector<SCardByte> input)
+            : PcscPromiseWorker(env, deferred, readerName),
+              readerName(readerName),
+              controlCode(controlCode),
+              featureTag(featureTag),
+              input(std::move(input)) {}
+
+    protected:
+        void Execute() override {
+            ContextSlot& slot = ThreadContext();
+            if (!EnsureContext(slot)) {
+                lastRv = SCARD_E_NO_SERVICE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            ReaderStats* stats = FindStats(readerName);
+            DirectConnection connection;
+            lastRv = ConnectDirect(slot, readerName, stats, &connection.hCard);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to reader: " + readerName);
+                return;
+            }
+
+            if (featureTag >= 0) {
+                std::shared_ptr<const ReaderFeatures> features;
+                lastRv = ReaderFeaturesFor(readerName, connection.hCard, stats, features);
+                if (lastRv != SCARD_S_SUCCESS) {
+                    SetError("Failed to query reader features");
+                    return;
+                }
+                auto it = features->controlCodes.find(static_cast<SCardByte>(featureTag));
+                if (it == features->controlCodes.end()) {
+                    SetError("Reader does not support feature " + ReaderFeatureName(static_cast<SCardByte>(featureTag)));
+                    return;
+                }
+                controlCode = it->second;
+            }
+
+            lastRv = ControlReader(connection.hCard, controlCode, input, output, stats);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Control command failed");
+            }
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            deferred.Resolve(TakeBuffer(env, std::move(output)));
+        }
+
+    private:
+        std::string readerName;
+        SCardDword controlCode;
+        int featureTag; // -1: controlCode doğrudan kullanılır
+        std::vector<SCardByte> input;
+        std::vector<SCardByte> output;
+    };
+
+    // SCardGetAttrib: okuyucu özniteliğini (üretici adı, seri no, ...) ham bayt olarak okur
+    class GetAttribWorker : public PcscPromiseWorker {
+    public:
+        GetAttribWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& readerName, SCardDword attrId)
+            : PcscPromiseWorker(env, deferred, readerName),
+              readerName(readerName),
+              attrId(attrId) {}
+
+    protected:
+        void Execute() override {
+            ContextSlot& slot = ThreadContext();
+            if (!EnsureContext(slot)) {
+                lastRv = SCARD_E_NO_SERVICE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+
+            ReaderStats* stats = FindStats(readerName);
+            DirectConnection connection;
+            lastRv = ConnectDirect(slot, readerName, stats, &connection.hCard);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to reader: " + readerName);
+                return;
+            }
+
+            value.resize(kMaxAttribLength);
+            SCardDword length = static_cast<SCardDword>(value.size());
+            auto start = std::chrono::steady_clock::now();
+            lastRv = Backend().GetAttrib(connection.hCard, attrId, value.data(), &length);
+            RecordOp(stats, kOpControl, start, lastRv);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to read reader attribute");
+                return;
+            }
+            value.resize(std::min<size_t>(length, value.size()));
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            deferred.Resolve(TakeBuffer(env, std::move(value)));
+        }
+
+    private:
+        std::string readerName;
+        SCardDword attrId;
+        std::vector<SCardByte> value;
+    };
+
+    // Okuyucunun özellik tablosunu döner (önbellekte varsa okuyucuya gidilmez)
+    class ReaderFeaturesWorker : public PcscPromiseWorker {
+    public:
+        ReaderFeaturesWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& readerName)
+            : PcscPromiseWorker(env, deferred, readerName),
+              readerName(readerName) {}
+
+    protected:
+        void Execute() override {
+            features = CachedReaderFeatures(readerName);
+            if (features) return;
+
+            ContextSlot& slot = ThreadContext();
+            if (!EnsureContext(slot)) {
+                lastRv = SCARD_E_NO_SERVICE;
+                SetError("PC/SC context not established or invalid.");
+                return;
+            }
+            ReaderStats* stats = FindStats(readerName);
+            DirectConnection connection;
+            lastRv = ConnectDirect(slot, readerName, stats, &connection.hCard);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to connect to reader: " + readerName);
+                return;
+            }
+            lastRv = ReaderFeaturesFor(readerName, connection.hCard, stats, features);
+            if (lastRv != SCARD_S_SUCCESS) {
+                SetError("Failed to query reader features");
+            }
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            Napi::Object result = Napi::Object::New(env);
+            for (const auto& entry : features->controlCodes) {
+                result.Set(ReaderFeatureName(entry.first), Napi::Number::New(env, entry.second));
+            }
+            deferred.Resolve(result);
+        }
+
+    private:
+        std::string readerName;
+        std::shared_ptr<const ReaderFeatures> features;
+    };
+
+
+    // === UID Erişim İndeksi (Bellek Eşlemeli İzin / Ret Listesi) ===
+    // İzin/ret listesi diskte açık adresli bir hash tablosu olarak durur ve salt okunur eşlenir. Dinleyici
+    // thread'i her dokunuşta UID'yi olay JS'e gitmeden arar ve olayı kararla etiketler; liste V8 yığınında
+    // tutulmaz. Yeni dosya havuz thread'inde eşlenip ısıtılır, ardından işaretçi atomik olarak değiştirilir;
+    // dinleyici hiç beklemez, eski eşleme son okuyucu bıraktığında kaldırılır.
+    //
+    // Dosya düzeni (little-endian):
+    //   başlık (32 bayt): "PCSCUID1" | sürüm (u32) | slot sayısı (u32, 2'nin kuvveti) | kayıt sayısı (u32)
+    //                     | varsayılan karar (u8) | 11 bayt ayrılmış
+    //   slotlar (12 bayt): UID uzunluğu (u8, 0 = boş) | karar (u8) | UID (10 bayt, sıfır dolgulu)
+    // Arama FNV-1a(UID) & (slot sayısı - 1) konumundan doğrusal yoklamayla yapılır ve boş slotta durur.
+
+    enum UidVerdict : uint8_t { kVerdictNone = 0, kVerdictAllow = 1, kVerdictDeny = 2 };
+    const char* const kVerdictNames[] = { nullptr, "allow", "deny" };
+
+    const char kUidIndexMagic[8] = { 'P', 'C', 'S', 'C', 'U', 'I', 'D', '1' };
+    const uint32_t kUidIndexVersion = 1;
+    const size_t kUidIndexHeaderSize = 32;
+    const size_t kUidIndexSlotSize = 12;
+    const size_t kUidIndexMaxUid = 10; // ISO 14443-3 üçlü boy UID
+
+    inline uint32_t ReadLe32(const SCardByte* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+             | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline void WriteLe32(SCardByte* p, uint32_t value) {
+        p[0] = static_cast<SCardByte>(value);
+        p[1] = static_cast<SCardByte>(value >> 8);
+        p[2] = static_cast<SCardByte>(value >> 16);
+        p[3] = static_cast<SCardByte>(value >> 24);
+    }
+
+    inline uint64_t HashUid(const SCardByte* uid, size_t length) {
+        uint64_t hash = 14695981039346656037ULL; // FNV-1a 64
+        for (size_t i = 0; i < length; i++) {
+            hash ^= uid[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Salt okunur dosya eşlemesi (POSIX mmap / Windows MapViewOfFile)
+    class MappedFile {
+    public:
+        MappedFile() {}
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() { Unmap(); }
+
+        bool Map(const std::string& path, std::string& error) {
+            #ifdef _WIN32
+                // FILE_SHARE_DELETE: eşlenmiş dosya yeni sürümle değiştirilebilsin; FILE_SHARE_WRITE: açık günlük segmenti okunabilsin
+                file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                   NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+                if (file == INVALID_HANDLE_VALUE) {
+                    error = "Cannot open " + path + " (error " + std::to_string(GetLastError()) + ")";
+                    return false;
+                }
+                LARGE_INTEGER fileSize;
+                if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                    error = "Cannot map empty file " + path;
+                    return false;
+                }
+                mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (mapping == NULL) {
+                    error = "Cannot map " + path + " (error " + std::to_string(GetLastError()) + ")";
+                    return false;
+                }
+                data = static_cast<const SCardByte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                if (!data) {
+                    error = "Cannot map " + path + " (error " + std::to_string(GetLastError()) + ")";
+                    return false;
+                }
+                size = static_cast<size_t>(fileSize.QuadPart);
+            #else
+                int fd = open(path.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    error = "Cannot open " + path + " (" + strerror(errno) + ")";
+                    return false;
+                }
+                struct stat info;
+                if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                    close(fd);
+                    error = "Cannot map empty file " + path;
+                    return false;
+                }
+                // Eşleme dosya kapatılınca da geçerli kalır; dosya rename ile değiştirilse de eski içerik görünür
+                void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                close(fd);
+                if (address == MAP_FAILED) {
+                    error = "Cannot map " + path + " (" + strerror(errno) + ")";
+                    return false;
+                }
+                data = static_cast<const SCardByte*>(address);
+                size = static_cast<size_t>(info.st_size);
+            #endif
+            return true;
+        }
+
+        const SCardByte* Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        void Unmap() {
+            #ifdef _WIN32
+                if (data) UnmapViewOfFile(data);
+                if (mapping != NULL) CloseHandle(mapping);
+                if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+                mapping = NULL;
+                file = INVALID_HANDLE_VALUE;
+            #else
+                if (data) munmap(const_cast<SCardByte*>(data), size);
+            #endif
+            data = nullptr;
+            size = 0;
+        }
+
+        const SCardByte* data = nullptr;
+        size_t size = 0;
+        #ifdef _WIN32
+            HANDLE file = INVALID_HANDLE_VALUE;
+            HANDLE mapping = NULL;
+        #endif
+    };
+
+    class UidIndex {
+    public:
+        // Dosyayı eşler ve başlığı doğrular
+        bool Open(const std::string& indexPath, std::string& error) {
+            if (!file.Map(indexPath, error)) return false;
+            const SCardByte* header = file.Data();
+            if (file.Size() < kUidIndexHeaderSize || memcmp(header, kUidIndexMagic, sizeof(kUidIndexMagic)) != 0) {
+                error = indexPath + " is not a UID index file";
+                return false;
+            }
+            if (ReadLe32(header + 8) != kUidIndexVersion) {
+                error = "Unsupported UID index version " + std::to_string(ReadLe32(header + 8));
+                return false;
+            }
+            slotCount = ReadLe32(header + 12);
+            entryCount = ReadLe32(header + 16);
+            defaultVerdict = static_cast<UidVerdict>(header[20]);
+            if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0
+                    || file.Size() < kUidIndexHeaderSize + static_cast<size_t>(slotCount) * kUidIndexSlotSize
+                    || (defaultVerdict != kVerdictAllow && defaultVerdict != kVerdictDeny)) {
+                error = indexPath + " is truncated or corrupt";
+                return false;
+            }
+            slots = header + kUidIndexHeaderSize;
+            path = indexPath;
+            return true;
+        }
+
+        // Her sayfayı bir kez okur (yükleyen thread'de); dinleyicinin ilk aramaları disk beklemez
+        void Prefault() const {
+            volatile SCardByte sink = 0;
+            for (size_t offset = 0; offset < file.Size(); offset += 4096) sink = sink + file.Data()[offset];
+        }
+
+        UidVerdict Lookup(const SCardByte* uid, size_t length) const {
+            if (length == 0 || length > kUidIndexMaxUid) return defaultVerdict;
+            uint32_t mask = slotCount - 1;
+            uint32_t position = static_cast<uint32_t>(HashUid(uid, length)) & mask;
+            for (uint32_t probes = 0; probes < slotCount; probes++, position = (position + 1) & mask) {
+                const SCardByte* slot = slots + static_cast<size_t>(position) * kUidIndexSlotSize;
+                if (slot[0] == 0) break;
+                if (slot[0] == length && memcmp(slot + 2, uid, length) == 0) {
+                    return slot[1] == kVerdictAllow || slot[1] == kVerdictDeny ? static_cast<UidVerdict>(slot[1]) : defaultVerdict;
+                }
+            }
+            return defaultVerdict;
+        }
+
+        std::string path;
+        uint32_t slotCount = 0;
+        uint32_t entryCount = 0;
+        UidVerdict defaultVerdict = kVerdictDeny;
+
+    private:
+        MappedFile file;
+        const SCardByte* slots = nullptr;
+    };
+
+    // Etkin indeks; std::atomic_load / std::atomic_store ile okunur ve değiştirilir (süreç geneli)
+    std::shared_ptr<const UidIndex> g_uidIndex;
+    std::atomic<uint64_t> g_uidIndexAllowed{0};
+    std::atomic<uint64_t> g_uidIndexDenied{0};
+
+    // Dinleyici thread'i: yüklü indeks yoksa kVerdictNone
+    UidVerdict CheckUid(const SCardByte* uid, size_t length) {
+        std::shared_ptr<const UidIndex> index = std::atomic_load(&g_uidIndex);
+        if (!index) return kVerdictNone;
+        UidVerdict verdict = index->Lookup(uid, length);
+        (verdict == kVerdictAllow ? g_uidIndexAllowed : g_uidIndexDenied).fetch_add(1, std::memory_order_relaxed);
+        return verdict;
+    }
+
+    struct UidIndexEntry {
+        SCardByte uid[kUidIndexMaxUid];
+        uint8_t length;
+        UidVerdict verdict;
+    };
+
+    // İndeks dosyasını yazar. Önce geçici dosyaya yazılır, sonra yerine taşınır: eski dosyayı eşlemiş
+    // dinleyiciler yarım yazılmış bir tablo görmez. Aynı UID birden fazla verilirse son karar geçerlidir.
+    bool WriteUidIndex(const std::string& path, const std::vector<UidIndexEntry>& entries, UidVerdict defaultVerdict,
+                       uint32_t& entryCount, uint32_t& slotCount, std::string& error) {
+        slotCount = 16;
+        while (slotCount < entries.size() + entries.size() / 2) slotCount <<= 1; // Doluluk en fazla 2/3
+        std::vector<SCardByte> table(kUidIndexHeaderSize + static_cast<size_t>(slotCount) * kUidIndexSlotSize, 0);
+
+        entryCount = 0;
+        SCardByte* slots = table.data() + kUidIndexHeaderSize;
+        uint32_t mask = slotCount - 1;
+        for (const auto& entry : entries) {
+            uint32_t position = static_cast<uint32_t>(HashUid(entry.uid, entry.length)) & mask;
+            while (true) {
+                SCardByte* slot = slots + static_cast<size_t>(position) * kUidIndexSlotSize;
+                if (slot[0] == 0) {
+                    slot[0] = entry.length;
+                    memcpy(slot + 2, entry.uid, entry.length);
+                    slot[1] = entry.verdict;
+                    entryCount++;
+                    break;
+                }
+                if (slot[0] == entry.length && memcmp(slot + 2, entry.uid, entry.length) == 0) {
+                    slot[1] = entry.verdict;
+                    break;
+                }
+                position = (position + 1) & mask;
+            }
+        }
+
+        memcpy(table.data(), kUidIndexMagic, sizeof(kUidIndexMagic));
+        WriteLe32(table.data() + 8, kUidIndexVersion);
+        WriteLe32(table.data() + 12, slotCount);
+        WriteLe32(table.data() + 16, entryCount);
+        table[20] = defaultVerdict;
+
+        std::string temporaryPath = path + ".tmp";
+        FILE* out = fopen(temporaryPath.c_str(), "wb");
+        if (!out) {
+            error = "Cannot create " + temporaryPath + " (" + strerror(errno) + ")";
+            return false;
+        }
+        bool written = fwrite(table.data(), 1, table.size(), out) == table.size();
+        written = (fclose(out) == 0) && written;
+        if (!written) {
+            remove(temporaryPath.c_str());
+            error = "Failed to write " + temporaryPath;
+            return false;
+        }
+        #ifdef _WIN32
+            bool moved = MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+        #else
+            bool moved = rename(temporaryPath.c_str(), path.c_str()) == 0;
+        #endif
+        if (!moved) {
+            remove(temporaryPath.c_str());
+            error = "Cannot replace " + path;
+            return false;
+        }
+        return true;
+    }
+
+    Napi::Object UidIndexToObject(Napi::Env env, const UidIndex& index) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("path", Napi::String::New(env, index.path));
+        result.Set("entries", Napi::Number::New(env, index.entryCount));
+        result.Set("slots", Napi::Number::New(env, index.slotCount));
+        result.Set("defaultVerdict", Napi::String::New(env, kVerdictNames[index.defaultVerdict]));
+        return result;
+    }
+
+    // İndeksi havuz thread'inde eşler, doğrular ve ısıtır; sonra etkin indeksi tek atomik yazmayla değiştirir
+    class LoadUidIndexWorker : public PcscPromiseWorker {
+    public:
+        LoadUidIndexWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& path)
+            : PcscPromiseWorker(env, deferred, kControlQueueKey),
+              path(path) {}
+
+    protected:
+        void Execute() override {
+            auto loaded = std::make_shared<UidIndex>();
+            std::string error;
+            if (!loaded->Open(path, error)) {
+                SetError(error);
+                return;
+            }
+            loaded->Prefault();
+            index = loaded;
+            std::atomic_store(&g_uidIndex, index);
+            g_uidIndexAllowed.store(0);
+            g_uidIndexDenied.store(0);
+            PCSC_LOG(kLogInfo) << "UID index loaded: " << path << " (" << index->entryCount << " entries)";
+        }
+
+        void OnOK() override {
+            deferred.Resolve(UidIndexToObject(Env(), *index));
+        }
+
+    private:
+        std::string path;
+        std::shared_ptr<const UidIndex> index;
+    };
+
+    // İndeks dosyasını havuz thread'inde oluşturur (etkin indeksi değiştirmez)
+    class BuildUidIndexWorker : public PcscPromiseWorker {
+    public:
+        BuildUidIndexWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& path,
+                            std::vector<UidIndexEntry> entries, UidVerdict defaultVerdict)
+            : PcscPromiseWorker(env, deferred, kControlQueueKey),
+              path(path),
+              entries(std::move(entries)),
+              defaultVerdict(defaultVerdict) {}
+
+    protected:
+        void Execute() override {
+            std::string error;
+            if (!WriteUidIndex(path, entries, defaultVerdict, entryCount, slotCount, error)) {
+                SetError(error);
+            }
+            entries.clear();
+            entries.shrink_to_fit();
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("path", Napi::String::New(env, path));
+            result.Set("entries", Napi::Number::New(env, entryCount));
+            result.Set("slots", Napi::Number::New(env, slotCount));
+            result.Set("defaultVerdict", Napi::String::New(env, kVerdictNames[defaultVerdict]));
+            deferred.Resolve(result);
+        }
+
+    private:
+        std::string path;
+        std::vector<UidIndexEntry> entries;
+        UidVerdict defaultVerdict;
+        uint32_t entryCount = 0;
+        uint32_t slotCount = 0;
+    };
+
+
+    // === Dinleyici Olay Kuyruğu ===
+
+    const size_t kMaxEventReaderName = 128;
+    const size_t kMaxEventUid = 32;
+    const size_t kMaxEventText = 256;
+    const size_t kMaxEventData = 2048;   // Tap programı yanıtları: [uzunluk (2 bayt, LE)][veri]...
+    const size_t kDefaultEventQueueSize = 128;
+
+    enum class ListenerEventType : uint8_t {
+        Card,         // onUid(uid, readerName, responses)
+        Error,        // onError(message, readerName?)
+        ReaderChange  // onReaderChange(event, readerName)
+    };
+
+    // Sabit boyutlu olay kaydı; halka tamponun slotlarında yaşar
+    struct ListenerEvent {
+        ListenerEventType type = ListenerEventType::Card;
+        char readerName[kMaxEventReaderName];
+        char text[kMaxEventText];           // Hata mesajı veya "attached"/"detached"
+        SCardByte uid[kMaxEventUid];
+        uint8_t uidLength = 0;
+        uint16_t responseCount = 0;
+        ReaderStats* stats = nullptr;                         // Gecikme ölçümü için (okuyucu adı varsa)
+        std::chrono::steady_clock::time_point queuedAt;      // Kuyruğa yazılma anı
+        std::chrono::steady_clock::time_point detectedAt;    // Kart olayları: algılanma anı
+        std::shared_ptr<const AtrInfo> card;                 // Kart olayları: ATR sınıflandırması (önbellekten)
+        UidVerdict verdict = kVerdictNone;                   // Kart olayları: UID indeksinin kararı (indeks yoksa none)
+        uint32_t dataLength = 0;
+        SCardByte data[kMaxEventData];
+    };
+
+    // Dinleyici thread'inden JS thread'ine olay aktarımı. Olaylar halka tampona yazılır ve
+    // tek bir NonBlockingCall ile toplu olarak boşaltılır; JS thread'i meşgulken algılama beklemez.
+    struct ListenerEventQueue {
+        explicit ListenerEventQueue(size_t capacity) : ring(capacity) {}
+
+        SpscRing<ListenerEvent> ring;
+        Napi::ThreadSafeFunction dispatcher;
+        Napi::FunctionReference onUid;          // Callback referansları sadece JS thread'inde kullanılır
+        Napi::FunctionReference onError;
+        Napi::FunctionReference onReaderChange;
+        bool blockWhenFull = false;             // Taşma politikası: true = yer açılana kadar bekle, false = düşür
+        bool binaryUid = false;                 // true: UID hex string yerine Buffer olarak iletilir
+        std::atomic<bool> drainScheduled{false};
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    // Sabit boyutlu alana kısaltarak ve null ile sonlandırarak kopyalar
+    inline void CopyEventString(char* destination, size_t capacity, const std::string& source) {
+        size_t length = std::min(source.size(), capacity - 1);
+        memcpy(destination, source.data(), length);
+        destination[length] = '\0';
+    }
+
+    // Olay verisine bir tap programı yanıtı ekler; yer yoksa false
+    bool AppendEventResponse(ListenerEvent& event, const std::vector<SCardByte>& response) {
+        if (response.size() > 0xFFFF || event.dataLength + 2 + response.size() > kMaxEventData) return false;
+        event.data[event.dataLength++] = static_cast<SCardByte>(response.size() & 0xFF);
+        event.data[event.dataLength++] = static_cast<SCardByte>(response.size() >> 8);
+        if (!response.empty()) memcpy(event.data + event.dataLength, response.data(), response.size());
+        event.dataLength += static_cast<uint32_t>(response.size());
+        event.responseCount++;
+        return true;
+    }
+
+    // JS thread'inde tek bir olayı ilgili callback'e iletir
+    void DeliverListenerEvent(Napi::Env env, ListenerEventQueue& queue, const ListenerEvent& event) {
+        switch (event.type) {
+            case ListenerEventType::Card: {
+                // UID: binary modda native bellekli Buffer, aksi halde yığında formatlanan hex string
+                Napi::Value uid;
+                if (queue.binaryUid) {
+                    uid = TakeBuffer(env, std::vector<SCardByte>(event.uid, event.uid + event.uidLength));
+                } else {
+                    char hex[kMaxEventUid * 2];
+                    uid = Napi::String::New(env, hex, EncodeHex(event.uid, event.uidLength, hex));
+                }
+                Napi::Array responses = Napi::Array::New(env, event.responseCount);
+                uint32_t offset = 0;
+                for (uint32_t i = 0; i < event.responseCount; i++) {
+                    size_t length = event.data[offset] | (event.data[offset + 1] << 8);
+                    offset += 2;
+                    responses.Set(i, Napi::Buffer<SCardByte>::Copy(env, event.data + offset, length));
+                    offset += static_cast<uint32_t>(length);
+                }
+                Napi::Value card = event.card ? Napi::Value(AtrInfoToObject(env, *event.card)) : env.Null();
+                RecordOp(event.stats, kOpTapToCallback, event.detectedAt);
+                Napi::Value verdict = event.verdict == kVerdictNone ? env.Null()
+                                                                    : Napi::Value(Napi::String::New(env, kVerdictNames[event.verdict]));
+                queue.onUid.Call({uid, Napi::String::New(env, event.readerName), responses, card, verdict});
+                break;
+            }
+            case ListenerEventType::Error:
+                if (event.readerName[0] == '\0') {
+                    queue.onError.Call({Napi::String::New(env, event.text)});
+                } else {
+                    queue.onError.Call({Napi::String::New(env, event.text), Napi::String::New(env, event.readerName)});
+                }
+                break;
+            case ListenerEventType::ReaderChange:
+                if (!queue.onReaderChange.IsEmpty()) {
+                    queue.onReaderChange.Call({Napi::String::New(env, event.text), Napi::String::New(env, event.readerName)});
+                }
+                break;
+        }
+    }
+
+    // JS thread'inde çalışır: o ana kadar biriken tüm olayları tek seferde boşaltır
+    void DrainListenerEvents(Napi::Env env, Napi::Function /*jsCallback*/, ListenerEventQueue* queue) {
+        // Boşaltma sırasında gelen olaylar yeni bir çağrı planlayabilsin diye bayrak önce indirilir
+        queue->drainScheduled.store(false, std::memory_order_release);
+        while (ListenerEvent* event = queue->ring.Front()) {
+            Napi::HandleScope scope(env);
+            RecordOp(event->stats, kOpDelivery, event->queuedAt);
+            DeliverListenerEvent(env, *queue, *event);
+            event->card.reset(); // Slot yeniden kullanılana dek ATR kaydını tutmasın
+            queue->ring.Pop();
+            queue->delivered.fetch_add(1, std::memory_order_relaxed);
+            if (env.IsExceptionPending()) {
+                // Callback'ten fırlayan hata yakalanmamış hata olarak raporlanır, kalan olaylar iletilmeye devam eder
+                Napi::Error error = env.GetAndClearPendingException();
+                napi_fatal_exception(env, error.Value());
+            }
+        }
+    }
+
+    // Üretici: boş bir olay slotu ayırır. Kuyruk doluysa politikaya göre yer açılmasını bekler
+    // ya da olayı düşürüp sayacı artırır (nullptr).
+    ListenerEvent* BeginListenerEvent(const ListenerInfo& listener, ListenerEventType type, const std::string& readerName) {
+        ListenerEventQueue& queue = *listener.events;
+        ListenerEvent* event = queue.ring.BeginPush();
+        while (!event && queue.blockWhenFull && listener.instance->running.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            event = queue.ring.BeginPush();
+        }
+        if (!event) {
+            queue.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        event->type = type;
+        event->stats = readerName.empty() ? nullptr : FindStats(readerName);
+        CopyEventString(event->readerName, kMaxEventReaderName, readerName);
+        event->text[0] = '\0';
+        event->uidLength = 0;
+        event->verdict = kVerdictNone;
+        event->responseCount = 0;
+        event->dataLength = 0;
+        return event;
+    }
+
+    // Üretici: olayı yayınlar; bekleyen bir boşaltma yoksa JS thread'ine tek bir NonBlockingCall gönderir
+    void CommitListenerEvent(ListenerEventQueue& queue, ListenerEvent& event) {
+        event.queuedAt = std::chrono::steady_clock::now();
+        queue.ring.CommitPush();
+        if (!queue.drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+            napi_status status = queue.dispatcher.NonBlockingCall(&queue, DrainListenerEvents);
+            if (status != napi_ok) {
+                queue.drainScheduled.store(false, std::memory_order_release);
+                PCSC_LOG(kLogError) << "Failed to schedule listener event delivery: " << status;
+            }
+        }
+    }
+
+
+    // === Tap Günlüğü (Bellek Eşlemeli, Segmentli Denetim Kaydı) ===
+    // Dinleyici her kart olayını sabit boyutlu bir kayıt olarak çok üreticili halka tampona (MpscRing) yazar ve devam
+    // eder. Tampon ayrı bir yazıcı thread'inde boşaltılır ve önceden ayrılmış, bellek eşlemeli segment
+    // dosyalarına eklenir. Segment dolunca kullanılan boyuta kırpılıp kapatılır ve sıradaki açılır.
+    //
+    // Segment dosyası "taps-<sıra>.jnl" (little-endian):
+    //   başlık (32 bayt): "PCSCJNL1" | sürüm (u32) | sıra (u32) | oluşturulma (u64, unix µs) | 8 bayt ayrılmış
+    //   kayıtlar (8 bayta hizalı): uzunluk (u32, 0 = segment sonu) | sağlama (u32, gövdenin FNV-1a'sı) | gövde
+    //   gövde: zaman (u64, unix µs) | gecikme (u32, µs) | SW (u16) | karar (u8) | okuyucu adı uzunluğu (u8)
+    //          | UID uzunluğu (u8) | ATR uzunluğu (u8) | 2 bayt ayrılmış | okuyucu adı | UID | ATR
+    // Uzunluk alanı gövdeden sonra yazılır; yazılmakta olan segmenti okuyan bir tarayıcı yarım kayıt görmez.
+
+    const char kJournalMagic[8] = { 'P', 'C', 'S', 'C', 'J', 'N', 'L', '1' };
+    const uint32_t kJournalVersion = 1;
+    const size_t kJournalHeaderSize = 32;
+    const size_t kJournalRecordHeaderSize = 8;   // uzunluk + sağlama
+    const size_t kJournalBodyFixedSize = 20;
+    const size_t kJournalMaxAtr = 33;            // ISO 7816-3 ATR üst sınırı
+    const size_t kDefaultJournalSegmentSize = 8 * 1024 * 1024;
+    const size_t kMinJournalSegmentSize = 64 * 1024;
+    const size_t kDefaultJournalQueueSize = 4096;
+    const auto kJournalFlushInterval = std::chrono::milliseconds(50);
+    const char* const kJournalPrefix = "taps-";
+    const char* const kJournalSuffix = ".jnl";
+
+    // Halka tampon slotu: dinleyici thread'inde doldurulur, yazıcı thread'inde kayda çevrilir
+    struct JournalEntry {
+        uint64_t timestampUs = 0;
+        uint32_t latencyUs = 0;
+        uint16_t sw = 0;
+        UidVerdict verdict = kVerdictNone;
+        uint8_t readerLength = 0;
+        uint8_t uidLength = 0;
+        uint8_t atrLength = 0;
+        char readerName[kMaxEventReaderName];
+        SCardByte uid[kMaxEventUid];
+        SCardByte atr[kJournalMaxAtr];
+    };
+
+    inline uint64_t ReadLe64(const SCardByte* p) {
+        return static_cast<uint64_t>(ReadLe32(p)) | (static_cast<uint64_t>(ReadLe32(p + 4)) << 32);
+    }
+
+    inline void WriteLe64(SCardByte* p, uint64_t value) {
+        WriteLe32(p, static_cast<uint32_t>(value));
+        WriteLe32(p + 4, static_cast<uint32_t>(value >> 32));
+    }
+
+    inline size_t JournalRecordSize(size_t bodyLength) {
+        return (kJournalRecordHeaderSize + bodyLength + 7) & ~static_cast<size_t>(7);
+    }
+
+    std::string JournalSegmentPath(const std::string& directory, uint32_t sequence) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s%010u%s", kJournalPrefix, sequence, kJournalSuffix);
+        return directory + "/" + name;
+    }
+
+    // Dizindeki segmentlerin sıra numaraları (artan); dizin okunamazsa false
+    bool ListJournalSegments(const std::string& directory, std::vector<uint32_t>& sequences, std::string& error) {
+        sequences.clear();
+        auto parse = [&sequences](const char* name) {
+            size_t length = strlen(name), prefix = strlen(kJournalPrefix), suffix = strlen(kJournalSuffix);
+            if (length != prefix + 10 + suffix || strncmp(name, kJournalPrefix, prefix) != 0
+                    || strcmp(name + prefix + 10, kJournalSuffix) != 0) return;
+            uint32_t sequence = 0;
+            for (size_t i = prefix; i < prefix + 10; i++) {
+                if (name[i] < '0' || name[i] > '9') return;
+                sequence = sequence * 10 + static_cast<uint32_t>(name[i] - '0');
+            }
+            sequences.push_back(sequence);
+        };
+        #ifdef _WIN32
+            WIN32_FIND_DATAA found;
+            HANDLE search = FindFirstFileA((directory + "\\" + kJournalPrefix + "*" + kJournalSuffix).c_str(), &found);
+            if (search == INVALID_HANDLE_VALUE) {
+                if (GetLastError() == ERROR_FILE_NOT_FOUND) return true;
+                error = "Cannot read journal directory " + directory + " (error " + std::to_string(GetLastError()) + ")";
+                return false;
+            }
+            do {
+                parse(found.cFileName);
+            } while (FindNextFileA(search, &found));
+            FindClose(search);
+        #else
+            DIR* dir = opendir(directory.c_str());
+            if (!dir) {
+                error = "Cannot read journal directory " + directory + " (" + strerror(errno) + ")";
+                return false;
+            }
+            while (struct dirent* entry = readdir(dir)) parse(entry->d_name);
+            closedir(dir);
+        #endif
+        std::sort(sequences.begin(), sequences.end());
+        return true;
+    }
+
+    // Yazılabilir, önceden ayrılmış segment eşlemesi
+    class JournalSegment {
+    public:
+        JournalSegment() {}
+        JournalSegment(const JournalSegment&) = delete;
+        JournalSegment& operator=(const JournalSegment&) = delete;
+        ~JournalSegment() { Close(); }
+
+        bool Create(const std::string& segmentPath, size_t segmentSize, uint32_t sequence, std::string& error) {
+            #ifdef _WIN32
+                file = CreateFileA(segmentPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                   NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+                if (file == INVALID_HANDLE_VALUE) {
+                    error = "Cannot create " + segmentPath + " (error " + std::to_string(GetLastError()) + ")";
+                    return false;
+                }
+                LARGE_INTEGER size;
+                size.QuadPart = static_cast<LONGLONG>(segmentSize);
+                mapping = SetFilePointerEx(file, size, NULL, FILE_BEGIN) && SetEndOfFile(file)
+                    ? CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, 0, NULL) : NULL;
+                data = mapping != NULL ? static_cast<SCardByte*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0)) : nullptr;
+                if (!data) {
+                    error = "Cannot map " + segmentPath + " (error " + std::to_string(GetLastError()) + ")";
+                    Close();
+                    remove(segmentPath.c_str());
+                    return false;
+                }
+            #else
+                fd = open(segmentPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+                if (fd < 0) {
+                    error = "Cannot create " + segmentPath + " (" + strerror(errno) + ")";
+                    return false;
+                }
+                // Alanı baştan ayır: disk dolarsa segment açılırken fark edilir, yazarken SIGBUS alınmaz
+                #ifdef __linux__
+                    int allocateResult = posix_fallocate(fd, 0, static_cast<off_t>(segmentSize));
+                    if (allocateResult != 0) errno = allocateResult; // posix_fallocate errno'yu ayarlamaz
+                    bool allocated = allocateResult == 0;
+                #else
+                    bool allocated = ftruncate(fd, static_cast<off_t>(segmentSize)) == 0;
+                #endif
+                void* address = allocated
+                    ? mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+                if (address == MAP_FAILED) {
+                    error = "Cannot allocate " + segmentPath + " (" + strerror(errno) + ")";
+                    Close();
+                    remove(segmentPath.c_str());
+                    return false;
+                }
+                data = static_cast<SCardByte*>(address);
+            #endif
+            size = segmentSize;
+            memcpy(data, kJournalMagic, sizeof(kJournalMagic));
+            WriteLe32(data + 8, kJournalVersion);
+            WriteLe32(data + 12, sequence);
+            WriteLe64(data + 16, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count()));
+            used = kJournalHeaderSize;
+            path = segmentPath;
+            return true;
+        }
+
+        // Kaydı sona ekler; sığmazsa false (segment değiştirilmeli)
+        bool Append(const SCardByte* body, size_t bodyLength) {
+            size_t recordSize = JournalRecordSize(bodyLength);
+            if (!data || used + recordSize > size) return false;
+            SCardByte* record = data + used;
+            memcpy(record + kJournalRecordHeaderSize, body, bodyLength);
+            WriteLe32(record + 4, static_cast<uint32_t>(HashUid(body, bodyLength)));
+            std::atomic_thread_fence(std::memory_order_release);
+            WriteLe32(record, static_cast<uint32_t>(recordSize));
+            used += recordSize;
+            return true;
+        }
+
+        // Kirli sayfaları diske göndermeye başlar (beklemez)
+        void Flush() {
+            if (!data) return;
+            #ifdef _WIN32
+                FlushViewOfFile(data, used);
+            #else
+                msync(data, used, MS_ASYNC);
+            #endif
+        }
+
+        // Eşlemeyi kaldırır ve dosyayı kullanılan boyuta kırpar
+        void Close() {
+            #ifdef _WIN32
+                if (data) UnmapViewOfFile(data);
+                if (mapping != NULL) CloseHandle(mapping);
+                if (file != INVALID_HANDLE_VALUE) {
+                    LARGE_INTEGER length;
+                    length.QuadPart = static_cast<LONGLONG>(used);
+                    if (used > 0 && SetFilePointerEx(file, length, NULL, FILE_BEGIN)) SetEndOfFile(file);
+                    CloseHandle(file);
+                }
+                mapping = NULL;
+                file = INVALID_HANDLE_VALUE;
+            #else
+                if (data) munmap(data, size);
+                if (fd >= 0) {
+                    if (used > 0 && ftruncate(fd, static_cast<off_t>(used)) != 0) {
+                        PCSC_LOG(kLogWarn) << "Could not truncate journal segment " << path;
+                    }
+                    close(fd);
+                }
+                fd = -1;
+            #endif
+            data = nullptr;
+            size = 0;
+            used = 0;
+        }
+
+        bool IsOpen() const { return data != nullptr; }
+        size_t Used() const { return used; }
+
+    private:
+        SCardByte* data = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+        std::string path;
+        #ifdef _WIN32
+            HANDLE file = INVALID_HANDLE_VALUE;
+            HANDLE mapping = NULL;
+        #else
+            int fd = -1;
+        #endif
+    };
+
+    struct JournalOptions {
+        std::string directory;
+        size_t segmentSize = kDefaultJournalSegmentSize;
+        size_t maxSegments = 0;      // 0: sınırsız; aşılınca en eski segmentler silinir
+        size_t queueSize = kDefaultJournalQueueSize;
+    };
+
+    class TapJournal {
+    public:
+        explicit TapJournal(const JournalOptions& options) : options(options), ring(options.queueSize) {}
+
+        // Dizini hazırlar, yeni bir segment açar ve yazıcı thread'ini başlatır. Önceki çalıştırmaların
+        // segmentlerine dokunulmaz; numaralandırma en yüksek sıradan devam eder.
+        bool Start(std::string& error) {
+            #ifdef _WIN32
+                if (!CreateDirectoryA(options.directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+                    error = "Cannot create journal directory " + options.directory + " (error " + std::to_string(GetLastError()) + ")";
+                    return false;
+                }
+            #else
+                if (mkdir(options.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+                    error = "Cannot create journal directory " + options.directory + " (" + strerror(errno) + ")";
+                    return false;
+                }
+            #endif
+            std::vector<uint32_t> existing;
+            if (!ListJournalSegments(options.directory, existing, error)) return false;
+            segments.assign(existing.begin(), existing.end());
+            nextSequence = existing.empty() ? 1 : existing.back() + 1;
+            if (!OpenNextSegment(error)) return false;
+            try {
+                writer = std::thread(&TapJournal::Run, this);
+            } catch (const std::system_error& e) {
+                segment.Close(); // Eşleme kaldırılır, dosya kullanılan boyuta (başlık) kırpılır
+                error = "Failed to start tap journal writer thread: " + std::string(e.what());
+                return false;
+            }
+            return true;
+        }
+
+        // Kuyrukta kalanları yazar, segmenti kapatır ve thread'i bekler
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            if (writer.joinable()) writer.join();
+        }
+
+        // Dinleyici thread'i: tek bir halka itmesi; kuyruk doluysa kayıt düşürülür ve sayılır
+        void Record(const JournalEntry& entry) {
+            if (!ring.TryPush(entry)) dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const JournalOptions options;
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> failed{0};        // Segment açılamadığı için yazılamayanlar
+        std::atomic<uint32_t> currentSequence{0};
+        std::atomic<uint64_t> segmentBytes{0};
+
+    private:
+        bool OpenNextSegment(std::string& error) {
+            uint32_t sequence = nextSequence++;
+            if (!segment.Create(JournalSegmentPath(options.directory, sequence), options.segmentSize, sequence, error)) {
+                return false;
+            }
+            currentSequence.store(sequence);
+            segmentBytes.store(segment.Used());
+            segments.push_back(sequence);
+            while (options.maxSegments > 0 && segments.size() > options.maxSegments) {
+                remove(JournalSegmentPath(options.directory, segments.front()).c_str());
+                segments.pop_front();
+            }
+            return true;
+        }
+
+        void Write(const JournalEntry& entry) {
+            SCardByte body[kJournalBodyFixedSize + kMaxEventReaderName + kMaxEventUid + kJournalMaxAtr];
+            WriteLe64(body, entry.timestampUs);
+            WriteLe32(body + 8, entry.latencyUs);
+            body[12] = static_cast<SCardByte>(entry.sw >> 8);
+            body[13] = static_cast<SCardByte>(entry.sw);
+            body[14] = entry.verdict;
+            body[15] = entry.readerLength;
+            body[16] = entry.uidLength;
+            body[17] = entry.atrLength;
+            body[18] = body[19] = 0;
+            size_t length = kJournalBodyFixedSize;
+            memcpy(body + length, entry.readerName, entry.readerLength);
+            length += entry.readerLength;
+            memcpy(body + length, entry.uid, entry.uidLength);
+            length += entry.uidLength;
+            memcpy(body + length, entry.atr, entry.atrLength);
+            length += entry.atrLength;
+
+            if (!segment.Append(body, length)) {
+                segment.Close();
+                std::string error;
+                if (!OpenNextSegment(error) || !segment.Append(body, length)) {
+                    // Bir sonraki kayıtta yeni segment tekrar denenir
+                    PCSC_LOG(kLogError) << "Tap journal write failed: " << error;
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            segmentBytes.store(segment.Used(), std::memory_order_relaxed);
+            written.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void Run() {
+            bool done = false;
+            while (!done) {
+                {
+                    // Üretici uyandırmaz (dinleyicide kilit yok); yazıcı kısa aralıklarla kuyruğu boşaltır
+                    std::unique_lock<std::mutex> lock(wakeMutex);
+                    wake.wait_for(lock, kJournalFlushInterval, [this] { return stopping; });
+                    done = stopping;
+                }
+                bool any = false;
+                while (JournalEntry* entry = ring.Front()) {
+                    Write(*entry);
+                    ring.Pop();
+                    any = true;
+                }
+                if (any) segment.Flush();
+            }
+            segment.Close();
+        }
+
+        MpscRing<JournalEntry> ring;
+        JournalSegment segment;
+        std::deque<uint32_t> segments;   // Dizindeki segmentler (eskiden yeniye), saklama sınırı için
+        uint32_t nextSequence = 1;
+        std::thread writer;
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        bool stopping = false;
+    };
+
+    // Etkin günlük; std::atomic_load / std::atomic_store ile okunur ve değiştirilir (süreç geneli)
+    std::shared_ptr<TapJournal> g_tapJournal;
+    std::mutex g_tapJournalMutex;  // Açma / kapatmayı sıralar (ortamların kendi kontrol kuyrukları var)
+
+    // Dinleyici thread'i: kart olayını günlüğe ekler (günlük açık değilse hiçbir şey yapmaz)
+    void JournalTap(const std::string& readerName, const std::vector<SCardByte>& uid, const SCardByte* atr, size_t atrLength,
+                    uint16_t sw, UidVerdict verdict, std::chrono::steady_clock::time_point detectedAt) {
+        std::shared_ptr<TapJournal> journal = std::atomic_load(&g_tapJournal);
+        if (!journal) return;
+        JournalEntry entry;
+        auto latency = std::chrono::steady_clock::now() - detectedAt;
+        entry.timestampUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            (std::chrono::system_clock::now() - latency).time_since_epoch()).count());
+        entry.latencyUs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        entry.sw = sw;
+        entry.verdict = verdict;
+        entry.readerLength = static_cast<uint8_t>(std::min(readerName.size(), std::min<size_t>(kMaxEventReaderName, 255)));
+        memcpy(entry.readerName, readerName.data(), entry.readerLength);
+        entry.uidLength = static_cast<uint8_t>(std::min(uid.size(), kMaxEventUid));
+        memcpy(entry.uid, uid.data(), entry.uidLength);
+        entry.atrLength = static_cast<uint8_t>(std::min(atrLength, kJournalMaxAtr));
+        memcpy(entry.atr, atr, entry.atrLength);
+        journal->Record(entry);
+    }
+
+    // Günlüğü kapatır (kuyruktakiler yazılır); açık değilse false
+    bool CloseTapJournal() {
+        std::lock_guard<std::mutex> lock(g_tapJournalMutex);
+        std::shared_ptr<TapJournal> journal = std::atomic_load(&g_tapJournal);
+        if (!journal) return false;
+        std::atomic_store(&g_tapJournal, std::shared_ptr<TapJournal>());
+        journal->Stop();
+        PCSC_LOG(kLogInfo) << "Tap journal closed: " << journal->options.directory << " (" << journal->written.load() << " records)";
+        return true;
+    }
+
+    Napi::Object JournalInfoToObject(Napi::Env env, const TapJournal& journal) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("directory", Napi::String::New(env, journal.options.directory));
+        result.Set("segment", Napi::String::New(env, JournalSegmentPath(journal.options.directory, journal.currentSequence.load())));
+        result.Set("segmentSize", Napi::Number::New(env, static_cast<double>(journal.options.segmentSize)));
+        result.Set("segmentBytes", Napi::Number::New(env, static_cast<double>(journal.segmentBytes.load())));
+        result.Set("written", Napi::Number::New(env, static_cast<double>(journal.written.load())));
+        result.Set("dropped", Napi::Number::New(env, static_cast<double>(journal.dropped.load())));
+        result.Set("failed", Napi::Number::New(env, static_cast<double>(journal.failed.load())));
+        return result;
+    }
+
+    class OpenJournalWorker : public PcscPromiseWorker {
+    public:
+        OpenJournalWorker(Napi::Env env, Napi::Promise::Deferred deferred, const JournalOptions& options)
+            : PcscPromiseWorker(env, deferred, kJournalQueueKey),
+              options(options) {}
+
+    protected:
+        void Execute() override {
+            std::lock_guard<std::mutex> lock(g_tapJournalMutex);
+            if (std::atomic_load(&g_tapJournal)) {
+                SetError("A tap journal is already open. Call closeJournal() first.");
+                return;
+            }
+            journal = std::make_shared<TapJournal>(options);
+            std::string error;
+            if (!journal->Start(error)) {
+                SetError(error);
+                return;
+            }
+            std::atomic_store(&g_tapJournal, journal);
+            PCSC_LOG(kLogInfo) << "Tap journal opened: " << options.directory;
+        }
+
+        void OnOK() override {
+            deferred.Resolve(JournalInfoToObject(Env(), *journal));
+        }
+
+    private:
+        JournalOptions options;
+        std::shared_ptr<TapJournal> journal;
+    };
+
+    class CloseJournalWorker : public PcscPromiseWorker {
+    public:
+        CloseJournalWorker(Napi::Env env, Napi::Promise::Deferred deferred)
+            : PcscPromiseWorker(env, deferred, kJournalQueueKey) {}
+
+    protected:
+        void Execute() override {
+            closed = CloseTapJournal();
+        }
+
+        void OnOK() override {
+            deferred.Resolve(Napi::Boolean::New(Env(), closed));
+        }
+
+    private:
+        bool closed = false;
+    };
+
+    struct JournalScanFilter {
+        uint64_t sinceUs = 0;
+        uint64_t untilUs = std::numeric_limits<uint64_t>::max();
+        std::string readerName;   // Boşsa tüm okuyucular
+        size_t limit = std::numeric_limits<size_t>::max();
+    };
+
+    struct JournalRecord {
+        uint64_t timestampUs;
+        uint32_t latencyUs;
+        uint16_t sw;
+        UidVerdict verdict;
+        std::string readerName;
+        std::vector<SCardByte> uid;
+        std::vector<SCardByte> atr;
+        uint32_t segment;
+    };
+
+    // Bir segmentin geçerli kayıtlarını tarar; ilk bozuk ya da yarım kayıtta durur
+    void ScanJournalSegment(const MappedFile& file, uint32_t sequence, const JournalScanFilter& filter,
+                            std::vector<JournalRecord>& records) {
+        const SCardByte* data = file.Data();
+        size_t size = file.Size();
+        if (size < kJournalHeaderSize || memcmp(data, kJournalMagic, sizeof(kJournalMagic)) != 0
+                || ReadLe32(data + 8) != kJournalVersion) {
+            PCSC_LOG(kLogWarn) << "Skipping invalid journal segment " << sequence;
+            return;
+        }
+        size_t offset = kJournalHeaderSize;
+        while (offset + kJournalRecordHeaderSize + kJournalBodyFixedSize <= size && records.size() < filter.limit) {
+            size_t recordSize = ReadLe32(data + offset);
+            if (recordSize == 0) break; // Ayrılmış alanın yazılmamış kısmı
+            const SCardByte* body = data + offset + kJournalRecordHeaderSize;
+            size_t bodyLength = kJournalBodyFixedSize + body[15] + body[16] + body[17];
+            if (recordSize != JournalRecordSize(bodyLength) || offset + recordSize > size
+                    || ReadLe32(data + offset + 4) != static_cast<uint32_t>(HashUid(body, bodyLength))) {
+                PCSC_LOG(kLogWarn) << "Journal segment " << sequence << " is damaged after offset " << offset;
+                break;
+            }
+            offset += recordSize;
+
+            uint64_t timestampUs = ReadLe64(body);
+            const char* readerName = reinterpret_cast<const char*>(body + kJournalBodyFixedSize);
+            if (timestampUs < filter.sinceUs || timestampUs > filter.untilUs) continue;
+            if (!filter.readerName.empty()
+                    && filter.readerName.compare(0, std::string::npos, readerName, body[15]) != 0) continue;
+
+            JournalRecord record;
+            record.timestampUs = timestampUs;
+            record.latencyUs = ReadLe32(body + 8);
+            record.sw = static_cast<uint16_t>((body[12] << 8) | body[13]);
+            record.verdict = body[14] <= kVerdictDeny ? static_cast<UidVerdict>(body[14]) : kVerdictNone;
+            record.readerName.assign(readerName, body[15]);
+            const SCardByte* uid = body + kJournalBodyFixedSize + body[15];
+            record.uid.assign(uid, uid + body[16]);
+            record.atr.assign(uid + body[16], uid + body[16] + body[17]);
+            record.segment = sequence;
+            records.push_back(std::move(record));
+        }
+    }
+
+    // Günlük dizinini havuz thread'inde tarar (yazılmakta olan segment dahil)
+    class ReadJournalWorker : public PcscPromiseWorker {
+    public:
+        ReadJournalWorker(Napi::Env env, Napi::Promise::Deferred deferred, const std::string& directory,
+                          const JournalScanFilter& filter)
+            : PcscPromiseWorker(env, deferred, kJournalQueueKey),
+              directory(directory),
+              filter(filter) {}
+
+    protected:
+        void Execute() override {
+            std::vector<uint32_t> sequences;
+            std::string error;
+            if (!ListJournalSegments(directory, sequences, error)) {
+                SetError(error);
+                return;
+            }
+            for (uint32_t sequence : sequences) {
+                if (records.size() >= filter.limit) break;
+                MappedFile file;
+                if (!file.Map(JournalSegmentPath(directory, sequence), error)) continue; // Silinmiş veya boş segment
+                ScanJournalSegment(file, sequence, filter, records);
+            }
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            Napi::Array result = Napi::Array::New(env, records.size());
+            for (size_t i = 0; i < records.size(); i++) {
+                JournalRecord& record = records[i];
+                Napi::Object item = Napi::Object::New(env);
+                item.Set("timestamp", Napi::Number::New(env, record.timestampUs / 1000.0));
+                item.Set("readerName", Napi::String::New(env, record.readerName));
+                item.Set("uid", TakeBuffer(env, std::move(record.uid)));
+                item.Set("atr", TakeBuffer(env, std::move(record.atr)));
+                item.Set("sw", Napi::Number::New(env, record.sw));
+                item.Set("latencyUs", Napi::Number::New(env, record.latencyUs));
+                item.Set("verdict", record.verdict == kVerdictNone ? env.Null()
+                                                                   : Napi::Value(Napi::String::New(env, kVerdictNames[record.verdict])));
+                item.Set("segment", Napi::Number::New(env, record.segment));
+                result.Set(static_cast<uint32_t>(i), item);
+            }
+            deferred.Resolve(result);
+        }
+
+    private:
+        std::string directory;
+        JournalScanFilter filter;
+        std::vector<JournalRecord> records;
+    };
+
+
+    // === Kart Dinleme İş Parçacığı ===
+
+    // Dinleyici thread'inin izlediği tek bir okuyucu
+    struct WatchedReader {
+        std::string name;
+        SCardDword currentState = SCARD_STATE_UNAWARE;    // Dizi yeniden kurulurken korunan son durum
+        bool reportedUnavailable = false;                 // Okuyucu erişilemez hatası bir kez raporlanır
+
+        // Debounce durumu: aynı UID, okuyucu boşalana (SCARD_STATE_EMPTY) kadar tekrar raporlanmaz
+        std::vector<SCardByte> lastUid;
+        bool removedSinceLastUid = true;
+        std::chrono::steady_clock::time_point lastUidReportedAt{};
+
+        ReaderStats* stats = nullptr;                      // FindStats(name) önbelleği (ilk bağlantıda dolar)
+    };
+
+    // Çalışan dinleyiciye updateListener() ile gönderilen değişiklik. Alanlar isteğe bağlıdır; dinleyici
+    // komutu SCardGetStatusChange çağrıları arasında uygular, hatayı yazar ve done'ı işaretler.
+    struct ListenerCommand {
+        std::vector<std::string> addReaders;
+        std::vector<std::string> removeReaders;
+        bool setReaders = false;                      // true: izleme listesi 'readers' ile değiştirilir
+        std::vector<std::string> readers;             // setReaders için; boşsa bağlı tüm okuyucular
+        bool setProgram = false;
+        std::vector<std::vector<SCardByte>> program;
+        bool setProgramStopOnError = false;
+        bool programStopOnError = false;
+        bool setSameUidCooldown = false;
+        std::chrono::milliseconds sameUidCooldown{0};
+
+        std::string error;                            // Dinleyici yazar, done'dan önce
+        std::atomic<bool> done{false};
+    };
+
+    const size_t kListenerCommandQueueSize = 64;
+
+    // Kilitsiz komut kuyruğu; dinleyici sonlanınca closed işaretlenir (bekleyen işler vazgeçer)
+    struct ListenerCommandQueue {
+        MpscRing<std::shared_ptr<ListenerCommand>> ring{kListenerCommandQueueSize};
+        std::atomic<bool> closed{false};
+    };
+
+    // Olay sayacı (Windows ve PCSC-lite dwEventState'in üst 16 bitinde taşır)
+    inline SCardDword EventCount(SCardDword state) {
+        return (state >> 16) & 0xFFFF;
+    }
+
+    // Yeni bir kart takıldı mı? Durum PRESENT'a geçtiyse ya da PRESENT kalıp olay sayacı
+    // değiştiyse (iki çağrı arasında kart değiştirildi) true. Sadece INUSE/EXCLUSIVE değişimi sayılmaz.
+    inline bool IsCardInserted(SCardDword previousState, SCardDword eventState) {
+        if (!(eventState & SCARD_STATE_PRESENT) || (eventState & SCARD_STATE_MUTE)) return false;
+        if (!(previousState & SCARD_STATE_PRESENT)) return true;
+        return EventCount(previousState) != EventCount(eventState);
+    }
+
+    // SCardGetStatusChange dizisini okuyucu listesinden yeniden kurar.
+    // PnP etkinse sahte okuyucu dizinin sonundadır. szReader işaretçileri 'readers' içine bakar.
+    void RebuildReaderStates(const std::vector<WatchedReader>& readers, std::vector<SCardReaderState>& readerStates,
+                             bool pnpEnabled, SCardDword pnpState) {
+        readerStates.resize(readers.size() + (pnpEnabled ? 1 : 0));
+        for (size_t i = 0; i < readerStates.size(); i++) {
+            memset(&readerStates[i], 0, sizeof(SCardReaderState));
+            if (i < readers.size()) {
+                readerStates[i].szReader = readers[i].name.c_str();
+                readerStates[i].dwCurrentState = readers[i].currentState;
+            } else {
+                readerStates[i].szReader = kPnpNotificationReader;
+                readerStates[i].dwCurrentState = pnpState; // Üst 16 bit okuyucu sayısını taşır
+            }
+        }
+    }
+
+    // Mesajı (ve varsa okuyucu adını) JS onError callback'ine iletir
+    void EmitListenerError(const ListenerInfo& listener, const std::string& message, const std::string& readerName = std::string()) {
+        ListenerEvent* event = BeginListenerEvent(listener, ListenerEventType::Error, readerName);
+        if (!event) return;
+        CopyEventString(event->text, kMaxEventText, message);
+        CommitListenerEvent(*listener.events, *event);
+    }
+
+    // Okuyucudaki karta bağlanır, UID'yi okur, varsa tap programını çalıştırır ve sonucu JS onUid callback'ine iletir.
+    // UID iletildiyse true döner; debounce tarafından bastırılan tekrarlar için false.
+    bool ReadCardUid(const ListenerInfo& listener, WatchedReader& reader, const SCardByte* atr, size_t atrLength) {
+        const std::string& readerName = reader.name;
+        auto detectedAt = std::chrono::steady_clock::now();
+        PCSC_LOG(kLogDebug) << "Card detected in reader: " << readerName;
+        SCARDHANDLE hCard = 0;
+        SCardDword dwActiveProtocol = 0;
+        if (!reader.stats) reader.stats = FindStats(readerName);
+
+        // Karta bağlan (SCardConnect her iki platformda da var)
+        SCardLong rv = ConnectCard(listener.instance->listenerContext, readerName, reader.stats, &hCard, &dwActiveProtocol);
+        if (rv != SCARD_S_SUCCESS) {
+            // Connect hatası
+            PCSC_LOG(kLogError) << "Failed to connect to card (SCardConnect): " << SCardErrorToString(rv);
+            EmitListenerError(listener, "Error: Failed to connect to card. " + SCardErrorToString(rv), readerName);
+            return false;
+        }
+
+        // UID APDU (platformdan bağımsız)
+        SCardByte cmd_get_uid[] = { 0xFF, 0xCA, 0x00, 0x00, 0x00 };
+        std::vector<SCardByte> recvBufferVec;
+        rv = TransmitApdu(hCard, dwActiveProtocol, cmd_get_uid, sizeof(cmd_get_uid), recvBufferVec, reader.stats);
+        SCardDword recvLength = static_cast<SCardDword>(recvBufferVec.size());
+
+        if (rv != SCARD_S_SUCCESS) {
+            Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+            // Transmit hatası
+            PCSC_LOG(kLogError) << "Failed to get UID (SCardTransmit): " << SCardErrorToString(rv);
+            EmitListenerError(listener, "Error: Failed to read UID from card. " + SCardErrorToString(rv), readerName);
+            return false;
+        }
+        if (recvLength < 2) {
+            Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+            PCSC_LOG(kLogWarn) << "SCardTransmit succeeded but received less than 2 bytes.";
+            return false;
+        }
+
+        // Debounce: okuyucu boşalmadan aynı UID tekrar raporlanmaz; ayarlıysa kaldırıldıktan
+        // sonra da bekleme süresi dolana kadar aynı UID bastırılır
+        std::vector<SCardByte> uidBytes(recvBufferVec.begin(), recvBufferVec.end() - 2);
+        auto now = std::chrono::steady_clock::now();
+        if (uidBytes == reader.lastUid
+                && (!reader.removedSinceLastUid || now - reader.lastUidReportedAt < listener.sameUidCooldown)) {
+            Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+            PCSC_LOG(kLogDebug) << "Duplicate card suppressed on reader: " << readerName;
+            return false;
+        }
+        reader.lastUid = uidBytes;
+        reader.removedSinceLastUid = false;
+        reader.lastUidReportedAt = now;
+
+        // Erişim kararı: UID indeksi yüklüyse burada, JS'e hiçbir şey gönderilmeden verilir
+        UidVerdict verdict = CheckUid(uidBytes.data(), uidBytes.size());
+
+        // Tap programı: bağlantı hâlâ açıkken aynı hCard üzerinde çalıştırılır
+        std::vector<std::vector<SCardByte>> responses;
+        for (size_t i = 0; i < listener.program.size(); i++) {
+            std::vector<SCardByte> response;
+            rv = TransmitChained([hCard, dwActiveProtocol, &reader](const SCardByte* apdu, size_t apduLength, std::vector<SCardByte>& out) {
+                return TransmitApdu(hCard, dwActiveProtocol, apdu, apduLength, out, reader.stats);
+            }, listener.program[i], response);
+            if (rv != SCARD_S_SUCCESS) {
+                // Kısmi yanıtlar yine de UID ile birlikte iletilir
+                PCSC_LOG(kLogError) << "Tap program APDU " << i << " failed: " << SCardErrorToString(rv);
+                EmitListenerError(listener, "Error: Tap program APDU " + std::to_string(i) + " failed. " + SCardErrorToString(rv), readerName);
+                break;
+            }
+            responses.push_back(std::move(response));
+            if (listener.programStopOnError && StatusWord(responses.back()) != 0x9000) break;
+        }
+        Backend().Disconnect(hCard, SCARD_LEAVE_CARD);
+
+        // Denetim kaydı: olay kuyruğu dolu olsa da her dokunuş günlüğe girer (yalnızca halka itmesi)
+        JournalTap(readerName, uidBytes, atr, atrLength, StatusWord(recvBufferVec), verdict, detectedAt);
+
+        // JS'e gönder (olay kuyruğu): onUid(uid, readerName, responses, card, verdict)
+        ListenerEvent* event = BeginListenerEvent(listener, ListenerEventType::Card, readerName);
+        if (!event) {
+            PCSC_LOG(kLogWarn) << "Event queue full, card event dropped for reader: " << readerName;
+            return true;
+        }
+        event->detectedAt = detectedAt;
+        event->card = atrLength > 0 ? LookupAtr(atr, atrLength) : nullptr;
+        event->verdict = verdict;
+        event->uidLength = static_cast<uint8_t>(std::min(uidBytes.size(), kMaxEventUid));
+        memcpy(event->uid, uidBytes.data(), event->uidLength);
+        bool truncated = false;
+        for (const auto& response : responses) {
+            if (!AppendEventResponse(*event, response)) {
+                truncated = true;
+                break;
+            }
+        }
+        CommitListenerEvent(*listener.events, *event);
+        if (truncated) {
+            EmitListenerError(listener, "Error: Tap program responses exceed the event size limit and were truncated.", readerName);
+        }
+        return true;
+    }
+
+    // Okuyucu takıldı/çıkarıldı olayını JS onReaderChange callback'ine iletir (tanımlıysa)
+    void EmitReaderChange(const ListenerInfo& listener, const char* eventName, const std::string& readerName) {
+        if (listener.events->onReaderChange.IsEmpty()) return; // Sabit; sadece başlangıçta JS thread'inde atanır
+        ListenerEvent* event = BeginListenerEvent(listener, ListenerEventType::ReaderChange, readerName);
+        if (!event) return;
+        CopyEventString(event->text, kMaxEventText, eventName);
+        CommitListenerEvent(*listener.events, *event);
+    }
+
+    // İzlenen okuyucu adlarını hata mesajları için birleştirir: 'A', 'B'
+    std::string DescribeReaders(const std::vector<WatchedReader>& readers) {
+        std::string result;
+        for (const auto& reader : readers) {
+            if (!result.empty()) result += ", ";
+            result += "'" + reader.name + "'";
+        }
+        return result;
+    }
+
+    // PnP bildirimi sonrası okuyucu listesini yeniler, attach/detach olaylarını iletir.
+    // Tüm okuyucular izleniyorsa izleme listesini de günceller; liste değiştiyse true döner.
+    bool HandleReaderListChange(const ListenerInfo& listener, std::vector<WatchedReader>& readers) {
+        std::vector<std::string> readerNames;
+        SCardLong rv = ListReaderNames(listener.instance->listenerContext.context, readerNames);
+        if (rv != SCARD_S_SUCCESS) {
+            PCSC_LOG(kLogError) << "Failed to refresh reader list: " << SCardErrorToString(rv);
+            return false;
+        }
+
+        std::vector<std::string> attached, detached;
+        UpdateReaderCache(readerNames, &attached, &detached);
+        for (const auto& name : detached) {
+            PCSC_LOG(kLogInfo) << "Reader detached: " << name;
+            ForgetReaderFeatures(name);
+            EmitReaderChange(listener, "detached", name);
+        }
+        for (const auto& name : attached) {
+            PCSC_LOG(kLogInfo) << "Reader attached: " << name;
+            // Özellik tablosu olaydan önce doldurulur; attach callback'indeki control() çağrısı önbellekten çözülür
+            PrefetchReaderFeatures(listener.instance->listenerContext, name);
+            EmitReaderChange(listener, "attached", name);
+        }
+
+        if (!listener.watchAll || (attached.empty() && detached.empty())) return false;
+
+        // Çıkarılan okuyucuları bırak, yenilerini UNAWARE durumla ekle
+        readers.erase(std::remove_if(readers.begin(), readers.end(), [&](const WatchedReader& reader) {
+            return std::find(readerNames.begin(), readerNames.end(), reader.name) == readerNames.end();
+        }), readers.end());
+        for (const auto& name : attached) {
+            WatchedReader reader;
+            reader.name = name;
+            readers.push_back(reader);
+        }
+        return true;
+    }
+
+    // Tek bir updateListener() komutunu uygular. Önce yeni okuyucu listesi hesaplanıp doğrulanır; hata
+    // varsa hiçbir alan değişmez. Okuyucu listesi değiştiyse true döner.
+    bool ApplyListenerCommand(ListenerInfo& listener, std::vector<WatchedReader>& readers, ListenerCommand& command,
+                              bool pnpEnabled) {
+        bool watchAll = listener.watchAll;
+        std::vector<std::string> names;
+        names.reserve(readers.size());
+        for (const auto& reader : readers) names.push_back(reader.name);
+
+        if (command.setReaders) {
+            watchAll = command.readers.empty();
+            if (watchAll) {
+                std::vector<std::string> connectedReaders;
+                SCardLong rv = ListReaderNames(listener.instance->listenerContext.context, connectedReaders);
+                if (rv != SCARD_S_SUCCESS) {
+                    command.error = "Failed to list readers. " + SCardErrorToString(rv);
+                    return false;
+                }
+                names = std::move(connectedReaders);
+            } else {
+                names.clear();
+                for (const auto& name : command.readers) {
+                    if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+                }
+            }
+        }
+        if (!command.addReaders.empty() || !command.removeReaders.empty()) {
+            if (watchAll) {
+                command.error = "Cannot add or remove readers while listening on all readers; set 'readers' to a list first.";
+                return false;
+            }
+            for (const auto& name : command.removeReaders) {
+                names.erase(std::remove(names.begin(), names.end(), name), names.end());
+            }
+            for (const auto& name : command.addReaders) {
+                if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+            }
+        }
+        // Boş liste yalnızca tüm okuyucular izlenirken ve PnP bildirimi bir okuyucu takılınca uyandıracaksa geçerli
+        if (names.empty() && (!watchAll || !pnpEnabled)) {
+            command.error = "The update would leave the listener without readers.";
+            return false;
+        }
+
+        if (command.setProgram) listener.program = std::move(command.program);
+        if (command.setProgramStopOnError) listener.programStopOnError = command.programStopOnError;
+        if (command.setSameUidCooldown) listener.sameUidCooldown = command.sameUidCooldown;
+
+        bool changed = watchAll != listener.watchAll || names.size() != readers.size();
+        for (size_t i = 0; !changed && i < names.size(); i++) changed = names[i] != readers[i].name;
+        if (!changed) return false;
+
+        // Kalan okuyucular durumlarını ve debounce bilgilerini korur; yeniler UNAWARE başlar
+        // (takılı bir kart ilk çağrıda raporlanır)
+        std::vector<WatchedReader> updated(names.size());
+        for (size_t i = 0; i < names.size(); i++) {
+            auto existing = std::find_if(readers.begin(), readers.end(), [&](const WatchedReader& reader) {
+                return reader.name == names[i];
+            });
+            if (existing != readers.end()) {
+                updated[i] = std::move(*existing);
+            } else {
+                updated[i].name = names[i];
+            }
+        }
+        readers = std::move(updated);
+        listener.watchAll = watchAll;
+        listener.readerNames = watchAll ? std::vector<std::string>() : names;
+        return true;
+    }
+
+    // Bekleyen updateListener() komutlarını dinleyici thread'inde, SCardGetStatusChange çağrıları arasında uygular.
+    // Okuyucu listesi değiştiyse durum dizisi yeniden kurulur ve true döner.
+    bool DrainListenerCommands(ListenerInfo& listener, std::vector<WatchedReader>& readers,
+                               std::vector<SCardReaderState>& readerStates, bool pnpEnabled, SCardDword pnpState) {
+        ListenerCommandQueue& queue = *listener.commands;
+        if (!queue.ring.Front()) return false;
+
+        // Okuyucuların son durumlarını dizi yeniden kurulmadan önce sakla
+        for (size_t i = 0; i < readers.size(); i++) {
+            readers[i].currentState = readerStates[i].dwCurrentState;
+        }
+        bool rebuild = false;
+        while (std::shared_ptr<ListenerCommand>* slot = queue.ring.Front()) {
+            std::shared_ptr<ListenerCommand> command = std::move(*slot);
+            *slot = nullptr;
+            queue.ring.Pop();
+            if (ApplyListenerCommand(listener, readers, *command, pnpEnabled)) rebuild = true;
+            command->done.store(true, std::memory_order_release);
+        }
+        if (!rebuild) return false;
+
+        RebuildReaderStates(readers, readerStates, pnpEnabled, pnpState);
+        if (readers.empty()) {
+            PCSC_LOG(kLogInfo) << "Listener updated, waiting for a reader to be attached.";
+        } else {
+            PCSC_LOG(kLogInfo) << "Listener updated, listening for cards on reader(s): " << DescribeReaders(readers);
+        }
+        return true;
+    }
+
+    // PC/SC servisi kaybolduğunda context yeniden kurulana kadar bekler (geri çekilme
+    // EstablishContextLocked'ta uygulanır). Dinleyici bu sırada durdurulursa false döner.
+    bool WaitForContextRecovery(const ListenerInfo& listener, SCARDCONTEXT lostContext, SCardLong rv) {
+        AddonInstance& instance = *listener.instance;
+        PCSC_LOG(kLogWarn) << "PC/SC service lost, listener waiting for it to come back. " << SCardErrorToString(rv);
+        EmitListenerError(listener, "Error: PC/SC service unavailable, reconnecting. " + SCardErrorToString(rv));
+        while (instance.running.load()) {
+            if (RecoverContext(instance.listenerContext, lostContext, rv)) {
+                PCSC_LOG(kLogInfo) << "PC/SC service available again, listener resumed.";
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    }
+
+    // Tüm okuyucular (ve PnP sahte okuyucusu) tek bir SCardGetStatusChange çağrısıyla izlenir
+    void ListenLoop(ListenerInfo& listener) {
+        AddonInstance& instance = *listener.instance;
+        std::vector<std::string> readerNames = listener.readerNames;
+        {
+            // Başlangıç listesi önbelleği de doldurur (olay üretmeden)
+            std::vector<std::string> connectedReaders;
+            SCardLong rv = ListReaderNames(instance.listenerContext.context, connectedReaders);
+            if (rv == SCARD_S_SUCCESS) {
+                UpdateReaderCache(connectedReaders);
+                if (listener.watchAll) readerNames = connectedReaders;
+            } else if (listener.watchAll) {
+                PCSC_LOG(kLogError) << "Failed to list readers. " << SCardErrorToString(rv);
+                EmitListenerError(listener, "Error: Failed to list readers. " + SCardErrorToString(rv));
+                instance.running = false;
+                return;
+            }
+        }
+
+        std::vector<WatchedReader> readers(readerNames.size());
+        for (size_t i = 0; i < readers.size(); i++) {
+            readers[i].name = readerNames[i];
+        }
+        bool pnpEnabled = true;
+        SCardDword pnpState = SCARD_STATE_UNAWARE;
+        std::vector<SCardReaderState> readerStates;
+        RebuildReaderStates(readers, readerStates, pnpEnabled, pnpState);
+
+        if (readers.empty()) {
+            PCSC_LOG(kLogInfo) << "No readers connected yet, waiting for a reader to be attached.";
+        } else {
+            PCSC_LOG(kLogInfo) << "Listening for cards on reader(s): " << DescribeReaders(readers);
+        }
+
+        while (instance.running.load()) {
+            DrainListenerCommands(listener, readers, readerStates, pnpEnabled, pnpState);
+
+            // Tüm okuyucular tek SCardGetStatusChange çağrısında, süresiz beklenir: boşta hiç uyanma olmaz.
+            // Durdurma ve updateListener() komutları dinleyici context'ine SCardCancel göndererek uyandırır.
+            SCardDword timeoutMs = INFINITE;
+            SCARDCONTEXT context = instance.listenerContext.context;
+            SCardLong rv = Backend().GetStatusChange(context, timeoutMs, readerStates.data(), (SCardDword)readerStates.size());
+
+            if (!instance.running.load()) break; // Cancel sonrası kontrol
+
+            if (rv == SCARD_S_SUCCESS) {
+                g_statusChangeWakeups.fetch_add(1, std::memory_order_relaxed);
+            } else if (rv == SCARD_E_TIMEOUT) {
+                g_statusChangeTimeouts.fetch_add(1, std::memory_order_relaxed);
+            } else if (rv != SCARD_E_CANCELLED) {
+                CountError(rv);
+            }
+
+            if (rv == SCARD_E_CANCELLED) {
+                // Dinleyici çalışıyorsa iptal bir updateListener() komutu içindir: döngü başında uygulanır
+                g_statusChangeCancels.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            } else if (rv == SCARD_E_TIMEOUT) {
+                continue; // Timeout normal, döngüye devam
+            } else if (IsContextLost(rv)) {
+                // PC/SC servisi yeniden başladı: context yenilenince okuyucu durumları sıfırdan okunur
+                if (!WaitForContextRecovery(listener, context, rv)) break;
+                if (instance.listenerContext.context == context) {
+                    PCSC_LOG(kLogError) << "PC/SC context became invalid.";
+                    EmitListenerError(listener, "Critical Error: PC/SC context became invalid. Restart might be required.");
+                    instance.running = false;
+                    break;
+                }
+                HandleReaderListChange(listener, readers);
+                for (auto& reader : readers) {
+                    reader.currentState = SCARD_STATE_UNAWARE; // Takılı kartlar debounce'a takılır, tekrar raporlanmaz
+                }
+                pnpState = SCARD_STATE_UNAWARE;
+                RebuildReaderStates(readers, readerStates, pnpEnabled, pnpState);
+                continue;
+            } else if (rv == SCARD_E_UNKNOWN_READER || rv == SCARD_E_READER_UNAVAILABLE
+                    #ifndef _WIN32 // PCSC-lite'da bu hata farklı olabilir veya olmayabilir
+                    || rv == SCARD_E_COMM_DATA_LOST // Windows'a özgü olabilir
+                    #endif
+            ) {
+                 PCSC_LOG(kLogError) << "Reader(s) " << DescribeReaders(readers) << " unavailable or service stopped. " << SCardErrorToString(rv);
+                 EmitListenerError(listener, "Error: Reader(s) " + DescribeReaders(readers) + " unavailable or PC/SC service stopped. " + SCardErrorToString(rv));
+                 instance.running = false; // Hata sonrası dinleyiciyi durdur
+                 break;
+            } else if (rv != SCARD_S_SUCCESS) {
+                // Diğer beklenmedik hatalar
+                PCSC_LOG(kLogError) << "SCardGetStatusChange failed! " << SCardErrorToString(rv);
+                std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Kısa bekleme
+                continue;
+            }
+
+            // Önce PnP: okuyucu listesi değiştiyse dizi yeniden kurulur, çıkarılan okuyucular için hata üretilmez
+            if (pnpEnabled) {
+                const SCardDword pnpEvent = readerStates.back().dwEventState;
+                if (pnpEvent & (SCARD_STATE_UNKNOWN | SCARD_STATE_CHANGED)) {
+                    // Okuyucuların son durumlarını dizi yeniden kurulmadan önce sakla
+                    for (size_t i = 0; i < readers.size(); i++) {
+                        readers[i].currentState = readerStates[i].dwCurrentState;
+                    }
+                    bool rebuild = false;
+                    if (pnpEvent & SCARD_STATE_UNKNOWN) {
+                        // Platform PnP bildirimini desteklemiyor
+                        PCSC_LOG(kLogWarn) << "PnP reader notifications not supported, reader list will not be tracked.";
+                        pnpEnabled = false;
+                        rebuild = true;
+                        if (readers.empty()) {
+                            EmitListenerError(listener, "Error: No readers available to listen on.");
+                            instance.running = false;
+                            break;
+                        }
+                    } else {
+                        pnpState = pnpEvent;
+                        rebuild = HandleReaderListChange(listener, readers);
+                        readerStates.back().dwCurrentState = pnpState;
+                    }
+                    if (rebuild) {
+                        // Bu turun okuyucu olayları bir sonraki çağrıda yeniden raporlanır (dwCurrentState güncellenmedi)
+                        RebuildReaderStates(readers, readerStates, pnpEnabled, pnpState);
+                        if (!readers.empty()) {
+                            PCSC_LOG(kLogInfo) << "Listening for cards on reader(s): " << DescribeReaders(readers);
+                        }
+                        continue;
+                    }
+                }
+            }
+
+            // Durum değişikliklerini okuyucu bazında işle (dwEventState alanı her iki platformda da var)
+            for (size_t i = 0; i < readers.size() && instance.running.load(); i++) {
+                SCardReaderState& readerState = readerStates[i];
+                WatchedReader& reader = readers[i];
+                if (!(readerState.dwEventState & SCARD_STATE_CHANGED)) continue;
+
+                // Yeni durumu bir sonraki kontrol için sakla (dwCurrentState alanı da ortak)
+                const SCardDword previousState = readerState.dwCurrentState;
+                readerState.dwCurrentState = readerState.dwEventState;
+
+                if (readerState.dwEventState & (SCARD_STATE_UNKNOWN | SCARD_STATE_UNAVAILABLE)) {
+                    // Tek okuyucunun kaybı diğerlerini durdurmaz; bir kez raporla
+                    if (!reader.reportedUnavailable) {
+                        reader.reportedUnavailable = true;
+                        PCSC_LOG(kLogError) << "Reader '" << reader.name << "' unavailable.";
+                        EmitListenerError(listener, "Error: Reader '" + reader.name + "' unavailable.", reader.name);
+                    }
+                    continue;
+                }
+                reader.reportedUnavailable = false;
+
+                // Yeni kart takıldı ve sessiz değil mi? (Takılı kalan kart yeniden okunmaz)
+                if (IsCardInserted(previousState, readerState.dwEventState)) {
+                    ReadCardUid(listener, reader, readerState.rgbAtr,
+                                std::min<size_t>(readerState.cbAtr, sizeof(readerState.rgbAtr)));
+                } else if (readerState.dwEventState & SCARD_STATE_EMPTY) {
+                    reader.removedSinceLastUid = true;
+                    PCSC_LOG(kLogDebug) << "Card removed from reader: " << reader.name;
+                }
+            }
+        } // while (running)
+
+        PCSC_LOG(kLogInfo) << "Listener stopped for reader(s): " << DescribeReaders(readers);
+    }
+
+    void PollForCard(AddonInstance* instance) {
+        std::unique_ptr<ListenerInfo> listener;
+        // Dinleyici bilgilerini güvenli kopyala
+        {
+            std::lock_guard<std::mutex> lock(instance->listenerMutex);
+            const std::unique_ptr<ListenerInfo>& active = instance->activeListener;
+            if (!active || !active->events) {
+                 PCSC_LOG(kLogError) << "PollForCard started without a valid listener.";
+                 instance->listenerExited = true;
+                 return;
+            }
+            // Kopyasını oluştur
+            listener = std::make_unique<ListenerInfo>();
+            listener->instance = instance;
+            listener->readerNames = active->readerNames;
+            listener->watchAll = active->watchAll;
+            listener->events = active->events;
+            listener->commands = active->commands;
+            listener->program = active->program;
+            listener->programStopOnError = active->programStopOnError;
+            listener->sameUidCooldown = active->sameUidCooldown;
+        }
+
+        ListenLoop(*listener);
+
+        // Uygulanmamış komutlar reddedilir; bekleyen updateListener() çağrıları closed'u görüp vazgeçer
+        ListenerCommandQueue& commands = *listener->commands;
+        commands.closed.store(true);
+        while (std::shared_ptr<ListenerCommand>* slot = commands.ring.Front()) {
+            std::shared_ptr<ListenerCommand> command = std::move(*slot);
+            *slot = nullptr;
+            commands.ring.Pop();
+            command->error = "Listener stopped.";
+            command->done.store(true, std::memory_order_release);
+        }
+
+        // TSFN'i serbest bırak (önemli!). Kuyruğa olan referans önce bırakılır; son referans
+        // TSFN finalizer'ında JS thread'inde düşer (FunctionReference'lar orada silinmeli).
+        Napi::ThreadSafeFunction dispatcher = listener->events->dispatcher;
+        listener.reset();
+        dispatcher.Release();
+        instance->listenerExited = true;
+    }
+
+
+    // === N-API Fonksiyonları ===
+
+    Napi::Value GetAllReaders(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (!EnsureContext(InstanceFor(env).mainContext, &env)) return env.Null();
+
+        std::vector<std::string> readerNames;
+        SCardLong rv = ListReaderNames(InstanceFor(env).mainContext, readerNames);
+        if (rv != SCARD_S_SUCCESS) {
+            ThrowNapiError(env, "Failed to list readers", rv);
+            return env.Null();
+        }
+        UpdateReaderCache(readerNames);
+
+        Napi::Array result = Napi::Array::New(env, readerNames.size());
+        for (uint32_t i = 0; i < readerNames.size(); i++) {
+            result.Set(i, Napi::String::New(env, readerNames[i]));
+        }
+        return result;
+    }
+
+    // listReaders(): getAllReaders'ın asenkron karşılığı; liste havuz thread'inde alınır
+    Napi::Value ListReaders(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        ListReadersWorker* worker = new ListReadersWorker(env, deferred);
+        worker->Queue();
+        return deferred.Promise();
+    }
+
+    // getReaderStatus(): tüm okuyucuların anlık durumu (tek SCardGetStatusChange çağrısı)
+    Napi::Value GetReaderStatus(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        ReaderStatusWorker* worker = new ReaderStatusWorker(env, deferred);
+        worker->Queue();
+        return deferred.Promise();
+    }
+
+    // parseAtr(atr): ATR'ı çözer ve kart türünü belirler (dinleyici olaylarındaki card nesnesiyle aynı)
+    Napi::Value ParseAtr(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsBuffer()) {
+            Napi::TypeError::New(env, "Parameter expected: atr (Buffer)").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Buffer<SCardByte> atr = info[0].As<Napi::Buffer<SCardByte>>();
+        return AtrInfoToObject(env, *LookupAtr(atr.Data(), atr.Length()));
+    }
+
+    // Önbellekteki okuyucu listesini döner; PC/SC servisine gidilmez
+    Napi::Value GetCachedReaders(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        std::lock_guard<std::mutex> lock(g_readerCacheMutex);
+        Napi::Array result = Napi::Array::New(env, g_cachedReaders.size());
+        for (uint32_t i = 0; i < g_cachedReaders.size(); i++) {
+            result.Set(i, Napi::String::New(env, g_cachedReaders[i]));
+        }
+        return result;
+    }
+
+    Napi::Value StartListening(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 3 || !(info[0].IsString() || info[0].IsArray() || info[0].IsNull() || info[0].IsUndefined())
+                || !info[1].IsFunction() || !info[2].IsFunction()) {
+            Napi::TypeError::New(env, "Parameters expected: readers (string | string[] | null), onUid (function), onError (function)").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        // Okuyucu listesi: tek isim, isim dizisi veya null/boş dizi (tüm okuyucular)
+        std::vector<std::string> readerNames;
+        if (info[0].IsString()) {
+            readerNames.push_back(info[0].As<Napi::String>().Utf8Value());
+        } else if (info[0].IsArray()) {
+            Napi::Array readersArray = info[0].As<Napi::Array>();
+            for (uint32_t i = 0; i < readersArray.Length(); i++) {
+                Napi::Value item = readersArray.Get(i);
+                if (!item.IsString()) {
+                    Napi::TypeError::New(env, "Reader names must be strings.").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                std::string name = item.As<Napi::String>().Utf8Value();
+                if (std::find(readerNames.begin(), readerNames.end(), name) == readerNames.end()) {
+                    readerNames.push_back(name);
+                }
+            }
+        }
+        bool watchAll = readerNames.empty();
+
+        // Opsiyonel ayarlar: { onReaderChange(event, readerName), program: Buffer[], programStopOnError, sameUidCooldownMs }
+        Napi::Function readerChangeCallback;
+        std::vector<std::vector<SCardByte>> program;
+        bool programStopOnError = false;
+        std::chrono::milliseconds sameUidCooldown(0);
+        size_t queueSize = kDefaultEventQueueSize;
+        bool blockWhenFull = false;
+        bool binaryUid = false;
+        if (info.Length() > 3 && !info[3].IsUndefined() && !info[3].IsNull()) {
+            if (!info[3].IsObject()) {
+                Napi::TypeError::New(env, "Options must be an object.").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            Napi::Object options = info[3].As<Napi::Object>();
+            Napi::Value onReaderChange = options.Get("onReaderChange");
+            if (onReaderChange.IsFunction()) {
+                readerChangeCallback = onReaderChange.As<Napi::Function>();
+            } else if (!onReaderChange.IsUndefined()) {
+                Napi::TypeError::New(env, "options.onReaderChange must be a function.").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            Napi::Value programValue = options.Get("program");
+            if (programValue.IsArray()) {
+                Napi::Array programArray = programValue.As<Napi::Array>();
+                for (uint32_t i = 0; i < programArray.Length(); i++) {
+                    Napi::Value item = programArray.Get(i);
+                    if (!item.IsBuffer()) {
+                        Napi::TypeError::New(env, "Every APDU in options.program must be a Buffer.").ThrowAsJavaScriptException();
+                        return env.Null();
+                    }
+                    Napi::Buffer<SCardByte> apduBuffer = item.As<Napi::Buffer<SCardByte>>();
+                    program.emplace_back(apduBuffer.Data(), apduBuffer.Data() + apduBuffer.Length());
+                }
+            } else if (!programValue.IsUndefined()) {
+                Napi::TypeError::New(env, "options.program must be an array of Buffers.").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            if (options.Get("programStopOnError").IsBoolean()) {
+                programStopOnError = options.Get("programStopOnError").As<Napi::Boolean>().Value();
+            }
+            if (options.Get("sameUidCooldownMs").IsNumber()) {
+                sameUidCooldown = std::chrono::milliseconds(std::max<int64_t>(0, options.Get("sameUidCooldownMs").As<Napi::Number>().Int64Value()));
+            }
+            if (options.Get("queueSize").IsNumber()) {
+                int64_t requested = options.Get("queueSize").As<Napi::Number>().Int64Value();
+                queueSize = static_cast<size_t>(std::min<int64_t>(std::max<int64_t>(requested, 2), 65536));
+            }
+            Napi::Value overflow = options.Get("overflow");
+            if (overflow.IsString()) {
+                std::string policy = overflow.As<Napi::String>().Utf8Value();
+                if (policy == "block") {
+                    blockWhenFull = true;
+                } else if (policy != "drop") {
+                    Napi::TypeError::New(env, "options.overflow must be 'drop' or 'block'.").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+            }
+            Napi::Value uidFormat = options.Get("uidFormat");
+            if (uidFormat.IsString()) {
+                std::string format = uidFormat.As<Napi::String>().Utf8Value();
+                if (format == "buffer") {
+                    binaryUid = true;
+                } else if (format != "hex") {
+                    Napi::TypeError::New(env, "options.uidFormat must be 'hex' or 'buffer'.").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+            }
+        }
+
+        AddonInstance& instance = InstanceFor(env);
+        if (!EnsureContext(instance.listenerContext, &env)) return env.Null(); // Dinleyicinin kendi context'i
+        if (instance.running.load()) {
+            Napi::Error::New(env, "Listener is already active. Call stopListening first.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (instance.pollThread.joinable()) { // Önceki thread bitmemişse bekle (nadiren olmalı)
+            try { instance.pollThread.join(); } catch (...) {}
+        }
+
+        Napi::Function uidCallback = info[1].As<Napi::Function>();
+        Napi::Function errorCallback = info[2].As<Napi::Function>();
+
+        // Olay kuyruğu: tüm callback'ler tek bir TSFN üzerinden, toplu olarak çağrılır
+        auto events = std::make_shared<ListenerEventQueue>(queueSize);
+        events->blockWhenFull = blockWhenFull;
+        events->binaryUid = binaryUid;
+        events->onUid = Napi::Persistent(uidCallback);
+        events->onError = Napi::Persistent(errorCallback);
+        if (!readerChangeCallback.IsEmpty()) {
+            events->onReaderChange = Napi::Persistent(readerChangeCallback);
+        }
+        // Finalizer kuyruğun son referansını tutar; bekleyen olaylar boşaltılana kadar kuyruk yaşar
+        Napi::ThreadSafeFunction tsfnEvents = Napi::ThreadSafeFunction::New(env, uidCallback, "PCSC_Listener_Events", 0, 1,
+            [events](Napi::Env) {});
+        if (!tsfnEvents) {
+            Napi::Error::New(env, "Failed to create ThreadSafeFunction.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        events->dispatcher = tsfnEvents;
+
+        {
+            std::lock_guard<std::mutex> lock(instance.listenerMutex);
+            instance.activeListener = std::make_unique<ListenerInfo>();
+            instance.activeListener->instance = &instance;
+            instance.activeListener->readerNames = readerNames;
+            instance.activeListener->watchAll = watchAll;
+            instance.activeListener->events = events;
+            instance.activeListener->commands = std::make_shared<ListenerCommandQueue>();
+            instance.activeListener->program = std::move(program);
+            instance.activeListener->programStopOnError = programStopOnError;
+            instance.activeListener->sameUidCooldown = sameUidCooldown;
+        }
+
+        instance.running = true;
+        instance.listenerExited = false;
+        try {
+            instance.pollThread = std::thread(PollForCard, &instance);
+        } catch (const std::system_error& e) {
+            instance.running = false;
+            instance.listenerExited = true;
+            tsfnEvents.Abort(); // Abort, Release'i de yapar
+            { std::lock_guard<std::mutex> lock(instance.listenerMutex); instance.activeListener.reset(); }
+            ThrowNapiError(env, "Failed to start listener thread: " + std::string(e.what()));
+            return env.Null();
+        }
+        return env.Null();
+    }
+
+    Napi::Value StopListening(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        AddonInstance& instance = InstanceFor(env);
+        if (!instance.running.load()) return env.Null(); // Zaten çalışmıyor
+
+        StopListenerThread(instance); // Flag'i ayarlar, SCardGetStatusChange'i iptal eder ve bekler
+
+        {
+            std::lock_guard<std::mutex> lock(instance.listenerMutex);
+            instance.activeListener.reset(); // Listener bilgisini temizle
+        }
+        PCSC_LOG(kLogInfo) << "Listener stopped successfully.";
+        return env.Null();
+    }
+
+    // Aktif dinleyicinin olay kuyruğu sayaçları
+    Napi::Value GetListenerStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        AddonInstance& instance = InstanceFor(env);
+        std::shared_ptr<ListenerEventQueue> events;
+        {
+            std::lock_guard<std::mutex> lock(instance.listenerMutex);
+            if (instance.activeListener) events = instance.activeListener->events;
+        }
 
-    std::mutex g_listenerMutex;         // Listener verilerini koruma
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("active", Napi::Boolean::New(env, events && instance.running.load()));
+        result.Set("queueCapacity", Napi::Number::New(env, events ? static_cast<double>(events->ring.Capacity()) : 0));
+        result.Set("queued", Napi::Number::New(env, events ? static_cast<double>(events->ring.Size()) : 0));
+        result.Set("delivered", Napi::Number::New(env, events ? static_cast<double>(events->delivered.load()) : 0));
+        result.Set("dropped", Napi::Number::New(env, events ? static_cast<double>(events->dropped.load()) : 0));
+        return result;
+    }
 
-    // Aktif dinleyici bilgileri
-    struct ListenerInfo {
-        std::string readerName;
-        Napi::ThreadSafeFunction uidCallback;
-        Napi::ThreadSafeFunction errorCallback;
+    // updateListener(): komutu dinleyicinin kuyruğuna ekler, dinleyici context'ini iptal ederek SCardGetStatusChange'i
+    // uyandırır ve komut uygulanana kadar bekler. İptal kalıcı olmadığından (dinleyici o an kart okuyor ya da
+    // SCardGetStatusChange'e henüz girmemiş olabilir) artan aralıklarla yinelenir.
+    class ListenerCommandWorker : public PcscPromiseWorker {
+    public:
+        ListenerCommandWorker(Napi::Env env, Napi::Promise::Deferred deferred, std::shared_ptr<ListenerCommandQueue> queue,
+                              std::shared_ptr<ListenerCommand> command)
+            : PcscPromiseWorker(env, deferred, kListenerQueueKey), queue(std::move(queue)), command(std::move(command)) {}
+
+    protected:
+        void Execute() override {
+            if (!queue->ring.TryPush(command)) {
+                SetError("Listener command queue is full.");
+                return;
+            }
+            AddonInstance& instance = Instance();
+            auto delay = std::chrono::milliseconds(1);
+            while (!command->done.load(std::memory_order_acquire)) {
+                if (queue->closed.load()) {
+                    // Dinleyici kapanırken son boşaltmadan önce eklenmiş olabilir
+                    if (command->done.load(std::memory_order_acquire)) break;
+                    SetError("Listener stopped.");
+                    return;
+                }
+                SCARDCONTEXT context = instance.listenerContext.context;
+                if (context != 0) Backend().Cancel(context);
+                std::this_thread::sleep_for(delay);
+                delay = std::min(delay * 2, std::chrono::milliseconds(64));
+            }
+            if (!command->error.empty()) SetError(command->error);
+        }
+
+        void OnOK() override {
+            deferred.Resolve(Env().Undefined());
+        }
+
+    private:
+        std::shared_ptr<ListenerCommandQueue> queue;
+        std::shared_ptr<ListenerCommand> command;
     };
-    std::unique_ptr<ListenerInfo> g_activeListener = nullptr;
 
-    // === Hata İşleme Yardımcıları ===
+    // Tek isim veya isim dizisi; tekrarlar atılır
+    bool ParseReaderNameList(Napi::Env env, const Napi::Value& value, const char* field, std::vector<std::string>& names) {
+        if (value.IsString()) {
+            names.push_back(value.As<Napi::String>().Utf8Value());
+            return true;
+        }
+        if (!value.IsArray()) {
+            Napi::TypeError::New(env, std::string("changes.") + field + " must be a reader name or an array of reader names.")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+        Napi::Array array = value.As<Napi::Array>();
+        for (uint32_t i = 0; i < array.Length(); i++) {
+            Napi::Value item = array.Get(i);
+            if (!item.IsString()) {
+                Napi::TypeError::New(env, "Reader names must be strings.").ThrowAsJavaScriptException();
+                return false;
+            }
+            std::string name = item.As<Napi::String>().Utf8Value();
+            if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+        }
+        return true;
+    }
 
-    std::string SCardErrorToString(SCardLong rv) {
-        #ifdef _WIN32
-        // Windows'a özel detaylı hata mesajı alma
-        LPSTR errorMsg = nullptr;
-        DWORD flags = FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
-        HMODULE hWinscard = GetModuleHandleA("winscard.dll");
-        if (hWinscard) flags |= FORMAT_MESSAGE_FROM_HMODULE;
-        DWORD len = FormatMessageA(flags, hWinscard, rv, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&errorMsg, 0, NULL);
-        if (len > 0 && errorMsg != nullptr) {
-            std::string result(errorMsg);
-            LocalFree(errorMsg);
-            while (!result.empty() && (result.back() == '\r' || result.back() == '\n')) {
-                result.pop_back();
+    // Çalışan dinleyiciyi durdurmadan günceller:
+    // { add?, remove?, readers?: string[] | null (tüm okuyucular), program?, programStopOnError?, sameUidCooldownMs? }
+    Napi::Value UpdateListener(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Expected a changes object.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object changes = info[0].As<Napi::Object>();
+        auto command = std::make_shared<ListenerCommand>();
+
+        Napi::Value add = changes.Get("add");
+        if (!add.IsUndefined() && !ParseReaderNameList(env, add, "add", command->addReaders)) return env.Null();
+        Napi::Value remove = changes.Get("remove");
+        if (!remove.IsUndefined() && !ParseReaderNameList(env, remove, "remove", command->removeReaders)) return env.Null();
+        Napi::Value readers = changes.Get("readers");
+        if (!readers.IsUndefined()) {
+            command->setReaders = true;
+            if (!readers.IsNull() && !ParseReaderNameList(env, readers, "readers", command->readers)) return env.Null();
+        }
+        Napi::Value programValue = changes.Get("program");
+        if (programValue.IsArray()) {
+            command->setProgram = true;
+            Napi::Array programArray = programValue.As<Napi::Array>();
+            for (uint32_t i = 0; i < programArray.Length(); i++) {
+                Napi::Value item = programArray.Get(i);
+                if (!item.IsBuffer()) {
+                    Napi::TypeError::New(env, "Every APDU in changes.program must be a Buffer.").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                Napi::Buffer<SCardByte> apduBuffer = item.As<Napi::Buffer<SCardByte>>();
+                command->program.emplace_back(apduBuffer.Data(), apduBuffer.Data() + apduBuffer.Length());
             }
-            // Hata kodunu da ekle
-            std::stringstream ss;
-            ss << result << " (0x" << std::hex << std::uppercase << rv << ")";
-            return ss.str();
+        } else if (programValue.IsNull()) {
+            command->setProgram = true; // Programı kaldır
+        } else if (!programValue.IsUndefined()) {
+            Napi::TypeError::New(env, "changes.program must be an array of Buffers.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (changes.Get("programStopOnError").IsBoolean()) {
+            command->setProgramStopOnError = true;
+            command->programStopOnError = changes.Get("programStopOnError").As<Napi::Boolean>().Value();
+        }
+        if (changes.Get("sameUidCooldownMs").IsNumber()) {
+            command->setSameUidCooldown = true;
+            command->sameUidCooldown = std::chrono::milliseconds(
+                std::max<int64_t>(0, changes.Get("sameUidCooldownMs").As<Napi::Number>().Int64Value()));
         }
-        #else
-        // PCSC-lite için (pcsc_stringify_error kullanılabilir ama kütüphaneye bağlı)
-        // Şimdilik sadece hex kodu döndürelim
-        // const char* pcscError = pcsc_stringify_error(rv); // Eğer PCSC kütüphanesi linklenmişse
-        // if (pcscError) return std::string(pcscError) + " (0x" + ... + ")";
-        #endif
 
-        // Genel veya Windows'ta mesaj bulunamayan durum
-        std::stringstream ss;
-        ss << "PC/SC Error Code: 0x" << std::hex << std::uppercase << rv;
-        return ss.str();
+        AddonInstance& instance = InstanceFor(env);
+        std::shared_ptr<ListenerCommandQueue> queue;
+        {
+            std::lock_guard<std::mutex> lock(instance.listenerMutex);
+            if (instance.activeListener) queue = instance.activeListener->commands;
+        }
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (!queue || !instance.running.load() || queue->closed.load()) {
+            deferred.Reject(Napi::Error::New(env, "Listener is not active.").Value());
+            return deferred.Promise();
+        }
+        (new ListenerCommandWorker(env, deferred, queue, command))->Queue();
+        return deferred.Promise();
     }
 
-    void ThrowNapiError(const Napi::Env& env, const std::string& message, SCardLong rv = 0) {
-        std::string fullMessage = message;
-        if (rv != 0) {
-            fullMessage += " (" + SCardErrorToString(rv) + ")";
-        }
-        Napi::Error::New(env, fullMessage).ThrowAsJavaScriptException();
+    Napi::Object HistogramToObject(Napi::Env env, const LatencyHistogram& histogram, uint64_t errors) {
+        Napi::Object result = Napi::Object::New(env);
+        uint64_t count = histogram.Count();
+        result.Set("count", Napi::Number::New(env, static_cast<double>(count)));
+        result.Set("errors", Napi::Number::New(env, static_cast<double>(errors)));
+        result.Set("meanUs", Napi::Number::New(env, count ? static_cast<double>(histogram.Sum()) / count : 0));
+        result.Set("p50Us", Napi::Number::New(env, static_cast<double>(histogram.Percentile(50))));
+        result.Set("p90Us", Napi::Number::New(env, static_cast<double>(histogram.Percentile(90))));
+        result.Set("p99Us", Napi::Number::New(env, static_cast<double>(histogram.Percentile(99))));
+        result.Set("p999Us", Napi::Number::New(env, static_cast<double>(histogram.Percentile(99.9))));
+        result.Set("maxUs", Napi::Number::New(env, static_cast<double>(histogram.Max())));
+        return result;
     }
 
-    // === Context Yönetimi ===
+    // Ölçümlerin anlık görüntüsü: okuyucu/işlem başına gecikme dağılımları, hata kodu sayaçları
+    Napi::Value GetStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("uptimeMs", Napi::Number::New(env, static_cast<double>(MicrosSince(g_statsSince) / 1000)));
 
-    bool EnsureContext(const Napi::Env* env = nullptr) {
-         // Çok basit kontrol: Zaten varsa geçerli kabul et.
-         // Daha sağlam bir çözüm: SCardIsValidContext kullanmak veya hata durumunda yeniden denemek.
-        if (g_context != 0) {
-            return true;
+        std::lock_guard<std::mutex> lock(g_statsMutex);
+        Napi::Object readers = Napi::Object::New(env);
+        for (const auto& entry : g_readerStats) {
+            Napi::Object ops = Napi::Object::New(env);
+            for (int op = 0; op < kOpCount; op++) {
+                ops.Set(kOpNames[op], HistogramToObject(env, entry.second->latency[op],
+                                                        entry.second->errors[op].load(std::memory_order_relaxed)));
+            }
+            readers.Set(entry.first, ops);
         }
+        result.Set("readers", readers);
 
-        SCardLong rv = SCardEstablishContext(SCARD_SCOPE_SYSTEM, NULL, NULL, &g_context);
-        if (rv != SCARD_S_SUCCESS) {
-            g_context = 0;
-            std::cerr << "ERROR: Failed to establish PC/SC context! " << SCardErrorToString(rv) << std::endl;
-            if (env) {
-                ThrowNapiError(*env, "Failed to establish PC/SC context", rv);
+        Napi::Object statusChange = Napi::Object::New(env);
+        statusChange.Set("wakeups", Napi::Number::New(env, static_cast<double>(g_statusChangeWakeups.load())));
+        statusChange.Set("timeouts", Napi::Number::New(env, static_cast<double>(g_statusChangeTimeouts.load())));
+        statusChange.Set("cancels", Napi::Number::New(env, static_cast<double>(g_statusChangeCancels.load())));
+        result.Set("statusChange", statusChange);
+
+        Napi::Object errors = Napi::Object::New(env);
+        for (const auto& entry : g_errorCounts) {
+            char code[16];
+            snprintf(code, sizeof(code), "0x%08X", static_cast<unsigned int>(entry.first));
+            errors.Set(code, Napi::Number::New(env, static_cast<double>(entry.second)));
+        }
+        result.Set("errors", errors);
+
+        Napi::Object atrCache = Napi::Object::New(env);
+        atrCache.Set("hits", Napi::Number::New(env, static_cast<double>(g_atrCacheHits.load())));
+        atrCache.Set("misses", Napi::Number::New(env, static_cast<double>(g_atrCacheMisses.load())));
+        result.Set("atrCache", atrCache);
+
+        Napi::Object logging = Napi::Object::New(env);
+        logging.Set("level", Napi::String::New(env, kLogLevelNames[g_logLevel.load()]));
+        logging.Set("records", Napi::Number::New(env, static_cast<double>(g_logRecords.load())));
+        logging.Set("dropped", Napi::Number::New(env, static_cast<double>(g_logDropped.load())));
+        uint64_t sinkDropped = 0;
+        {
+            std::lock_guard<std::mutex> sinksLock(g_logSinksMutex);
+            for (const auto& sink : g_logSinks) {
+                if (sink->owner == &InstanceFor(env)) sinkDropped = sink->dropped.load();
             }
-            return false;
         }
-        std::cout << "INFO: PC/SC context established successfully." << std::endl;
-        return true;
+        logging.Set("sinkDropped", Napi::Number::New(env, static_cast<double>(sinkDropped)));
+        result.Set("logging", logging);
+        return result;
     }
 
-    void CleanupContext(void* /*arg*/) {
-        std::cout << "INFO: Cleaning up PC/SC context..." << std::endl;
-        // Çalışan listener'ı durdur
-        if (g_running.load()) {
-            g_running = false;
-            if (g_context != 0) {
-                 // SCardCancel bloke edici SCardGetStatusChange'i iptal eder.
-                 // Bu, context serbest bırakılmadan çağrılmalı.
-                 SCardCancel(g_context);
-            }
-            if (g_pollThread.joinable()) {
-                try { g_pollThread.join(); } catch(...) { /* Ignore errors on cleanup */ }
+    // Tüm ölçümleri sıfırlar (okuyucu kayıtları korunur, işaretçiler geçerli kalır)
+    Napi::Value ResetStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        std::lock_guard<std::mutex> lock(g_statsMutex);
+        for (auto& entry : g_readerStats) {
+            for (int op = 0; op < kOpCount; op++) {
+                entry.second->latency[op].Reset();
+                entry.second->errors[op].store(0, std::memory_order_relaxed);
             }
         }
-         // Listener bilgisini temizle
+        g_errorCounts.clear();
+        g_statusChangeWakeups = 0;
+        g_statusChangeTimeouts = 0;
+        g_statusChangeCancels = 0;
+        g_atrCacheHits = 0;
+        g_atrCacheMisses = 0;
+        g_logRecords = 0;
+        g_logDropped = 0;
         {
-            std::lock_guard<std::mutex> lock(g_listenerMutex);
-            if (g_activeListener) {
-                g_activeListener.reset(); // unique_ptr temizler
+            std::lock_guard<std::mutex> sinksLock(g_logSinksMutex);
+            for (const auto& sink : g_logSinks) sink->dropped = 0;
+        }
+        g_statsSince = std::chrono::steady_clock::now();
+        return env.Undefined();
+    }
+
+    // Günlük ayarları (süreç geneli; sink ortama aittir): { level?, console?, sink?: function | null }
+    Napi::Value ConfigureLogging(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Expected an options object.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object options = info[0].As<Napi::Object>();
+
+        int level = -1;
+        Napi::Value levelValue = options.Get("level");
+        if (levelValue.IsString()) {
+            std::string name = levelValue.As<Napi::String>().Utf8Value();
+            for (int i = kLogOff; i <= kLogDebug; i++) {
+                if (name == kLogLevelNames[i]) level = i;
             }
         }
-        // Context'i serbest bırak
-        if (g_context != 0) {
-            SCardReleaseContext(g_context);
-            g_context = 0;
-            std::cout << "INFO: PC/SC context released successfully." << std::endl;
+        if (!levelValue.IsUndefined() && level < 0) {
+            Napi::TypeError::New(env, "options.level must be 'off', 'error', 'warn', 'info' or 'debug'.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Value consoleValue = options.Get("console");
+        if (!consoleValue.IsUndefined() && !consoleValue.IsBoolean()) {
+            Napi::TypeError::New(env, "options.console must be a boolean.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Value sinkValue = options.Get("sink");
+        if (!sinkValue.IsUndefined() && !sinkValue.IsNull() && !sinkValue.IsFunction()) {
+            Napi::TypeError::New(env, "options.sink must be a function or null.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        AddonInstance& instance = InstanceFor(env);
+        if (sinkValue.IsFunction()) {
+            auto sink = std::make_shared<LogSink>();
+            sink->owner = &instance;
+            sink->callback = Napi::Persistent(sinkValue.As<Napi::Function>());
+            // Finalizer sink'in son referansını tutar; FunctionReference JS thread'inde silinir
+            sink->dispatcher = Napi::ThreadSafeFunction::New(env, sinkValue.As<Napi::Function>(), "PCSC_Log_Sink", 0, 1,
+                [sink](Napi::Env) {});
+            if (!sink->dispatcher) {
+                Napi::Error::New(env, "Failed to create ThreadSafeFunction.").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            sink->dispatcher.Unref(env); // Günlük sink'i event loop'u canlı tutmaz
+            RemoveLogSink(&instance);
+            std::lock_guard<std::mutex> lock(g_logSinksMutex);
+            g_logSinks.push_back(sink);
+        } else if (sinkValue.IsNull()) {
+            RemoveLogSink(&instance);
         }
+        if (level >= 0) g_logLevel.store(level);
+        if (consoleValue.IsBoolean()) g_logConsole.store(consoleValue.As<Napi::Boolean>().Value());
+        return env.Null();
     }
 
-    // === Platforma Bağımlı PCI İşaretçileri ===
-    // SCardTransmit'te SCARD_IO_REQUEST yerine bunları kullanmak daha taşınabilir
-    const SCARD_IO_REQUEST* GetPci(SCardDword protocol) {
-        switch (protocol) {
-            case SCARD_PROTOCOL_T0:
-                return SCARD_PCI_T0;
-            case SCARD_PROTOCOL_T1:
-                return SCARD_PCI_T1;
-            // case SCARD_PROTOCOL_RAW: // Gerekirse eklenebilir
-            //     return SCARD_PCI_RAW;
-            default:
-                // Desteklenmeyen veya bilinmeyen protokol için null dönmek güvenli olabilir
-                // veya T1'i varsayalım (daha modern)
-                std::cerr << "WARN: Unknown or unsupported protocol " << protocol << ", using T1 PCI." << std::endl;
-                return SCARD_PCI_T1;
+    Napi::Value TransmitAPDU(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsBuffer()) {
+             Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string), apdu (Buffer)").Value());
+             return deferred.Promise();
+        }
+        if (!EnsureContext(InstanceFor(env).mainContext, &env)) {
+             Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+             deferred.Reject(Napi::Error::New(env, "PC/SC context not established or invalid.").Value());
+             return deferred.Promise();
         }
+
+        std::string readerName = info[0].As<Napi::String>().Utf8Value();
+        Napi::Buffer<SCardByte> apduNapiBuffer = info[1].As<Napi::Buffer<SCardByte>>();
+
+        // Buffer verisini std::vector'e kopyala
+        std::vector<SCardByte> apduToSend(apduNapiBuffer.Data(), apduNapiBuffer.Data() + apduNapiBuffer.Length());
+
+        // Ayarlar: { chaining: false, commandChaining: false }
+        ChainingOptions chaining;
+        if (info.Length() > 2 && info[2].IsObject()) ReadChainingOptions(info[2].As<Napi::Object>(), chaining);
+
+        // İşi okuyucunun kuyruğuna ekle ve Promise'i döndür
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        TransmitWorker* worker = new TransmitWorker(env, deferred, readerName, apduToSend, chaining);
+        worker->Queue();
+        return deferred.Promise();
     }
 
+    Napi::Value OpenSession(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !info[0].IsString()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string)").Value());
+             return deferred.Promise();
+        }
+        if (!EnsureContext(InstanceFor(env).mainContext, &env)) {
+             deferred.Reject(Napi::Error::New(env, "PC/SC context not established or invalid.").Value());
+             return deferred.Promise();
+        }
 
-    // === APDU Transmit Worker (Asenkron İşlem) ===
+        std::string readerName = info[0].As<Napi::String>().Utf8Value();
+        OpenSessionWorker* worker = new OpenSessionWorker(env, deferred, readerName);
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-    class TransmitWorker : public Napi::AsyncWorker {
-    public:
-        TransmitWorker(Napi::Env env,
-                       Napi::Promise::Deferred deferred,
-                       const std::string& readerName,
-                       const std::vector<SCardByte>& apduToSend)
-            : Napi::AsyncWorker(env),
-              deferred(deferred),
-              readerName(readerName),
-              apduToSend(apduToSend),
-              responseApdu(),
-              lastRv(SCARD_S_SUCCESS) {}
+    Napi::Value SessionTransmit(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBuffer()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: sessionId (number), apdu (Buffer)").Value());
+             return deferred.Promise();
+        }
 
-        ~TransmitWorker() override {} // Sanal yıkıcı
+        std::shared_ptr<CardSession> session = FindSession(InstanceFor(env), info[0].As<Napi::Number>().Uint32Value());
+        if (!session) {
+             deferred.Reject(Napi::Error::New(env, "Unknown or closed session.").Value());
+             return deferred.Promise();
+        }
 
-    protected:
-        // Arka plan thread'inde çalışır
-        void Execute() override {
-            if (!EnsureContext()) {
-                lastRv = SCARD_E_INVALID_HANDLE; // Veya uygun PCSC-lite kodu
-                SetError("PC/SC context not established or invalid.");
-                return;
+        Napi::Buffer<SCardByte> apduNapiBuffer = info[1].As<Napi::Buffer<SCardByte>>();
+        std::vector<SCardByte> apduToSend(apduNapiBuffer.Data(), apduNapiBuffer.Data() + apduNapiBuffer.Length());
+
+        ChainingOptions chaining;
+        if (info.Length() > 2 && info[2].IsObject()) ReadChainingOptions(info[2].As<Napi::Object>(), chaining);
+
+        SessionTransmitWorker* worker = new SessionTransmitWorker(env, deferred, session, apduToSend, chaining);
+        worker->Queue();
+        return deferred.Promise();
+    }
+
+    Napi::Value CloseSession(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: sessionId (number)").Value());
+             return deferred.Promise();
+        }
+
+        // Oturumu hemen listeden çıkar; sonraki transmit çağrıları reddedilir
+        AddonInstance& instance = InstanceFor(env);
+        std::shared_ptr<CardSession> session;
+        {
+            std::lock_guard<std::mutex> lock(instance.sessionsMutex);
+            auto it = instance.sessions.find(info[0].As<Napi::Number>().Uint32Value());
+            if (it != instance.sessions.end()) {
+                session = it->second;
+                instance.sessions.erase(it);
             }
+        }
+        if (!session) {
+             deferred.Resolve(env.Undefined()); // Zaten kapalı
+             return deferred.Promise();
+        }
 
-            SCARDHANDLE hCard = 0;
-            SCardDword dwActiveProtocol = 0;
+        CloseSessionWorker* worker = new CloseSessionWorker(env, deferred, session);
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-            // Karta bağlan (SCARD_SHARE_SHARED en yaygın)
-            lastRv = SCardConnect(g_context, readerName.c_str(), SCARD_SHARE_SHARED,
-                                  SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1,
-                                  &hCard, &dwActiveProtocol);
+    Napi::Value TransmitBatch(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 2 || !(info[0].IsString() || info[0].IsNumber()) || !info[1].IsArray()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string) or sessionId (number), apdus (Buffer[]), [options (object)]").Value());
+             return deferred.Promise();
+        }
 
-            if (lastRv != SCARD_S_SUCCESS) {
-                SetError("Failed to connect to card in reader: " + readerName);
-                return;
+        // APDU listesini kopyala
+        Napi::Array apduArray = info[1].As<Napi::Array>();
+        std::vector<std::vector<SCardByte>> apdus;
+        apdus.reserve(apduArray.Length());
+        for (uint32_t i = 0; i < apduArray.Length(); i++) {
+            Napi::Value item = apduArray.Get(i);
+            if (!item.IsBuffer()) {
+                deferred.Reject(Napi::TypeError::New(env, "Every APDU must be a Buffer.").Value());
+                return deferred.Promise();
             }
+            Napi::Buffer<SCardByte> apduBuffer = item.As<Napi::Buffer<SCardByte>>();
+            apdus.emplace_back(apduBuffer.Data(), apduBuffer.Data() + apduBuffer.Length());
+        }
 
-            // RAII Guard ile bağlantının kesilmesini garanti et
-            struct CardConnectionGuard {
-                SCARDHANDLE& handleRef;
-                CardConnectionGuard(SCARDHANDLE& h) : handleRef(h) {}
-                ~CardConnectionGuard() {
-                    if (handleRef != 0) {
-                        SCardDisconnect(handleRef, SCARD_LEAVE_CARD);
-                        handleRef = 0;
+        // Ayarlar: { stopOnError: false, chaining: true, commandChaining: false }
+        bool stopOnError = false;
+        ChainingOptions chaining;
+        chaining.responses = true;
+        if (info.Length() > 2 && info[2].IsObject()) {
+            Napi::Object options = info[2].As<Napi::Object>();
+            if (options.Get("stopOnError").IsBoolean()) stopOnError = options.Get("stopOnError").As<Napi::Boolean>().Value();
+            ReadChainingOptions(options, chaining);
+        }
+
+        std::string readerName;
+        std::shared_ptr<CardSession> session;
+        if (info[0].IsNumber()) {
+            session = FindSession(InstanceFor(env), info[0].As<Napi::Number>().Uint32Value());
+            if (!session) {
+                deferred.Reject(Napi::Error::New(env, "Unknown or closed session.").Value());
+                return deferred.Promise();
+            }
+        } else {
+            readerName = info[0].As<Napi::String>().Utf8Value();
+            if (!EnsureContext(InstanceFor(env).mainContext, &env)) {
+                deferred.Reject(Napi::Error::New(env, "PC/SC context not established or invalid.").Value());
+                return deferred.Promise();
+            }
+        }
+
+        TransmitBatchWorker* worker = new TransmitBatchWorker(env, deferred, readerName, session, std::move(apdus), stopOnError, chaining);
+        worker->Queue();
+        return deferred.Promise();
+    }
+
+    // readMemory(readerName | sessionId, { start?, count? }, keys?): MIFARE Classic / Ultralight belleğini tek Buffer olarak okur
+    Napi::Value ReadMemory(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !(info[0].IsString() || info[0].IsNumber())
+                || (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsObject())
+                || (info.Length() > 2 && !info[2].IsUndefined() && !info[2].IsArray())) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string) or sessionId (number), [range ({ start?, count? })], [keys (Array)]").Value());
+             return deferred.Promise();
+        }
+
+        // Aralık: Classic için 16 baytlık blok, Ultralight / NTAG için 4 baytlık sayfa numaraları
+        uint32_t start = 0;
+        uint32_t count = 0;
+        if (info.Length() > 1 && info[1].IsObject()) {
+            Napi::Object range = info[1].As<Napi::Object>();
+            if (range.Get("start").IsNumber()) start = range.Get("start").As<Napi::Number>().Uint32Value();
+            if (range.Get("count").IsNumber()) count = range.Get("count").As<Napi::Number>().Uint32Value();
+        }
+
+        // Anahtarlar: Buffer (Key A) veya { key: Buffer, type: 'A' | 'B' }; verilmezse FFFFFFFFFFFF / Key A
+        std::vector<MifareKey> keys;
+        if (info.Length() > 2 && info[2].IsArray()) {
+            Napi::Array keyArray = info[2].As<Napi::Array>();
+            for (uint32_t i = 0; i < keyArray.Length(); i++) {
+                Napi::Value item = keyArray.Get(i);
+                Napi::Value keyValue = item.IsObject() && !item.IsBuffer() ? item.As<Napi::Object>().Get("key") : item;
+                if (!keyValue.IsBuffer() || keyValue.As<Napi::Buffer<SCardByte>>().Length() != 6) {
+                    deferred.Reject(Napi::TypeError::New(env, "keys[" + std::to_string(i) + "] must be a 6-byte Buffer or { key: Buffer, type: 'A' | 'B' }.").Value());
+                    return deferred.Promise();
+                }
+                MifareKey key;
+                memcpy(key.key, keyValue.As<Napi::Buffer<SCardByte>>().Data(), sizeof(key.key));
+                if (item.IsObject() && !item.IsBuffer() && item.As<Napi::Object>().Get("type").IsString()) {
+                    std::string keyType = item.As<Napi::Object>().Get("type").As<Napi::String>().Utf8Value();
+                    if (keyType == "B") {
+                        key.type = 0x61;
+                    } else if (keyType != "A") {
+                        deferred.Reject(Napi::TypeError::New(env, "keys[" + std::to_string(i) + "].type must be 'A' or 'B'.").Value());
+                        return deferred.Promise();
                     }
                 }
-            } guard(hCard);
+                keys.push_back(key);
+            }
+        }
+        if (keys.empty()) keys.push_back(MifareKey());
 
-            // Platforma uygun PCI yapısını al
-            const SCARD_IO_REQUEST* pci = GetPci(dwActiveProtocol);
-            if (!pci) {
-                 // Bu durum aslında GetPci içinde handle ediliyor ama yine de kontrol
-                 lastRv = SCARD_E_PROTO_MISMATCH; // Veya uygun hata
-                 SetError("Failed to get valid PCI structure for the active protocol.");
-                 return;
+        std::string readerName;
+        std::shared_ptr<CardSession> session;
+        if (info[0].IsNumber()) {
+            session = FindSession(InstanceFor(env), info[0].As<Napi::Number>().Uint32Value());
+            if (!session) {
+                deferred.Reject(Napi::Error::New(env, "Unknown or closed session.").Value());
+                return deferred.Promise();
             }
+        } else {
+            readerName = info[0].As<Napi::String>().Utf8Value();
+        }
 
-            // Yanıt buffer'ını hazırla (256 veri + 2 SW = 258, 260 makul bir boyut)
-            responseApdu.resize(260); // std::vector<SCardByte>
-            SCardDword dwRecvLength = static_cast<SCardDword>(responseApdu.size());
+        ReadMemoryWorker* worker = new ReadMemoryWorker(env, deferred, readerName, session, start, count, std::move(keys));
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-            // APDU'yu gönder
-            lastRv = SCardTransmit(hCard, pci, apduToSend.data(), (SCardDword)apduToSend.size(),
-                                   nullptr, // Yanıt için ek IO isteği yok
-                                   responseApdu.data(), &dwRecvLength);
+    bool ParseCommMode(const Napi::Value& value, DesfireCommMode& mode) {
+        if (value.IsUndefined()) return true;
+        std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+        if (name == "plain") mode = kCommPlain;
+        else if (name == "mac") mode = kCommMac;
+        else if (name == "full") mode = kCommFull;
+        else return false;
+        return true;
+    }
 
-            if (lastRv != SCARD_S_SUCCESS) {
-                SetError("APDU transmit/receive failed");
-                // Guard bağlantıyı kesecek
-                return;
-            }
+    // desfire(readerName | sessionId, { aid?, keyNo?, key?, command?, header?, data?, commMode?, responseMode? }):
+    // uygulama seçimi, AuthenticateEV2First ve güvenli mesajlaşmalı bir komut tek native çağrıda
+    Napi::Value Desfire(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 2 || !(info[0].IsString() || info[0].IsNumber()) || !info[1].IsObject()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string) or sessionId (number), request (object)").Value());
+             return deferred.Promise();
+        }
+        Napi::Object options = info[1].As<Napi::Object>();
+        DesfireRequest request;
+        auto reject = [&](const char* message) {
+            deferred.Reject(Napi::TypeError::New(env, message).Value());
+            return deferred.Promise();
+        };
 
-            // Alınan verinin gerçek boyutuna küçült
-            responseApdu.resize(dwRecvLength);
-            // Guard bağlantıyı kesecek
+        Napi::Value aid = options.Get("aid");
+        if (aid.IsNumber()) {
+            uint32_t value = aid.As<Napi::Number>().Uint32Value();
+            if (value > 0xFFFFFF) return reject("Option 'aid' must be a 3-byte number or Buffer");
+            // AID kartta little-endian gönderilir
+            request.aid[0] = static_cast<SCardByte>(value);
+            request.aid[1] = static_cast<SCardByte>(value >> 8);
+            request.aid[2] = static_cast<SCardByte>(value >> 16);
+            request.selectApplication = true;
+        } else if (aid.IsBuffer()) {
+            if (aid.As<Napi::Buffer<SCardByte>>().Length() != 3) return reject("Option 'aid' must be a 3-byte number or Buffer");
+            memcpy(request.aid, aid.As<Napi::Buffer<SCardByte>>().Data(), 3);
+            request.selectApplication = true;
+        } else if (!aid.IsUndefined()) {
+            return reject("Option 'aid' must be a 3-byte number or Buffer");
         }
 
-        // Ana thread'de çalışır (başarılıysa)
-        void OnOK() override {
-            Napi::Env env = Env();
-            // Yanıtı Napi::Buffer olarak kopyala
-            Napi::Buffer<SCardByte> resultBuffer = Napi::Buffer<SCardByte>::Copy(env, responseApdu.data(), responseApdu.size());
-            deferred.Resolve(resultBuffer);
+        Napi::Value key = options.Get("key");
+        if (!key.IsUndefined()) {
+            if (!key.IsBuffer() || key.As<Napi::Buffer<SCardByte>>().Length() != kAesBlockSize) {
+                return reject("Option 'key' must be a 16-byte AES key Buffer");
+            }
+            memcpy(request.key, key.As<Napi::Buffer<SCardByte>>().Data(), kAesBlockSize);
+            Napi::Value keyNo = options.Get("keyNo");
+            request.keyNo = keyNo.IsNumber() ? static_cast<SCardByte>(keyNo.As<Napi::Number>().Uint32Value()) : 0;
+            request.authenticate = true;
         }
 
-        // Ana thread'de çalışır (hatalıysa)
-        void OnError(const Napi::Error& e) override {
-            Napi::Env env = Env();
-            std::string errorMessage = e.Message();
-            // PC/SC hata kodunu ekle (eğer set edilmişse)
-            if (lastRv != SCARD_S_SUCCESS) {
-                errorMessage += " (" + SCardErrorToString(lastRv) + ")";
+        Napi::Value command = options.Get("command");
+        if (command.IsNumber()) {
+            request.command = static_cast<SCardByte>(command.As<Napi::Number>().Uint32Value());
+            request.hasCommand = true;
+            Napi::Value header = options.Get("header");
+            Napi::Value data = options.Get("data");
+            if ((!header.IsUndefined() && !header.IsBuffer()) || (!data.IsUndefined() && !data.IsBuffer())) {
+                return reject("Options 'header' and 'data' must be Buffers");
             }
-            deferred.Reject(Napi::Error::New(env, errorMessage).Value());
+            if (header.IsBuffer()) {
+                Napi::Buffer<SCardByte> buffer = header.As<Napi::Buffer<SCardByte>>();
+                request.header.assign(buffer.Data(), buffer.Data() + buffer.Length());
+            }
+            if (data.IsBuffer()) {
+                Napi::Buffer<SCardByte> buffer = data.As<Napi::Buffer<SCardByte>>();
+                request.data.assign(buffer.Data(), buffer.Data() + buffer.Length());
+            }
+            if (!ParseCommMode(options.Get("commMode"), request.commandMode)) {
+                return reject("Option 'commMode' must be 'plain', 'mac' or 'full'");
+            }
+            request.responseMode = request.commandMode;
+            if (!ParseCommMode(options.Get("responseMode"), request.responseMode)) {
+                return reject("Option 'responseMode' must be 'plain', 'mac' or 'full'");
+            }
+            if (DesfireFrameLength(request.header.size(), request.data.size(), request.commandMode, true) > kDesfireMaxFrameData) {
+                return reject("DESFire command header and data do not fit in a single frame");
+            }
+        } else if (!command.IsUndefined()) {
+            return reject("Option 'command' must be a number");
         }
 
-    private:
-        Napi::Promise::Deferred deferred;
         std::string readerName;
-        std::vector<SCardByte> apduToSend;
-        std::vector<SCardByte> responseApdu; // Alınan yanıt
-        SCardLong lastRv; // Son PC/SC hata kodu
-    };
+        std::shared_ptr<CardSession> session;
+        if (info[0].IsNumber()) {
+            session = FindSession(InstanceFor(env), info[0].As<Napi::Number>().Uint32Value());
+            if (!session) {
+                deferred.Reject(Napi::Error::New(env, "Unknown or closed session.").Value());
+                return deferred.Promise();
+            }
+        } else {
+            readerName = info[0].As<Napi::String>().Utf8Value();
+        }
 
+        DesfireWorker* worker = new DesfireWorker(env, deferred, readerName, session, request);
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-    // === Kart Dinleme İş Parçacığı ===
+    // control(readerName, controlCode | featureName, data?): SCardControl; özellik adı önbellekteki tablodan çözülür
+    Napi::Value Control(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 2 || !info[0].IsString() || !(info[1].IsNumber() || info[1].IsString())
+                || (info.Length() > 2 && !info[2].IsUndefined() && !info[2].IsNull() && !info[2].IsBuffer())) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string), controlCode (number) or featureName (string), [data (Buffer)]").Value());
+             return deferred.Promise();
+        }
 
-    void PollForCard() {
-        std::unique_ptr<ListenerInfo> listener;
-        // Dinleyici bilgilerini güvenli kopyala
-        {
-            std::lock_guard<std::mutex> lock(g_listenerMutex);
-            if (!g_activeListener || !g_activeListener->uidCallback || !g_activeListener->errorCallback) {
-                 std::cerr << "ERROR: PollForCard started without a valid listener." << std::endl;
-                 return;
+        SCardDword controlCode = 0;
+        int featureTag = -1;
+        if (info[1].IsNumber()) {
+            controlCode = info[1].As<Napi::Number>().Uint32Value();
+        } else {
+            std::string featureName = info[1].As<Napi::String>().Utf8Value();
+            for (size_t tag = 1; tag < kReaderFeatureCount; tag++) {
+                if (featureName == kReaderFeatureNames[tag]) featureTag = static_cast<int>(tag);
+            }
+            if (featureTag < 0) {
+                deferred.Reject(Napi::TypeError::New(env, "Unknown reader feature '" + featureName + "'.").Value());
+                return deferred.Promise();
             }
-            // Kopyasını oluştur
-            listener = std::make_unique<ListenerInfo>();
-            listener->readerName = g_activeListener->readerName;
-            listener->uidCallback = g_activeListener->uidCallback;
-            listener->errorCallback = g_activeListener->errorCallback;
         }
 
-        std::cout << "INFO: Listening for cards on reader: '" << listener->readerName << "'" << std::endl;
+        std::vector<SCardByte> input;
+        if (info.Length() > 2 && info[2].IsBuffer()) {
+            Napi::Buffer<SCardByte> data = info[2].As<Napi::Buffer<SCardByte>>();
+            input.assign(data.Data(), data.Data() + data.Length());
+        }
 
-        // Platforma uygun SCARD_READERSTATE yapısı
-        #ifdef _WIN32
-            SCARD_READERSTATEA readerState; // ANSI version for char*
-        #else
-            SCARD_READERSTATE readerState;  // PCSC-lite standard version
-        #endif
-        memset(&readerState, 0, sizeof(readerState));
-        readerState.szReader = listener->readerName.c_str();
-        readerState.dwCurrentState = SCARD_STATE_UNAWARE; // Başlangıç durumu
+        std::string readerName = info[0].As<Napi::String>().Utf8Value();
+        ControlWorker* worker = new ControlWorker(env, deferred, readerName, controlCode, featureTag, std::move(input));
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-        while (g_running.load()) {
-            // Platforma uygun SCardGetStatusChange çağrısı
-            #ifdef _WIN32
-                SCardLong rv = SCardGetStatusChangeA(g_context, 1000, &readerState, 1); // 1 saniye timeout
-            #else
-                // PCSC-lite timeout ms değil, özel değerler veya sonsuz olabilir.
-                // INFINITE genellikle tanımsız olabilir, uzun bir timeout kullanalım.
-                // Veya SCardCancel'e güvenelim. 1000ms = 1 saniye.
-                SCardLong rv = SCardGetStatusChange(g_context, 1000, &readerState, 1);
-            #endif
+    // getAttribute(readerName, attrId): SCardGetAttrib; değer ham Buffer olarak döner
+    Napi::Value GetAttribute(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string), attrId (number)").Value());
+             return deferred.Promise();
+        }
+        std::string readerName = info[0].As<Napi::String>().Utf8Value();
+        GetAttribWorker* worker = new GetAttribWorker(env, deferred, readerName, info[1].As<Napi::Number>().Uint32Value());
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-            if (!g_running.load()) break; // Cancel sonrası kontrol
+    // getReaderFeatures(readerName): { özellikAdı: kontrolKodu }; okuyucu başına bir kez sorgulanır
+    Napi::Value GetReaderFeatures(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !info[0].IsString()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameter expected: readerName (string)").Value());
+             return deferred.Promise();
+        }
+        ReaderFeaturesWorker* worker = new ReaderFeaturesWorker(env, deferred, info[0].As<Napi::String>().Utf8Value());
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-            if (rv == SCARD_E_CANCELLED) {
-                std::cout << "INFO: SCardGetStatusChange cancelled (listener stopping)." << std::endl;
-                break;
-            } else if (rv == SCARD_E_TIMEOUT) {
-                continue; // Timeout normal, döngüye devam
-            } else if (rv == SCARD_E_UNKNOWN_READER || rv == SCARD_E_READER_UNAVAILABLE
-                    #ifndef _WIN32 // PCSC-lite'da bu hata farklı olabilir veya olmayabilir
-                    || rv == SCARD_E_COMM_DATA_LOST // Windows'a özgü olabilir
-                    #endif
-                    || rv == SCARD_E_NO_SERVICE // PCSC-lite daemon durmuş olabilir
-            ) {
-                 std::cerr << "ERROR: Reader '" << listener->readerName << "' unavailable or service stopped. " << SCardErrorToString(rv) << std::endl;
-                 auto errorStr = new std::string("Error: Reader '" + listener->readerName + "' unavailable or PC/SC service stopped. " + SCardErrorToString(rv));
-                 listener->errorCallback.BlockingCall(errorStr, [](Napi::Env env, Napi::Function jsCallback, std::string* msg) {
-                     jsCallback.Call({Napi::String::New(env, *msg)});
-                     delete msg;
-                 });
-                 g_running = false; // Hata sonrası dinleyiciyi durdur
-                 break;
-            } else if (rv == SCARD_E_INVALID_HANDLE) {
-                 std::cerr << "ERROR: PC/SC context became invalid." << std::endl;
-                 auto errorStr = new std::string("Critical Error: PC/SC context became invalid. Restart might be required.");
-                 listener->errorCallback.BlockingCall(errorStr, [](Napi::Env env, Napi::Function jsCallback, std::string* msg) {
-                     jsCallback.Call({Napi::String::New(env, *msg)});
-                     delete msg;
-                 });
-                 g_running = false; // Hata sonrası dinleyiciyi durdur
-                 break;
-            } else if (rv != SCARD_S_SUCCESS) {
-                // Diğer beklenmedik hatalar
-                std::cerr << "ERROR: SCardGetStatusChange failed! " << SCardErrorToString(rv) << std::endl;
-                std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Kısa bekleme
-                continue;
+    // scardCtlCode(code): üretici belgelerindeki fonksiyon numarasını platformun kontrol koduna çevirir
+    // (Windows: CTL_CODE(FILE_DEVICE_SMARTCARD, code, ...), PCSC-lite: 0x42000000 + code)
+    Napi::Value ScardCtlCode(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Parameter expected: code (number)").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        SCardDword code = info[0].As<Napi::Number>().Uint32Value();
+        return Napi::Number::New(env, static_cast<SCardDword>(SCARD_CTL_CODE(code)));
+    }
+
+    // UID listesini (Buffer veya hex string dizisi) indeks kayıtlarına ekler; hata varsa mesajı döner
+    std::string AppendUidEntries(const Napi::Value& list, const char* optionName, UidVerdict verdict,
+                                 std::vector<UidIndexEntry>& entries) {
+        if (list.IsUndefined() || list.IsNull()) return "";
+        if (!list.IsArray()) return std::string("Option '") + optionName + "' must be an array of Buffers or hex strings";
+        Napi::Array array = list.As<Napi::Array>();
+        std::vector<SCardByte> decoded;
+        for (uint32_t i = 0; i < array.Length(); i++) {
+            Napi::Value item = array.Get(i);
+            const SCardByte* uid = nullptr;
+            size_t length = 0;
+            if (item.IsBuffer()) {
+                Napi::Buffer<SCardByte> buffer = item.As<Napi::Buffer<SCardByte>>();
+                uid = buffer.Data();
+                length = buffer.Length();
+            } else if (item.IsString() && DecodeHex(item.As<Napi::String>().Utf8Value(), decoded)) {
+                uid = decoded.data();
+                length = decoded.size();
+            } else {
+                return std::string("Invalid UID at ") + optionName + "[" + std::to_string(i) + "]";
+            }
+            if (length == 0 || length > kUidIndexMaxUid) {
+                return std::string("UID at ") + optionName + "[" + std::to_string(i) + "] must be 1-"
+                     + std::to_string(kUidIndexMaxUid) + " bytes";
             }
+            UidIndexEntry entry;
+            memcpy(entry.uid, uid, length);
+            entry.length = static_cast<uint8_t>(length);
+            entry.verdict = verdict;
+            entries.push_back(entry);
+        }
+        return "";
+    }
 
-            // Durum değişikliğini işle (dwEventState alanı her iki platformda da var)
-            if (readerState.dwEventState & SCARD_STATE_CHANGED) {
-                 // Yeni durumu bir sonraki kontrol için sakla (dwCurrentState alanı da ortak)
-                readerState.dwCurrentState = readerState.dwEventState;
+    // buildUidIndex(path, { allow?, deny?, defaultVerdict? }): indeks dosyasını yazar (yüklemez)
+    Napi::Value BuildUidIndex(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: path (string), options (object)").Value());
+             return deferred.Promise();
+        }
+        Napi::Object options = info[1].As<Napi::Object>();
+        std::vector<UidIndexEntry> entries;
+        std::string error = AppendUidEntries(options.Get("allow"), "allow", kVerdictAllow, entries);
+        if (error.empty()) error = AppendUidEntries(options.Get("deny"), "deny", kVerdictDeny, entries);
+        if (!error.empty()) {
+             deferred.Reject(Napi::TypeError::New(env, error).Value());
+             return deferred.Promise();
+        }
 
-                // Kart takılı ve sessiz değil mi?
-                if (readerState.dwEventState & SCARD_STATE_PRESENT && !(readerState.dwEventState & SCARD_STATE_MUTE)) {
-                    std::cout << "INFO: Card detected in reader: " << listener->readerName << std::endl;
-                    SCARDHANDLE hCard = 0;
-                    SCardDword dwActiveProtocol = 0;
-
-                    // Karta bağlan (SCardConnect her iki platformda da var)
-                    rv = SCardConnect(g_context, listener->readerName.c_str(), SCARD_SHARE_SHARED,
-                                      SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1, &hCard, &dwActiveProtocol);
-
-                    if (rv == SCARD_S_SUCCESS) {
-                        // UID APDU (platformdan bağımsız)
-                        SCardByte cmd_get_uid[] = { 0xFF, 0xCA, 0x00, 0x00, 0x00 };
-                        // Yanıt buffer'ı
-                        std::vector<SCardByte> recvBufferVec(260);
-                        SCardDword recvLength = static_cast<SCardDword>(recvBufferVec.size());
-
-                        // Platforma uygun PCI yapısını al
-                        const SCARD_IO_REQUEST* pci = GetPci(dwActiveProtocol);
-                        if(!pci) {
-                            rv = SCARD_E_PROTO_MISMATCH; // Hata kodu ata
-                        } else {
-                            // APDU gönder
-                            rv = SCardTransmit(hCard, pci, cmd_get_uid, sizeof(cmd_get_uid),
-                                               nullptr, recvBufferVec.data(), &recvLength);
-                        }
+        // Varsayılan: izin listesi verildiyse listede olmayan reddedilir, yalnızca ret listesi varsa izin verilir
+        UidVerdict defaultVerdict = options.Get("allow").IsArray() ? kVerdictDeny : kVerdictAllow;
+        Napi::Value defaultOption = options.Get("defaultVerdict");
+        if (!defaultOption.IsUndefined()) {
+            std::string name = defaultOption.IsString() ? defaultOption.As<Napi::String>().Utf8Value() : "";
+            if (name == "allow") {
+                defaultVerdict = kVerdictAllow;
+            } else if (name == "deny") {
+                defaultVerdict = kVerdictDeny;
+            } else {
+                deferred.Reject(Napi::TypeError::New(env, "Option 'defaultVerdict' must be 'allow' or 'deny'").Value());
+                return deferred.Promise();
+            }
+        }
 
+        std::string path = info[0].As<Napi::String>().Utf8Value();
+        BuildUidIndexWorker* worker = new BuildUidIndexWorker(env, deferred, path, std::move(entries), defaultVerdict);
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-                        if (rv == SCARD_S_SUCCESS && recvLength >= 2) {
-                            // UID'yi formatla
-                            std::stringstream uidStream;
-                            uidStream << std::hex << std::uppercase << std::setfill('0');
-                            for (SCardDword i = 0; i < recvLength - 2; i++) {
-                                uidStream << std::setw(2) << static_cast<int>(recvBufferVec[i]);
-                            }
-                            auto uidStr = new std::string(uidStream.str());
-
-                            // JS'e gönder (ThreadSafeFunction)
-                            Napi::Error napiStatus = listener->uidCallback.BlockingCall(uidStr, [](Napi::Env env, Napi::Function jsCallback, std::string* data) {
-                                jsCallback.Call({Napi::String::New(env, *data)});
-                                delete data; // Heap'teki string'i sil
-                            });
-
-                            if (napiStatus != napi_ok) {
-                                 std::cerr << "ERROR: Failed to call UID callback: " << napiStatus << std::endl;
-                            }
-                            // Tekrar okumayı önlemek için bekleme ve state sıfırlama
-                            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
-                            readerState.dwCurrentState = SCARD_STATE_UNAWARE;
-
-                        } else if (rv != SCARD_S_SUCCESS) {
-                             // Transmit hatası
-                            std::cerr << "ERROR: Failed to get UID (SCardTransmit): " << SCardErrorToString(rv) << std::endl;
-                            auto errorStr = new std::string("Error: Failed to read UID from card. " + SCardErrorToString(rv));
-                            listener->errorCallback.BlockingCall(errorStr, [](Napi::Env env, Napi::Function jsCallback, std::string* msg) {
-                                jsCallback.Call({Napi::String::New(env, *msg)});
-                                delete msg;
-                            });
-                        } else { // recvLength < 2 durumu
-                             std::cerr << "WARN: SCardTransmit succeeded but received less than 2 bytes." << std::endl;
-                        }
+    // loadUidIndex(path): dosyayı eşler ve etkin indeksi değiştirir; dinleyici çalışırken de güvenlidir
+    Napi::Value LoadUidIndex(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !info[0].IsString()) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameter expected: path (string)").Value());
+             return deferred.Promise();
+        }
+        LoadUidIndexWorker* worker = new LoadUidIndexWorker(env, deferred, info[0].As<Napi::String>().Utf8Value());
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-                        SCardDisconnect(hCard, SCARD_LEAVE_CARD);
-                    } else {
-                        // Connect hatası
-                        std::cerr << "ERROR: Failed to connect to card (SCardConnect): " << SCardErrorToString(rv) << std::endl;
-                        auto errorStr = new std::string("Error: Failed to connect to card. " + SCardErrorToString(rv));
-                        listener->errorCallback.BlockingCall(errorStr, [](Napi::Env env, Napi::Function jsCallback, std::string* msg) {
-                            jsCallback.Call({Napi::String::New(env, *msg)});
-                            delete msg;
-                        });
-                        std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Hata sonrası bekleme
-                    }
-                } else if (readerState.dwEventState & SCARD_STATE_EMPTY) {
-                    std::cout << "INFO: Card removed from reader: " << listener->readerName << std::endl;
-                }
-            } // if (state changed)
-        } // while (g_running)
+    // unloadUidIndex(): etkin indeksi kaldırır; sonraki olaylar kararsız (null) iletilir
+    Napi::Value UnloadUidIndex(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        std::atomic_store(&g_uidIndex, std::shared_ptr<const UidIndex>());
+        return env.Undefined();
+    }
+
+    // lookupUid(uid): etkin indeksin kararı ('allow' | 'deny'), indeks yoksa null
+    Napi::Value LookupUid(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        std::vector<SCardByte> decoded;
+        const SCardByte* uid = nullptr;
+        size_t length = 0;
+        if (info.Length() >= 1 && info[0].IsBuffer()) {
+            Napi::Buffer<SCardByte> buffer = info[0].As<Napi::Buffer<SCardByte>>();
+            uid = buffer.Data();
+            length = buffer.Length();
+        } else if (info.Length() >= 1 && info[0].IsString() && DecodeHex(info[0].As<Napi::String>().Utf8Value(), decoded)) {
+            uid = decoded.data();
+            length = decoded.size();
+        } else {
+            Napi::TypeError::New(env, "Parameter expected: uid (Buffer or hex string)").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        std::shared_ptr<const UidIndex> index = std::atomic_load(&g_uidIndex);
+        if (!index) return env.Null();
+        return Napi::String::New(env, kVerdictNames[index->Lookup(uid, length)]);
+    }
 
-        std::cout << "INFO: Listener stopped for reader: '" << listener->readerName << "'" << std::endl;
+    // getUidIndexInfo(): etkin indeksin bilgileri ve dinleyicinin karar sayaçları, indeks yoksa null
+    Napi::Value GetUidIndexInfo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        std::shared_ptr<const UidIndex> index = std::atomic_load(&g_uidIndex);
+        if (!index) return env.Null();
+        Napi::Object result = UidIndexToObject(env, *index);
+        result.Set("allowed", Napi::Number::New(env, static_cast<double>(g_uidIndexAllowed.load())));
+        result.Set("denied", Napi::Number::New(env, static_cast<double>(g_uidIndexDenied.load())));
+        return result;
+    }
 
-        // TSFL'leri serbest bırak (önemli!)
-        if (listener) {
-            if (listener->uidCallback) listener->uidCallback.Release();
-            if (listener->errorCallback) listener->errorCallback.Release();
+    // openJournal(directory, { segmentSize?, maxSegments?, queueSize? }): kart olaylarının denetim günlüğünü başlatır
+    Napi::Value OpenJournal(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !info[0].IsString() || (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsObject())) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: directory (string), [options (object)]").Value());
+             return deferred.Promise();
         }
+        JournalOptions options;
+        options.directory = info[0].As<Napi::String>().Utf8Value();
+        if (info.Length() > 1 && info[1].IsObject()) {
+            Napi::Object object = info[1].As<Napi::Object>();
+            Napi::Value segmentSize = object.Get("segmentSize");
+            Napi::Value maxSegments = object.Get("maxSegments");
+            Napi::Value queueSize = object.Get("queueSize");
+            if (segmentSize.IsNumber()) {
+                double value = segmentSize.As<Napi::Number>().DoubleValue();
+                if (value < kMinJournalSegmentSize || value > 1024.0 * 1024 * 1024) {
+                    deferred.Reject(Napi::RangeError::New(env, "Option 'segmentSize' must be between 64 KiB and 1 GiB").Value());
+                    return deferred.Promise();
+                }
+                options.segmentSize = static_cast<size_t>(value);
+            }
+            if (maxSegments.IsNumber()) options.maxSegments = maxSegments.As<Napi::Number>().Uint32Value();
+            if (queueSize.IsNumber()) options.queueSize = std::max<size_t>(2, queueSize.As<Napi::Number>().Uint32Value());
+        }
+        OpenJournalWorker* worker = new OpenJournalWorker(env, deferred, options);
+        worker->Queue();
+        return deferred.Promise();
     }
 
+    // closeJournal(): kuyrukta kalan kayıtları yazar ve günlüğü kapatır; açık değilse false ile çözülür
+    Napi::Value CloseJournal(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        CloseJournalWorker* worker = new CloseJournalWorker(env, deferred);
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-    // === N-API Fonksiyonları ===
+    // getJournalInfo(): açık günlüğün durumu ve sayaçları, açık değilse null
+    Napi::Value GetJournalInfo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        std::shared_ptr<TapJournal> journal = std::atomic_load(&g_tapJournal);
+        if (!journal) return env.Null();
+        return JournalInfoToObject(env, *journal);
+    }
 
-    Napi::Value GetAllReaders(const Napi::CallbackInfo& info) {
+    // readJournal(directory, { since?, until?, readerName?, limit? }): günlük kayıtlarını eskiden yeniye döner
+    Napi::Value ReadJournal(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
-        if (!EnsureContext(&env)) return env.Null();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (info.Length() < 1 || !info[0].IsString() || (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsObject())) {
+             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: directory (string), [options (object)]").Value());
+             return deferred.Promise();
+        }
+        JournalScanFilter filter;
+        if (info.Length() > 1 && info[1].IsObject()) {
+            Napi::Object object = info[1].As<Napi::Object>();
+            Napi::Value since = object.Get("since");
+            Napi::Value until = object.Get("until");
+            Napi::Value readerName = object.Get("readerName");
+            Napi::Value limit = object.Get("limit");
+            // Zamanlar Date.now() gibi milisaniye cinsinden
+            if (since.IsNumber()) filter.sinceUs = static_cast<uint64_t>(std::max(0.0, since.As<Napi::Number>().DoubleValue()) * 1000);
+            if (until.IsNumber()) filter.untilUs = static_cast<uint64_t>(std::max(0.0, until.As<Napi::Number>().DoubleValue()) * 1000);
+            if (readerName.IsString()) filter.readerName = readerName.As<Napi::String>().Utf8Value();
+            if (limit.IsNumber()) filter.limit = limit.As<Napi::Number>().Uint32Value();
+        }
+        ReadJournalWorker* worker = new ReadJournalWorker(env, deferred, info[0].As<Napi::String>().Utf8Value(), filter);
+        worker->Queue();
+        return deferred.Promise();
+    }
 
-        char* readers = nullptr;
-        SCardDword readersLen = 0; // Boyutu saklamak için
+    // === Yerel Mikro Benchmark'lar ===
+    // bench/run.js tarafından çağrılır; sıcak yoldaki yardımcıları JS'ten bağımsız ölçer.
 
-        #ifdef _WIN32
-            // Windows: SCARD_AUTOALLOCATE kullan
-            readersLen = SCARD_AUTOALLOCATE;
-            SCardLong rv = SCardListReadersA(g_context, NULL, (LPSTR)&readers, &readersLen);
-        #else
-            // PCSC-lite: İki adımlı işlem
-            // 1. Adım: Boyutu al
-            SCardLong rv = SCardListReaders(g_context, NULL, NULL, &readersLen);
-            if (rv == SCARD_S_SUCCESS && readersLen > 1) { // Boyut geçerliyse
-                 // 2. Adım: Belleği ayır ve okuyucuları al
-                 readers = new (std::nothrow) char[readersLen]; // Bellek ayırma hatasını kontrol et
-                 if (readers == nullptr) {
-                     rv = SCARD_E_NO_MEMORY; // Veya uygun hata kodu
-                 } else {
-                     rv = SCardListReaders(g_context, NULL, readers, &readersLen);
-                 }
-            } else if (rv == SCARD_E_NO_READERS_AVAILABLE) {
-                 // Okuyucu yoksa sorun değil, rv'yi başarıya ayarla ki aşağıda boş dizi dönsün
-                 rv = SCARD_S_SUCCESS;
-                 readersLen = 0; // Emin olmak için
-            }
-            // Diğer SCardListReaders hataları (ilk çağrıda) rv içinde kalır
-        #endif
+    struct NativeBenchmarkResult {
+        const char* name;
+        uint64_t iterations;
+        double nsPerOp;
+    };
 
-        if (rv != SCARD_S_SUCCESS) {
-            #ifndef _WIN32
-            // PCSC-lite için ayrılan belleği temizle (eğer varsa)
-            delete[] readers;
-            #endif
-            if (rv == SCARD_E_NO_READERS_AVAILABLE) {
-                return Napi::Array::New(env); // Okuyucu yoksa boş dizi
-            }
-            ThrowNapiError(env, "Failed to list readers", rv);
-            return env.Null();
-        }
+    template <typename Fn>
+    NativeBenchmarkResult RunNativeBenchmark(const char* name, uint64_t iterations, Fn&& body) {
+        for (uint64_t i = 0; i < iterations / 10; i++) body(i); // Isınma
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) body(i);
+        double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        return NativeBenchmarkResult{ name, iterations, elapsedNs / static_cast<double>(iterations) };
+    }
 
-        Napi::Array result = Napi::Array::New(env);
-        if (readers != nullptr && readersLen > 1) { // Multi-string buffer boş değilse
-            char* currentReader = readers;
-            uint32_t index = 0;
-            while (*currentReader != '\0') { // Son çift null'a kadar git
-                result.Set(index++, Napi::String::New(env, currentReader));
-                currentReader += strlen(currentReader) + 1;
-            }
+    // runNativeBenchmarks(iterations = 1000000): [{ name, iterations, nsPerOp }]
+    Napi::Value RunNativeBenchmarks(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        uint64_t iterations = 1000000;
+        if (info.Length() > 0 && info[0].IsNumber()) {
+            iterations = std::max<int64_t>(1, info[0].As<Napi::Number>().Int64Value());
         }
+        volatile uint64_t sink = 0; // Derleyicinin döngüleri silmesini engeller
+        std::vector<NativeBenchmarkResult> results;
 
-        // Ayrılan belleği serbest bırak
-        #ifdef _WIN32
-            if (readers != nullptr) SCardFreeMemory(g_context, readers);
-        #else
-            delete[] readers; // new[] ile ayrıldığı için delete[] ile sil
-        #endif
+        const SCardByte uid[7] = { 0x04, 0xA2, 0x3B, 0x5C, 0x6D, 0x7E, 0x8F };
+        results.push_back(RunNativeBenchmark("hexEncodeUid7", iterations, [&](uint64_t i) {
+            char hex[kMaxEventUid * 2];
+            sink = sink + EncodeHex(uid, sizeof(uid), hex) + static_cast<uint8_t>(hex[i % 14]);
+        }));
+
+        LatencyHistogram histogram;
+        results.push_back(RunNativeBenchmark("histogramRecord", iterations, [&](uint64_t i) {
+            histogram.Record((i * 2654435761u) & 0xFFFFF);
+        }));
+        sink = sink + histogram.Percentile(99);
+
+        SpscRing<ListenerEvent> ring(kDefaultEventQueueSize);
+        results.push_back(RunNativeBenchmark("eventRingPushPop", iterations, [&](uint64_t i) {
+            ListenerEvent* event = ring.BeginPush();
+            event->uidLength = static_cast<uint8_t>(i);
+            ring.CommitPush();
+            sink = sink + ring.Front()->uidLength;
+            ring.Pop();
+        }));
+
+        // 61xx zinciri: 4 parça GET RESPONSE, sahte transmit ile (PC/SC çağrısı yok)
+        std::vector<SCardByte> apdu = { 0x00, 0xB0, 0x00, 0x00, 0x00 };
+        std::vector<SCardByte> response;
+        results.push_back(RunNativeBenchmark("transmitChained4x61xx", iterations / 10, [&](uint64_t) {
+            int remaining = 4;
+            TransmitChained([&remaining](const SCardByte*, size_t, std::vector<SCardByte>& out) {
+                out.assign(64, 0xAB);
+                out.push_back(remaining > 0 ? 0x61 : 0x90);
+                out.push_back(remaining > 0 ? 0x40 : 0x00);
+                remaining--;
+                return static_cast<SCardLong>(SCARD_S_SUCCESS);
+            }, apdu, response);
+            sink = sink + response.size();
+        }));
 
+        Napi::Array result = Napi::Array::New(env, results.size());
+        for (uint32_t i = 0; i < results.size(); i++) {
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("name", Napi::String::New(env, results[i].name));
+            entry.Set("iterations", Napi::Number::New(env, static_cast<double>(results[i].iterations)));
+            entry.Set("nsPerOp", Napi::Number::New(env, results[i].nsPerOp));
+            result.Set(i, entry);
+        }
         return result;
     }
 
-    Napi::Value StartListening(const Napi::CallbackInfo& info) {
+
+    // === Arka Uç Seçimi ve Simülatör API'si ===
+
+    // Arka ucu değiştirir ('system' | 'simulated'). Dinleyici, açık oturum veya bekleyen iş varken reddedilir.
+    Napi::Value UseBackend(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
-        if (info.Length() < 3 || !info[0].IsString() || !info[1].IsFunction() || !info[2].IsFunction()) {
-            Napi::TypeError::New(env, "Parameters expected: readerName (string), onUid (function), onError (function)").ThrowAsJavaScriptException();
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Backend name expected: 'system' or 'simulated'.").ThrowAsJavaScriptException();
             return env.Null();
         }
-        if (!EnsureContext(&env)) return env.Null();
-        if (g_running.load()) {
-            Napi::Error::New(env, "Listener is already active. Call stopListening first.").ThrowAsJavaScriptException();
+        std::string name = info[0].As<Napi::String>().Utf8Value();
+        PcscBackend* backend = name == "system" ? static_cast<PcscBackend*>(&g_systemBackend)
+                             : name == "simulated" ? static_cast<PcscBackend*>(&g_simulatedBackend)
+                             : nullptr;
+        if (!backend) {
+            Napi::TypeError::New(env, "Unknown backend '" + name + "'. Expected 'system' or 'simulated'.").ThrowAsJavaScriptException();
             return env.Null();
         }
-        if (g_pollThread.joinable()) { // Önceki thread bitmemişse bekle (nadiren olmalı)
-            try { g_pollThread.join(); } catch (...) {}
-        }
-
-        std::string readerName = info[0].As<Napi::String>().Utf8Value();
-        Napi::Function uidCallback = info[1].As<Napi::Function>();
-        Napi::Function errorCallback = info[2].As<Napi::Function>();
+        if (backend == g_backend.load()) return env.Null();
 
-        Napi::ThreadSafeFunction tsfnUid = Napi::ThreadSafeFunction::New(env, uidCallback, "PCSC_UID_Callback", 0, 1);
-        Napi::ThreadSafeFunction tsfnError = Napi::ThreadSafeFunction::New(env, errorCallback, "PCSC_Error_Callback", 0, 1);
-        if (!tsfnUid || !tsfnError) {
-            if (tsfnUid) tsfnUid.Release(); // Başarısız olursa temizle
-            if (tsfnError) tsfnError.Release();
-            Napi::Error::New(env, "Failed to create ThreadSafeFunctions.").ThrowAsJavaScriptException();
+        // Arka uç süreç geneli olduğundan tüm worker_threads ortamları boşta olmalıdır
+        bool busy = false;
+        {
+            std::lock_guard<std::mutex> lock(g_instancesMutex);
+            for (AddonInstance* other : g_instances) {
+                std::lock_guard<std::mutex> sessionsLock(other->sessionsMutex);
+                busy |= other->running.load() || !other->sessions.empty() || !other->scheduler.Idle();
+            }
+        }
+        if (busy) {
+            Napi::Error::New(env, "Cannot switch backend while listening, with open sessions or with pending transmits.").ThrowAsJavaScriptException();
             return env.Null();
         }
 
+        // Eski arka ucun context'i bırakılır; sonraki çağrı yeni arka uçta kurar. Diğer ortamların
+        // context'leri ilk kullanımda (EnsureContext arka uç uyuşmazlığını görünce) yenilenir.
+        {
+            AddonInstance& instance = InstanceFor(env);
+            g_contextPool.Clear();
+            std::lock_guard<std::mutex> lock(g_contextMutex);
+            ReleaseContextLocked(instance.mainContext);
+            ReleaseContextLocked(instance.listenerContext);
+            g_establishBackoff = std::chrono::milliseconds(0);
+            g_nextEstablishAttempt = std::chrono::steady_clock::time_point();
+            g_backend = backend;
+        }
+        {
+            std::lock_guard<std::mutex> lock(g_readerCacheMutex);
+            g_cachedReaders.clear();
+        }
         {
-            std::lock_guard<std::mutex> lock(g_listenerMutex);
-            g_activeListener = std::make_unique<ListenerInfo>();
-            g_activeListener->readerName = readerName;
-            g_activeListener->uidCallback = tsfnUid;
-            g_activeListener->errorCallback = tsfnError;
+            std::lock_guard<std::mutex> lock(g_featureCacheMutex);
+            g_featureCache.clear();
         }
+        PCSC_LOG(kLogInfo) << "Using PC/SC backend: " << backend->Name();
+        return env.Null();
+    }
 
-        g_running = true;
-        try {
-            g_pollThread = std::thread(PollForCard);
-        } catch (const std::system_error& e) {
-            g_running = false;
-            tsfnUid.Abort(); // Abort, Release'i de yapar
-            tsfnError.Abort();
-            { std::lock_guard<std::mutex> lock(g_listenerMutex); g_activeListener.reset(); }
-            ThrowNapiError(env, "Failed to start listener thread: " + std::string(e.what()));
+    Napi::Value GetBackend(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        return Napi::String::New(env, Backend().Name());
+    }
+
+    bool ParseSimOp(Napi::Env env, const Napi::Value& value, SimOp* op) {
+        if (value.IsString()) {
+            std::string name = value.As<Napi::String>().Utf8Value();
+            for (int i = 0; i < kSimOpCount; i++) {
+                if (name == kSimOpNames[i]) {
+                    *op = static_cast<SimOp>(i);
+                    return true;
+                }
+            }
+        }
+        Napi::TypeError::New(env, "Operation expected: 'establish', 'listReaders', 'statusChange', 'connect', 'transmit' or 'control'.").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    Napi::Value SimAddReader(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Reader name (string) expected.").ThrowAsJavaScriptException();
             return env.Null();
         }
+        g_simulatedBackend.AddReader(info[0].As<Napi::String>().Utf8Value());
         return env.Null();
     }
 
-    Napi::Value StopListening(const Napi::CallbackInfo& info) {
+    Napi::Value SimRemoveReader(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
-        if (!g_running.load()) return env.Null(); // Zaten çalışmıyor
-
-        g_running = false; // Önce flag'i ayarla
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Reader name (string) expected.").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        return Napi::Boolean::New(env, g_simulatedBackend.RemoveReader(info[0].As<Napi::String>().Utf8Value()));
+    }
 
-        if (g_context != 0) {
-            SCardLong rv = SCardCancel(g_context); // SCardGetStatusChange'i uyandır/iptal et
-            if (rv != SCARD_S_SUCCESS && rv != SCARD_E_INVALID_HANDLE) {
-                 // PCSC-lite'da SCARD_W_CANCELLED_BY_USER olmayabilir, bu yüzden kontrol etme
-                std::cerr << "WARN: SCardCancel failed: " << SCardErrorToString(rv) << std::endl;
+    // simInsertCard(readerName, { uid: Buffer, atr?: Buffer, responses?: [{ command: Buffer, response: Buffer }] })
+    Napi::Value SimInsertCard(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()
+                || !info[1].As<Napi::Object>().Get("uid").IsBuffer()) {
+            Napi::TypeError::New(env, "Parameters expected: readerName (string), card ({ uid: Buffer, atr?: Buffer, responses?: Array })").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object cardObject = info[1].As<Napi::Object>();
+        SimulatedBackend::Card card;
+        Napi::Buffer<SCardByte> uid = cardObject.Get("uid").As<Napi::Buffer<SCardByte>>();
+        card.uid.assign(uid.Data(), uid.Data() + uid.Length());
+        if (cardObject.Get("atr").IsBuffer()) {
+            Napi::Buffer<SCardByte> atr = cardObject.Get("atr").As<Napi::Buffer<SCardByte>>();
+            card.atr.assign(atr.Data(), atr.Data() + atr.Length());
+        }
+        if (cardObject.Get("responses").IsArray()) {
+            Napi::Array responses = cardObject.Get("responses").As<Napi::Array>();
+            for (uint32_t i = 0; i < responses.Length(); i++) {
+                Napi::Value entry = responses.Get(i);
+                if (!entry.IsObject() || !entry.As<Napi::Object>().Get("command").IsBuffer()
+                        || !entry.As<Napi::Object>().Get("response").IsBuffer()) {
+                    Napi::TypeError::New(env, "card.responses[" + std::to_string(i) + "] must be { command: Buffer, response: Buffer }.").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+                Napi::Buffer<SCardByte> command = entry.As<Napi::Object>().Get("command").As<Napi::Buffer<SCardByte>>();
+                Napi::Buffer<SCardByte> response = entry.As<Napi::Object>().Get("response").As<Napi::Buffer<SCardByte>>();
+                card.responses.emplace_back(std::vector<SCardByte>(command.Data(), command.Data() + command.Length()),
+                                            std::vector<SCardByte>(response.Data(), response.Data() + response.Length()));
             }
         }
+        return Napi::Boolean::New(env, g_simulatedBackend.InsertCard(info[0].As<Napi::String>().Utf8Value(), std::move(card)));
+    }
 
-        if (g_pollThread.joinable()) {
-            try {
-                g_pollThread.join(); // Thread'in bitmesini bekle
-            } catch (const std::system_error& e) {
-                std::cerr << "ERROR: Failed joining listener thread: " << e.what() << std::endl;
-            }
+    Napi::Value SimRemoveCard(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Reader name (string) expected.").ThrowAsJavaScriptException();
+            return env.Null();
         }
+        return Napi::Boolean::New(env, g_simulatedBackend.RemoveCard(info[0].As<Napi::String>().Utf8Value()));
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(g_listenerMutex);
-            g_activeListener.reset(); // Listener bilgisini temizle
+    // simSetLatency(operation, milliseconds): işlem her çağrıda bu kadar gecikir (kesirli ms desteklenir)
+    Napi::Value SimSetLatency(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        SimOp op;
+        if (info.Length() < 2 || !ParseSimOp(env, info[0], &op)) return env.Null();
+        if (!info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Latency in milliseconds (number) expected.").ThrowAsJavaScriptException();
+            return env.Null();
         }
-        std::cout << "INFO: Listener stopped successfully." << std::endl;
+        double ms = std::max(0.0, info[1].As<Napi::Number>().DoubleValue());
+        g_simulatedBackend.SetLatency(op, std::chrono::microseconds(static_cast<int64_t>(ms * 1000.0)));
         return env.Null();
     }
 
-    Napi::Value TransmitAPDU(const Napi::CallbackInfo& info) {
+    // simInjectError(operation, code, count = 1): işlemin sonraki count çağrısı PC/SC hata koduyla döner
+    Napi::Value SimInjectError(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
-        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsBuffer()) {
-             Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
-             deferred.Reject(Napi::TypeError::New(env, "Parameters expected: readerName (string), apdu (Buffer)").Value());
-             return deferred.Promise();
-        }
-        if (!EnsureContext(&env)) {
-             Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
-             deferred.Reject(Napi::Error::New(env, "PC/SC context not established or invalid.").Value());
-             return deferred.Promise();
+        SimOp op;
+        if (info.Length() < 2 || !ParseSimOp(env, info[0], &op)) return env.Null();
+        if (!info[1].IsNumber()) {
+            Napi::TypeError::New(env, "PC/SC error code (number) expected.").ThrowAsJavaScriptException();
+            return env.Null();
         }
+        SCardLong rv = static_cast<SCardLong>(info[1].As<Napi::Number>().Int64Value());
+        uint32_t count = info.Length() > 2 && info[2].IsNumber() ? info[2].As<Napi::Number>().Uint32Value() : 1;
+        g_simulatedBackend.InjectError(op, rv, count);
+        return env.Null();
+    }
 
-        std::string readerName = info[0].As<Napi::String>().Utf8Value();
-        Napi::Buffer<SCardByte> apduNapiBuffer = info[1].As<Napi::Buffer<SCardByte>>();
+    Napi::Value SimReset(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        g_simulatedBackend.Reset();
+        return env.Null();
+    }
 
-        // Buffer verisini std::vector'e kopyala
-        std::vector<SCardByte> apduToSend(apduNapiBuffer.Data(), apduNapiBuffer.Data() + apduNapiBuffer.Length());
+    // simStopService(): Sanal PC/SC servisini durdurur (pcscd yeniden başlatılması gibi); tüm context'ler geçersizleşir
+    Napi::Value SimStopService(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        g_simulatedBackend.StopService();
+        return env.Null();
+    }
 
-        // AsyncWorker'ı başlat ve Promise'i döndür
-        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
-        TransmitWorker* worker = new TransmitWorker(env, deferred, readerName, apduToSend);
-        worker->Queue();
-        return deferred.Promise();
+    // simStartService(): Sanal PC/SC servisini yeniden başlatır
+    Napi::Value SimStartService(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        g_simulatedBackend.StartService();
+        return env.Null();
     }
 
+
     // === Modül Başlatma ===
 
+    // Her ortamda (ana thread ve her worker_threads worker'ı) bir kez çağrılır
     Napi::Object Init(Napi::Env env, Napi::Object exports) {
-        EnsureContext(); // Başlangıçta context kurmayı dene (hata göz ardı edilir)
+        // Ortamın durumu; ortam kapanırken cleanup hook'larından sonra Node tarafından silinir
+        AddonInstance* instance = new AddonInstance();
+        env.SetInstanceData<AddonInstance>(instance);
+        {
+            std::lock_guard<std::mutex> lock(g_instancesMutex);
+            g_instances.push_back(instance);
+        }
+        StartLogger(); // Süreçte ilk ortam yazıcı thread'ini açar
+        EnsureContext(instance->mainContext); // Başlangıçta context kurmayı dene (hata göz ardı edilir)
 
-        napi_status status = napi_add_env_cleanup_hook(env, CleanupContext, nullptr);
+        napi_status status = napi_add_env_cleanup_hook(env, CleanupInstance, instance);
         if (status != napi_ok) {
-             std::cerr << "WARN: Failed to add environment cleanup hook for PC/SC context." << std::endl;
+             PCSC_LOG(kLogWarn) << "Failed to add environment cleanup hook for PC/SC context.";
+        }
+        // İş havuzunun hook'u context'ten sonra kaydedilir, yani context serbest bırakılmadan önce durur
+        if (!instance->scheduler.Start(env)) {
+             PCSC_LOG(kLogWarn) << "Failed to start the PC/SC job scheduler.";
         }
 
         exports.Set("getAllReaders", Napi::Function::New(env, GetAllReaders, "getAllReaders"));
+        exports.Set("listReaders", Napi::Function::New(env, ListReaders, "listReaders"));
+        exports.Set("getReaderStatus", Napi::Function::New(env, GetReaderStatus, "getReaderStatus"));
+        exports.Set("parseAtr", Napi::Function::New(env, ParseAtr, "parseAtr"));
+        exports.Set("getCachedReaders", Napi::Function::New(env, GetCachedReaders, "getCachedReaders"));
         exports.Set("startListening", Napi::Function::New(env, StartListening, "startListening"));
         exports.Set("stopListening", Napi::Function::New(env, StopListening, "stopListening"));
+        exports.Set("getListenerStats", Napi::Function::New(env, GetListenerStats, "getListenerStats"));
+        exports.Set("updateListener", Napi::Function::New(env, UpdateListener, "updateListener"));
+        exports.Set("getStats", Napi::Function::New(env, GetStats, "getStats"));
+        exports.Set("resetStats", Napi::Function::New(env, ResetStats, "resetStats"));
+        exports.Set("configureLogging", Napi::Function::New(env, ConfigureLogging, "configureLogging"));
         exports.Set("transmit", Napi::Function::New(env, TransmitAPDU, "transmit"));
+        exports.Set("transmitBatch", Napi::Function::New(env, TransmitBatch, "transmitBatch"));
+        exports.Set("readMemory", Napi::Function::New(env, ReadMemory, "readMemory"));
+        exports.Set("desfire", Napi::Function::New(env, Desfire, "desfire"));
+        exports.Set("control", Napi::Function::New(env, Control, "control"));
+        exports.Set("getAttribute", Napi::Function::New(env, GetAttribute, "getAttribute"));
+        exports.Set("getReaderFeatures", Napi::Function::New(env, GetReaderFeatures, "getReaderFeatures"));
+        exports.Set("scardCtlCode", Napi::Function::New(env, ScardCtlCode, "scardCtlCode"));
+
+        // getAttribute() için standart öznitelik kimlikleri
+        Napi::Object readerAttributes = Napi::Object::New(env);
+        readerAttributes.Set("vendorName", Napi::Number::New(env, SCARD_ATTR_VENDOR_NAME));
+        readerAttributes.Set("vendorIfdType", Napi::Number::New(env, SCARD_ATTR_VENDOR_IFD_TYPE));
+        readerAttributes.Set("vendorIfdVersion", Napi::Number::New(env, SCARD_ATTR_VENDOR_IFD_VERSION));
+        readerAttributes.Set("vendorIfdSerialNo", Napi::Number::New(env, SCARD_ATTR_VENDOR_IFD_SERIAL_NO));
+        readerAttributes.Set("channelId", Napi::Number::New(env, SCARD_ATTR_CHANNEL_ID));
+        readerAttributes.Set("atrString", Napi::Number::New(env, SCARD_ATTR_ATR_STRING));
+        exports.Set("readerAttributes", readerAttributes);
+        exports.Set("buildUidIndex", Napi::Function::New(env, BuildUidIndex, "buildUidIndex"));
+        exports.Set("loadUidIndex", Napi::Function::New(env, LoadUidIndex, "loadUidIndex"));
+        exports.Set("unloadUidIndex", Napi::Function::New(env, UnloadUidIndex, "unloadUidIndex"));
+        exports.Set("lookupUid", Napi::Function::New(env, LookupUid, "lookupUid"));
+        exports.Set("getUidIndexInfo", Napi::Function::New(env, GetUidIndexInfo, "getUidIndexInfo"));
+        exports.Set("openJournal", Napi::Function::New(env, OpenJournal, "openJournal"));
+        exports.Set("closeJournal", Napi::Function::New(env, CloseJournal, "closeJournal"));
+        exports.Set("getJournalInfo", Napi::Function::New(env, GetJournalInfo, "getJournalInfo"));
+        exports.Set("readJournal", Napi::Function::New(env, ReadJournal, "readJournal"));
+        exports.Set("openSession", Napi::Function::New(env, OpenSession, "openSession"));
+        exports.Set("sessionTransmit", Napi::Function::New(env, SessionTransmit, "sessionTransmit"));
+        exports.Set("closeSession", Napi::Function::New(env, CloseSession, "closeSession"));
+        exports.Set("useBackend", Napi::Function::New(env, UseBackend, "useBackend"));
+        exports.Set("getBackend", Napi::Function::New(env, GetBackend, "getBackend"));
+        exports.Set("simAddReader", Napi::Function::New(env, SimAddReader, "simAddReader"));
+        exports.Set("simRemoveReader", Napi::Function::New(env, SimRemoveReader, "simRemoveReader"));
+        exports.Set("simInsertCard", Napi::Function::New(env, SimInsertCard, "simInsertCard"));
+        exports.Set("simRemoveCard", Napi::Function::New(env, SimRemoveCard, "simRemoveCard"));
+        exports.Set("simSetLatency", Napi::Function::New(env, SimSetLatency, "simSetLatency"));
+        exports.Set("simInjectError", Napi::Function::New(env, SimInjectError, "simInjectError"));
+        exports.Set("simReset", Napi::Function::New(env, SimReset, "simReset"));
+        exports.Set("simStopService", Napi::Function::New(env, SimStopService, "simStopService"));
+        exports.Set("simStartService", Napi::Function::New(env, SimStartService, "simStartService"));
+        exports.Set("runNativeBenchmarks", Napi::Function::New(env, RunNativeBenchmarks, "runNativeBenchmarks"));
 
         return exports;
     }